@@ -0,0 +1,126 @@
+#ifndef ASSET_LOADER_H
+#define ASSET_LOADER_H
+
+#include <learnopengl/texture_cache.h>
+#include <learnopengl/model.h>
+#include <learnopengl/thread_pool.h>
+
+#include <deque>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+// Loads models and textures in the background. The CPU heavy part (ASSIMP import, texture baking) runs on the
+// thread pool and the finished data is queued back; ProcessUploads, called from the thread owning the GL
+// context, then hands every finished asset to its callback, which does the upload:
+//
+//     loader.LoadModel("resources/objects/house.obj", [&](ModelData &data) { house.reset(new Model(data)); });
+//     loader.LoadTexture("resources/textures/grass.jpg", TextureUsage::Color, [&](unsigned int texture) { grass = texture; });
+//     while (!loader.Done()) {
+//         loader.ProcessUploads();
+//         // present a loading frame
+//     }
+class AssetLoader
+{
+public:
+    explicit AssetLoader(unsigned int threadCount = std::thread::hardware_concurrency())
+        : pool(threadCount)
+    {
+    }
+
+    void LoadModel(const std::string &path, std::function<void(ModelData&)> onLoaded)
+    {
+        load<ModelData>([path]() { return Model::Import(path); }, std::move(onLoaded));
+    }
+
+    // the callback receives the texture name, acquired from the TextureCache (release it there when done)
+    void LoadTexture(const std::string &path, TextureUsage usage, std::function<void(unsigned int)> onLoaded)
+    {
+        load([path, usage]() { TextureCache::Instance().Fetch(path, usage); },
+             [path, usage, onLoaded]() { onLoaded(TextureCache::Instance().Acquire(path, usage)); });
+    }
+
+    // every face is fetched by its own task, the cubemap is uploaded once all six are there
+    void LoadCubemap(const std::vector<std::string> &faces, std::function<void(unsigned int)> onLoaded)
+    {
+        std::shared_ptr<unsigned int> remaining = std::make_shared<unsigned int>(faces.size());
+        for (const std::string &face : faces)
+        {
+            load([face]() { TextureCache::Instance().Fetch(face, TextureUsage::Color); },
+                 [faces, remaining, onLoaded]() {
+                     // callbacks all run on the GL thread, no synchronization needed
+                     if (--*remaining == 0)
+                         onLoaded(TextureCache::Instance().AcquireCubemap(faces));
+                 });
+        }
+    }
+
+    // runs the callbacks of all assets finished since the last call, returns how many there were
+    unsigned int ProcessUploads()
+    {
+        std::deque<std::function<void()>> ready;
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            ready.swap(finished);
+        }
+        for (std::function<void()> &upload : ready)
+        {
+            upload();
+            completed++;
+        }
+        return ready.size();
+    }
+
+    // true once everything requested so far has been loaded and uploaded
+    bool Done() const
+    {
+        return completed == requested;
+    }
+
+    unsigned int Requested() const
+    {
+        return requested;
+    }
+
+    unsigned int Completed() const
+    {
+        return completed;
+    }
+
+    // the workers idle once everything is loaded, other per frame work can borrow them
+    ThreadPool &Pool()
+    {
+        return pool;
+    }
+
+private:
+    std::mutex mutex;
+    std::deque<std::function<void()>> finished;
+    // only touched from the GL thread
+    unsigned int requested = 0;
+    unsigned int completed = 0;
+    // declared last so the workers are joined before the queue they push into is destroyed
+    ThreadPool pool;
+
+    // runs work on the pool and queues upload for the next ProcessUploads
+    void load(std::function<void()> work, std::function<void()> upload)
+    {
+        requested++;
+        pool.Submit([this, work, upload]() {
+            work();
+            std::lock_guard<std::mutex> lock(mutex);
+            finished.push_back(upload);
+        });
+    }
+
+    template<typename T>
+    void load(std::function<T()> work, std::function<void(T&)> onLoaded)
+    {
+        std::shared_ptr<T> result = std::make_shared<T>();
+        load([result, work]() { *result = work(); }, [result, onLoaded]() { onLoaded(*result); });
+    }
+};
+#endif
@@ -0,0 +1,276 @@
+#ifndef BENCHMARK_H
+#define BENCHMARK_H
+
+#include <glad/glad.h>
+#include <glm/glm.hpp>
+
+#include <learnopengl/render_stats.h>
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <fstream>
+#include <iostream>
+#include <string>
+#include <vector>
+
+struct CameraKey {
+    glm::vec3 position;
+    glm::vec3 target;
+};
+
+// Closed Catmull-Rom spline through camera keys, sampled by progress in [0, 1). The curve passes through
+// every key and the last key flows back into the first.
+class CameraPath
+{
+public:
+    explicit CameraPath(std::vector<CameraKey> keys) : keys(std::move(keys)) {}
+
+    void Sample(float progress, glm::vec3 &position, glm::vec3 &target) const
+    {
+        unsigned int count = keys.size();
+        float scaled = (progress - std::floor(progress)) * count;
+        unsigned int segment = std::min((unsigned int)scaled, count - 1);
+        float t = scaled - segment;
+        const CameraKey &k0 = keys[(segment + count - 1) % count];
+        const CameraKey &k1 = keys[segment];
+        const CameraKey &k2 = keys[(segment + 1) % count];
+        const CameraKey &k3 = keys[(segment + 2) % count];
+        position = catmullRom(k0.position, k1.position, k2.position, k3.position, t);
+        target = catmullRom(k0.target, k1.target, k2.target, k3.target, t);
+    }
+
+private:
+    std::vector<CameraKey> keys;
+
+    static glm::vec3 catmullRom(const glm::vec3 &p0, const glm::vec3 &p1, const glm::vec3 &p2, const glm::vec3 &p3, float t)
+    {
+        float t2 = t * t, t3 = t2 * t;
+        return 0.5f * ((2.0f * p1) + (p2 - p0) * t + (2.0f * p0 - 5.0f * p1 + 4.0f * p2 - p3) * t2 +
+                       (3.0f * p1 - p0 - 3.0f * p2 + p3) * t3);
+    }
+};
+
+// Color and depth renderbuffers of a fixed size, so a benchmark renders the same number of pixels whatever
+// the (possibly hidden) window's framebuffer looks like.
+class OffscreenTarget
+{
+public:
+    OffscreenTarget(unsigned int width, unsigned int height) : width(width), height(height)
+    {
+        glGenFramebuffers(1, &FBO);
+        glBindFramebuffer(GL_FRAMEBUFFER, FBO);
+        glGenRenderbuffers(1, &colorBuffer);
+        glBindRenderbuffer(GL_RENDERBUFFER, colorBuffer);
+        glRenderbufferStorage(GL_RENDERBUFFER, GL_RGBA8, width, height);
+        glFramebufferRenderbuffer(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_RENDERBUFFER, colorBuffer);
+        glGenRenderbuffers(1, &depthBuffer);
+        glBindRenderbuffer(GL_RENDERBUFFER, depthBuffer);
+        glRenderbufferStorage(GL_RENDERBUFFER, GL_DEPTH24_STENCIL8, width, height);
+        glFramebufferRenderbuffer(GL_FRAMEBUFFER, GL_DEPTH_STENCIL_ATTACHMENT, GL_RENDERBUFFER, depthBuffer);
+        if (glCheckFramebufferStatus(GL_FRAMEBUFFER) != GL_FRAMEBUFFER_COMPLETE)
+            std::cout << "ERROR::FRAMEBUFFER:: Offscreen target is not complete!" << std::endl;
+        glBindFramebuffer(GL_FRAMEBUFFER, 0);
+    }
+
+    ~OffscreenTarget()
+    {
+        glDeleteRenderbuffers(1, &colorBuffer);
+        glDeleteRenderbuffers(1, &depthBuffer);
+        glDeleteFramebuffers(1, &FBO);
+    }
+
+    OffscreenTarget(const OffscreenTarget&) = delete;
+    OffscreenTarget& operator=(const OffscreenTarget&) = delete;
+
+    unsigned int FBO;
+    unsigned int width, height;
+
+private:
+    unsigned int colorBuffer, depthBuffer;
+};
+
+// Records a fixed number of frames: CPU time of the frame (up to the buffer swap), GPU time from
+// GL_TIME_ELAPSED queries, and the draw calls and triangles counted in RenderStats. The report is written as
+// JSON with p50/p95/p99 summaries, plus a CSV with one row per frame next to it.
+//
+//     Benchmark benchmark("report.json", 600, 1.0f / 60.0f);
+//     while (!benchmark.Finished()) {
+//         benchmark.BeginFrame();
+//         // place the camera for benchmark.Progress(), render
+//         benchmark.EndFrame();
+//         glfwSwapBuffers(window);
+//     }
+//     benchmark.WriteReport(renderer);
+class Benchmark
+{
+public:
+    Benchmark(const std::string &reportPath, unsigned int frameCount, float timestep)
+        : reportPath(reportPath), frameCount(frameCount), timestep(timestep), frames(frameCount)
+    {
+        glGenQueries(QUERY_COUNT, queries);
+    }
+
+    ~Benchmark()
+    {
+        glDeleteQueries(QUERY_COUNT, queries);
+    }
+
+    Benchmark(const Benchmark&) = delete;
+    Benchmark& operator=(const Benchmark&) = delete;
+
+    bool Finished() const
+    {
+        return frame >= frameCount;
+    }
+
+    // how far along the recording is, in [0, 1)
+    float Progress() const
+    {
+        return float(frame) / frameCount;
+    }
+
+    // fixed simulation step, independent of how long frames actually take
+    float Timestep() const
+    {
+        return timestep;
+    }
+
+    void BeginFrame()
+    {
+        // the query of this slot was issued QUERY_COUNT frames ago, it is normally done by now
+        unsigned int slot = frame % QUERY_COUNT;
+        if (frame >= QUERY_COUNT)
+            collectQuery(frame - QUERY_COUNT);
+        glBeginQuery(GL_TIME_ELAPSED, queries[slot]);
+        frameStart = std::chrono::steady_clock::now();
+    }
+
+    void EndFrame()
+    {
+        std::chrono::duration<double, std::milli> elapsed = std::chrono::steady_clock::now() - frameStart;
+        glEndQuery(GL_TIME_ELAPSED);
+        Frame &record = frames[frame];
+        record.cpuMs = elapsed.count();
+        record.drawCalls = RenderStats::Frame().drawCalls;
+        record.triangles = RenderStats::Frame().triangles;
+        frame++;
+    }
+
+    // waits for the outstanding GPU timings and writes the JSON report and the CSV next to it
+    bool WriteReport(const std::string &renderer)
+    {
+        for (unsigned int i = frame > QUERY_COUNT ? frame - QUERY_COUNT : 0; i < frame; i++)
+            collectQuery(i);
+
+        std::vector<double> cpu, gpu;
+        for (unsigned int i = 0; i < frame; i++)
+        {
+            cpu.push_back(frames[i].cpuMs);
+            gpu.push_back(frames[i].gpuMs);
+        }
+
+        std::ofstream json(reportPath);
+        if (!json)
+        {
+            std::cout << "ERROR::BENCHMARK:: Can't write " << reportPath << std::endl;
+            return false;
+        }
+        json << "{\n";
+        json << "  \"renderer\": \"" << escape(renderer) << "\",\n";
+        json << "  \"frames\": " << frame << ",\n";
+        json << "  \"timestep\": " << timestep << ",\n";
+        json << "  \"summary\": {\n";
+        writeSummary(json, "cpu_ms", cpu);
+        json << ",\n";
+        writeSummary(json, "gpu_ms", gpu);
+        json << "\n  },\n";
+        json << "  \"per_frame\": [\n";
+        for (unsigned int i = 0; i < frame; i++)
+        {
+            json << "    {\"frame\": " << i << ", \"cpu_ms\": " << frames[i].cpuMs << ", \"gpu_ms\": " << frames[i].gpuMs
+                 << ", \"draw_calls\": " << frames[i].drawCalls << ", \"triangles\": " << frames[i].triangles << "}"
+                 << (i + 1 < frame ? ",\n" : "\n");
+        }
+        json << "  ]\n}\n";
+
+        std::ofstream csv(csvPath());
+        csv << "frame,cpu_ms,gpu_ms,draw_calls,triangles\n";
+        for (unsigned int i = 0; i < frame; i++)
+            csv << i << ',' << frames[i].cpuMs << ',' << frames[i].gpuMs << ',' << frames[i].drawCalls << ',' << frames[i].triangles << '\n';
+
+        std::cout << "Benchmark: " << frame << " frames, cpu p50 " << percentile(cpu, 50.0) << " ms, gpu p50 "
+                  << percentile(gpu, 50.0) << " ms, written to " << reportPath << std::endl;
+        return true;
+    }
+
+    // nearest rank percentile
+    static double percentile(std::vector<double> values, double rank)
+    {
+        if (values.empty())
+            return 0.0;
+        std::sort(values.begin(), values.end());
+        size_t index = (size_t)std::ceil(rank / 100.0 * values.size());
+        return values[std::min(values.size() - 1, index > 0 ? index - 1 : 0)];
+    }
+
+private:
+    static const unsigned int QUERY_COUNT = 4;
+
+    struct Frame {
+        double cpuMs = 0.0;
+        double gpuMs = 0.0;
+        unsigned int drawCalls = 0;
+        unsigned long long triangles = 0;
+    };
+
+    std::string reportPath;
+    unsigned int frameCount;
+    float timestep;
+    unsigned int frame = 0;
+    std::vector<Frame> frames;
+    unsigned int queries[QUERY_COUNT];
+    std::chrono::steady_clock::time_point frameStart;
+
+    void collectQuery(unsigned int queryFrame)
+    {
+        GLuint64 nanoseconds = 0;
+        glGetQueryObjectui64v(queries[queryFrame % QUERY_COUNT], GL_QUERY_RESULT, &nanoseconds);
+        frames[queryFrame].gpuMs = nanoseconds / 1.0e6;
+    }
+
+    std::string csvPath() const
+    {
+        size_t extension = reportPath.rfind(".json");
+        if (extension != std::string::npos && extension + 5 == reportPath.size())
+            return reportPath.substr(0, extension) + ".csv";
+        return reportPath + ".csv";
+    }
+
+    static std::string escape(const std::string &text)
+    {
+        std::string escaped;
+        for (char c : text)
+        {
+            if (c == '"' || c == '\\')
+                escaped += '\\';
+            escaped += c;
+        }
+        return escaped;
+    }
+
+    static void writeSummary(std::ofstream &json, const char *name, const std::vector<double> &values)
+    {
+        double sum = 0.0, maximum = 0.0;
+        for (double value : values)
+        {
+            sum += value;
+            maximum = std::max(maximum, value);
+        }
+        json << "    \"" << name << "\": {\"mean\": " << (values.empty() ? 0.0 : sum / values.size())
+             << ", \"p50\": " << percentile(values, 50.0) << ", \"p95\": " << percentile(values, 95.0)
+             << ", \"p99\": " << percentile(values, 99.0) << ", \"max\": " << maximum << "}";
+    }
+};
+#endif
@@ -0,0 +1,177 @@
+#ifndef BLOCK_COMPRESSION_H
+#define BLOCK_COMPRESSION_H
+
+#include <algorithm>
+#include <cstdint>
+#include <cstring>
+#include <vector>
+
+// CPU encoders for the 4x4 block compressed formats used by the texture baker:
+//
+//     BC1 (DXT1)   8 bytes per block, RGB
+//     BC3 (DXT5)  16 bytes per block, BC4 alpha block followed by a BC1 color block
+//     BC5 (RGTC2) 16 bytes per block, two BC4 blocks for red and green (tangent space normals)
+//
+// The endpoints are the bounding box of the block, inset slightly towards its center, which is fast and good
+// enough for the photo textures of the scene. The input is always tightly packed RGBA8.
+namespace BlockCompression {
+
+// copies the 4x4 block at (blockX, blockY) out of an RGBA8 image, clamping at the border of images whose
+// size isn't a multiple of four (including the 2x2 and 1x1 mip levels)
+inline void FetchBlock(const unsigned char *pixels, int width, int height, int blockX, int blockY, unsigned char block[64])
+{
+    for (int y = 0; y < 4; y++)
+    {
+        int sourceY = std::min(blockY * 4 + y, height - 1);
+        for (int x = 0; x < 4; x++)
+        {
+            int sourceX = std::min(blockX * 4 + x, width - 1);
+            memcpy(block + (y * 4 + x) * 4, pixels + (sourceY * width + sourceX) * 4, 4);
+        }
+    }
+}
+
+inline uint16_t packRGB565(const int color[3])
+{
+    return uint16_t(((color[0] * 31 + 127) / 255) << 11 | ((color[1] * 63 + 127) / 255) << 5 | ((color[2] * 31 + 127) / 255));
+}
+
+inline void unpackRGB565(uint16_t packed, int color[3])
+{
+    int r = (packed >> 11) & 31, g = (packed >> 5) & 63, b = packed & 31;
+    color[0] = (r << 3) | (r >> 2);
+    color[1] = (g << 2) | (g >> 4);
+    color[2] = (b << 3) | (b >> 2);
+}
+
+// 8 byte BC1 color block; always uses the four color mode, which BC3 requires for its color part
+inline void EncodeColorBlock(const unsigned char block[64], unsigned char *out)
+{
+    int minColor[3] = {255, 255, 255}, maxColor[3] = {0, 0, 0};
+    for (int i = 0; i < 16; i++)
+    {
+        for (int c = 0; c < 3; c++)
+        {
+            minColor[c] = std::min(minColor[c], int(block[i * 4 + c]));
+            maxColor[c] = std::max(maxColor[c], int(block[i * 4 + c]));
+        }
+    }
+    for (int c = 0; c < 3; c++)
+    {
+        int inset = (maxColor[c] - minColor[c]) / 16;
+        minColor[c] += inset;
+        maxColor[c] -= inset;
+    }
+
+    uint16_t color0 = packRGB565(maxColor);
+    uint16_t color1 = packRGB565(minColor);
+    if (color0 < color1)
+        std::swap(color0, color1);
+
+    uint32_t indices = 0;
+    if (color0 != color1)
+    {
+        int palette[4][3];
+        unpackRGB565(color0, palette[0]);
+        unpackRGB565(color1, palette[1]);
+        for (int c = 0; c < 3; c++)
+        {
+            palette[2][c] = (2 * palette[0][c] + palette[1][c]) / 3;
+            palette[3][c] = (palette[0][c] + 2 * palette[1][c]) / 3;
+        }
+        for (int i = 0; i < 16; i++)
+        {
+            int best = 0, bestDistance = 1 << 30;
+            for (int p = 0; p < 4; p++)
+            {
+                int distance = 0;
+                for (int c = 0; c < 3; c++)
+                {
+                    int delta = int(block[i * 4 + c]) - palette[p][c];
+                    distance += delta * delta;
+                }
+                if (distance < bestDistance)
+                {
+                    bestDistance = distance;
+                    best = p;
+                }
+            }
+            indices |= uint32_t(best) << (i * 2);
+        }
+    }
+
+    out[0] = color0 & 0xff;
+    out[1] = color0 >> 8;
+    out[2] = color1 & 0xff;
+    out[3] = color1 >> 8;
+    for (int i = 0; i < 4; i++)
+        out[4 + i] = (indices >> (i * 8)) & 0xff;
+}
+
+// 8 byte BC4 block of one channel of the block (0 = red ... 3 = alpha), eight value mode
+inline void EncodeChannelBlock(const unsigned char block[64], int channel, unsigned char *out)
+{
+    int minValue = 255, maxValue = 0;
+    for (int i = 0; i < 16; i++)
+    {
+        minValue = std::min(minValue, int(block[i * 4 + channel]));
+        maxValue = std::max(maxValue, int(block[i * 4 + channel]));
+    }
+
+    uint64_t indices = 0;
+    if (maxValue != minValue)
+    {
+        int range = maxValue - minValue;
+        for (int i = 0; i < 16; i++)
+        {
+            // step 0..7 from the minimum to the maximum; endpoint 0 is the maximum and endpoint 1 the
+            // minimum, the six interpolated values follow from the maximum downwards
+            int step = ((int(block[i * 4 + channel]) - minValue) * 7 + range / 2) / range;
+            uint64_t index = step == 7 ? 0 : step == 0 ? 1 : 8 - step;
+            indices |= index << (i * 3);
+        }
+    }
+
+    out[0] = uint8_t(maxValue);
+    out[1] = uint8_t(minValue);
+    for (int i = 0; i < 6; i++)
+        out[2 + i] = (indices >> (i * 8)) & 0xff;
+}
+
+inline void EncodeBC1Block(const unsigned char block[64], unsigned char *out)
+{
+    EncodeColorBlock(block, out);
+}
+
+inline void EncodeBC3Block(const unsigned char block[64], unsigned char *out)
+{
+    EncodeChannelBlock(block, 3, out);
+    EncodeColorBlock(block, out + 8);
+}
+
+inline void EncodeBC5Block(const unsigned char block[64], unsigned char *out)
+{
+    EncodeChannelBlock(block, 0, out);
+    EncodeChannelBlock(block, 1, out + 8);
+}
+
+// compresses a whole RGBA8 image with one of the block encoders above
+inline std::vector<unsigned char> CompressImage(const unsigned char *pixels, int width, int height, unsigned int blockBytes,
+                                                void (*encodeBlock)(const unsigned char*, unsigned char*))
+{
+    int blocksX = (width + 3) / 4, blocksY = (height + 3) / 4;
+    std::vector<unsigned char> compressed(size_t(blocksX) * blocksY * blockBytes);
+    unsigned char block[64];
+    for (int y = 0; y < blocksY; y++)
+    {
+        for (int x = 0; x < blocksX; x++)
+        {
+            FetchBlock(pixels, width, height, x, y, block);
+            encodeBlock(block, &compressed[(size_t(y) * blocksX + x) * blockBytes]);
+        }
+    }
+    return compressed;
+}
+
+}
+#endif
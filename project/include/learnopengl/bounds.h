@@ -0,0 +1,85 @@
+#ifndef BOUNDS_H
+#define BOUNDS_H
+
+#include <glm/glm.hpp>
+
+#include <algorithm>
+#include <cfloat>
+#include <cmath>
+
+// axis aligned bounding box; starts out empty (min > max) and grows with Expand
+struct BoundingBox {
+    glm::vec3 min = glm::vec3(FLT_MAX);
+    glm::vec3 max = glm::vec3(-FLT_MAX);
+
+    bool Empty() const
+    {
+        return min.x > max.x;
+    }
+
+    void Expand(const glm::vec3 &point)
+    {
+        min = glm::min(min, point);
+        max = glm::max(max, point);
+    }
+
+    void Expand(const BoundingBox &box)
+    {
+        if (box.Empty())
+            return;
+        Expand(box.min);
+        Expand(box.max);
+    }
+
+    glm::vec3 Center() const
+    {
+        return (min + max) * 0.5f;
+    }
+
+    glm::vec3 Extents() const
+    {
+        return (max - min) * 0.5f;
+    }
+
+    // the box around all eight transformed corners
+    BoundingBox Transformed(const glm::mat4 &transform) const
+    {
+        BoundingBox result;
+        if (Empty())
+            return result;
+        for (int corner = 0; corner < 8; corner++)
+        {
+            glm::vec3 point(corner & 1 ? max.x : min.x, corner & 2 ? max.y : min.y, corner & 4 ? max.z : min.z);
+            result.Expand(glm::vec3(transform * glm::vec4(point, 1.0f)));
+        }
+        return result;
+    }
+};
+
+struct BoundingSphere {
+    glm::vec3 center = glm::vec3(0.0f);
+    float radius = 0.0f;
+
+    // the sphere around the transformed sphere; non-uniform scales grow it by the largest axis
+    BoundingSphere Transformed(const glm::mat4 &transform) const
+    {
+        BoundingSphere result;
+        result.center = glm::vec3(transform * glm::vec4(center, 1.0f));
+        float scale = std::max(glm::length(glm::vec3(transform[0])),
+                               std::max(glm::length(glm::vec3(transform[1])), glm::length(glm::vec3(transform[2]))));
+        result.radius = radius * scale;
+        return result;
+    }
+};
+
+// sphere centered on the box, enclosing it
+inline BoundingSphere SphereAround(const BoundingBox &box)
+{
+    BoundingSphere sphere;
+    if (box.Empty())
+        return sphere;
+    sphere.center = box.Center();
+    sphere.radius = glm::length(box.Extents());
+    return sphere;
+}
+#endif
@@ -5,6 +5,9 @@
 #include <glm/glm.hpp>
 #include <glm/gtc/matrix_transform.hpp>
 
+#include <learnopengl/frustum.h>
+
+#include <cfloat>
 #include <vector>
 
 // Defines several possible options for camera movement. Used as abstraction to stay away from window-system specific input methods
@@ -66,6 +69,31 @@ public:
         return glm::lookAt(Position, Position + Front, Up);
     }
 
+    // the view frustum for the given projection, used to skip objects the camera can't see
+    Frustum GetFrustum(const glm::mat4 &projection)
+    {
+        return Frustum(projection * GetViewMatrix());
+    }
+
+    // height of sphere on screen as a fraction of the viewport height, 1 when it just fills the view vertically.
+    // Used to pick levels of detail, see LodSelector
+    float ScreenCoverage(const BoundingSphere &sphere, const glm::mat4 &projection) const
+    {
+        float distance = glm::length(sphere.center - Position);
+        if (distance <= sphere.radius)
+            return FLT_MAX;
+        return sphere.radius * projection[1][1] / distance;
+    }
+
+    // turns the camera towards target, e.g. while it is flown along a scripted path
+    void LookAt(const glm::vec3 &target)
+    {
+        glm::vec3 direction = glm::normalize(target - Position);
+        Pitch = glm::degrees(asin(direction.y));
+        Yaw = glm::degrees(atan2(direction.z, direction.x));
+        updateCameraVectors();
+    }
+
     // processes input received from any keyboard-like input system. Accepts input parameter in the form of camera defined ENUM (to abstract it from windowing systems)
     void ProcessKeyboard(Camera_Movement direction, float deltaTime)
     {
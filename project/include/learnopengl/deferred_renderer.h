@@ -0,0 +1,189 @@
+#ifndef DEFERRED_RENDERER_H
+#define DEFERRED_RENDERER_H
+
+#include <glad/glad.h>
+
+#include <glm/glm.hpp>
+
+#include <learnopengl/gl_state.h>
+#include <learnopengl/render_stats.h>
+#include <learnopengl/shader.h>
+
+#include <iostream>
+
+// texture units of the gAlbedo, gNormal, gSpecular and gDepth samplers of deferred_lighting.fs, in that order
+const unsigned int GBUFFER_UNIT = 0;
+
+// Deferred shading, the alternative to lighting every material in its own shader: the materials are compiled
+// with GBUFFER and write what lighting needs into the G-buffer, then one full screen pass of
+// deferred_lighting.fs lights every pixel once, however many layers were drawn over it.
+//
+//     gAlbedo    RGBA8     albedo
+//     gNormal    RG16F     world space normal, octahedral encoding
+//     gSpecular  RGBA8     specular color, shininess / 256 in alpha
+//     gDepth     DEPTH24   world positions are rebuilt from it
+//
+//     deferred.BeginGeometry();                    // before the opaque draws, binds and clears the G-buffer
+//     // the opaque and depth prepass draws, with the GBUFFER shaders
+//     deferred.Light(inverse(projection * view));  // lights into the framebuffer bound at BeginGeometry
+//     // the sky, the lighting pass wrote the scene's depth for it
+//
+// The encoding is in resources/shaders/gbuffer.glsl. Lighting calls the same lighting.glsl as the forward
+// shaders, so both paths give the same picture.
+class DeferredRenderer
+{
+public:
+    // GPU time of the last timed frame; arrives a frame or two late
+    struct Stats {
+        double geometryMs = 0.0;
+        double lightingMs = 0.0;
+    };
+
+    DeferredRenderer(unsigned int width, unsigned int height, Shader &lightingShader)
+        : width(width), height(height), lightingShader(lightingShader)
+    {
+        GLStateCache &state = GLStateCache::Instance();
+        glGenTextures(4, textures);
+        glGenFramebuffers(1, &FBO);
+        allocate();
+        glBindFramebuffer(GL_FRAMEBUFFER, FBO);
+        for (unsigned int i = 0; i < 4; i++)
+        {
+            state.EditTexture(0, GL_TEXTURE_2D, textures[i]);
+            // read one texel per pixel, never filtered
+            glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
+            glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
+            glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+            glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+            glFramebufferTexture2D(GL_FRAMEBUFFER, i < 3 ? GL_COLOR_ATTACHMENT0 + i : GL_DEPTH_ATTACHMENT, GL_TEXTURE_2D, textures[i], 0);
+        }
+        const GLenum drawBuffers[3] = {GL_COLOR_ATTACHMENT0, GL_COLOR_ATTACHMENT1, GL_COLOR_ATTACHMENT2};
+        glDrawBuffers(3, drawBuffers);
+        if (glCheckFramebufferStatus(GL_FRAMEBUFFER) != GL_FRAMEBUFFER_COMPLETE)
+            std::cout << "ERROR::FRAMEBUFFER:: G-buffer is not complete!" << std::endl;
+        glBindFramebuffer(GL_FRAMEBUFFER, 0);
+
+        // the full screen triangle of fullscreen.vs, drawn with an empty VAO like the Hi-Z downsampling
+        glGenVertexArrays(1, &emptyVAO);
+        glGenQueries(3, queries);
+
+        lightingShader.use();
+        lightingShader.setInt("gAlbedo", GBUFFER_UNIT);
+        lightingShader.setInt("gNormal", GBUFFER_UNIT + 1);
+        lightingShader.setInt("gSpecular", GBUFFER_UNIT + 2);
+        lightingShader.setInt("gDepth", GBUFFER_UNIT + 3);
+        inverseViewProjection = lightingShader.getUniform("inverseViewProjection");
+    }
+
+    ~DeferredRenderer()
+    {
+        for (unsigned int texture : textures)
+            GLStateCache::Instance().ForgetTexture(texture);
+        glDeleteTextures(4, textures);
+        glDeleteFramebuffers(1, &FBO);
+        glDeleteVertexArrays(1, &emptyVAO);
+        glDeleteQueries(3, queries);
+    }
+
+    DeferredRenderer(const DeferredRenderer&) = delete;
+    DeferredRenderer& operator=(const DeferredRenderer&) = delete;
+
+    // remembers the bound framebuffer and viewport for Light, then binds and clears the G-buffer. The G-buffer
+    // follows the viewport's size, so a resized window is lit pixel for pixel
+    void BeginGeometry()
+    {
+        collectTimings();
+        timed = !timing;
+        if (timed)
+            glQueryCounter(queries[0], GL_TIMESTAMP);
+
+        glGetIntegerv(GL_FRAMEBUFFER_BINDING, &targetFramebuffer);
+        glGetIntegerv(GL_VIEWPORT, targetViewport);
+        // a minimized window has an empty viewport, the old storage is kept for it
+        bool resized = (unsigned int)targetViewport[2] != width || (unsigned int)targetViewport[3] != height;
+        if (resized && targetViewport[2] > 0 && targetViewport[3] > 0)
+        {
+            width = targetViewport[2];
+            height = targetViewport[3];
+            allocate();
+        }
+        glBindFramebuffer(GL_FRAMEBUFFER, FBO);
+        glViewport(0, 0, width, height);
+        GLStateCache::Instance().DepthMask(true);
+        GLStateCache::Instance().ColorMask(true);
+        glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
+    }
+
+    // lights the G-buffer into the framebuffer bound at BeginGeometry. Pixels nothing was drawn on are left
+    // alone, the others get the G-buffer's depth, so expects depth writes on with GL_ALWAYS
+    void Light(const glm::mat4 &inverseViewProjectionMatrix)
+    {
+        if (timed)
+            glQueryCounter(queries[1], GL_TIMESTAMP);
+        glBindFramebuffer(GL_FRAMEBUFFER, targetFramebuffer);
+        glViewport(targetViewport[0], targetViewport[1], targetViewport[2], targetViewport[3]);
+
+        GLStateCache &state = GLStateCache::Instance();
+        for (unsigned int i = 0; i < 4; i++)
+            state.BindTexture(GBUFFER_UNIT + i, GL_TEXTURE_2D, textures[i]);
+        lightingShader.use();
+        lightingShader.setMat4(inverseViewProjection, inverseViewProjectionMatrix);
+        state.BindVertexArray(emptyVAO);
+        glDrawArrays(GL_TRIANGLES, 0, 3);
+        RenderStats::Frame().CountDraw(1);
+
+        if (timed)
+        {
+            glQueryCounter(queries[2], GL_TIMESTAMP);
+            timing = true;
+        }
+    }
+
+    const Stats &LastStats() const
+    {
+        return stats;
+    }
+
+private:
+    unsigned int width, height;
+    Shader &lightingShader;
+    UniformHandle inverseViewProjection;
+    unsigned int FBO = 0, emptyVAO = 0;
+    unsigned int textures[4];
+    GLint targetFramebuffer = 0, targetViewport[4] = {0, 0, 0, 0};
+    // GL_TIMESTAMP at BeginGeometry, at Light and after it, as in ShadowMap
+    unsigned int queries[3];
+    bool timed = false, timing = false;
+    Stats stats;
+
+    // (re)creates the storage of the four attachments at width x height
+    void allocate()
+    {
+        const GLenum internalFormats[4] = {GL_RGBA8, GL_RG16F, GL_RGBA8, GL_DEPTH_COMPONENT24};
+        const GLenum formats[4] = {GL_RGBA, GL_RG, GL_RGBA, GL_DEPTH_COMPONENT};
+        for (unsigned int i = 0; i < 4; i++)
+        {
+            GLStateCache::Instance().EditTexture(0, GL_TEXTURE_2D, textures[i]);
+            glTexImage2D(GL_TEXTURE_2D, 0, internalFormats[i], width, height, 0, formats[i], GL_FLOAT, nullptr);
+        }
+    }
+
+    // reads back the timestamps once they are ready, without waiting for them
+    void collectTimings()
+    {
+        if (!timing)
+            return;
+        GLint available = 0;
+        glGetQueryObjectiv(queries[2], GL_QUERY_RESULT_AVAILABLE, &available);
+        if (!available)
+            return;
+        GLuint64 begin = 0, lighting = 0, end = 0;
+        glGetQueryObjectui64v(queries[0], GL_QUERY_RESULT, &begin);
+        glGetQueryObjectui64v(queries[1], GL_QUERY_RESULT, &lighting);
+        glGetQueryObjectui64v(queries[2], GL_QUERY_RESULT, &end);
+        stats.geometryMs = (lighting - begin) / 1.0e6;
+        stats.lightingMs = (end - lighting) / 1.0e6;
+        timing = false;
+    }
+};
+#endif
@@ -0,0 +1,84 @@
+#ifndef FRAME_UNIFORMS_H
+#define FRAME_UNIFORMS_H
+
+#include <glad/glad.h>
+
+#include <glm/glm.hpp>
+
+#define NR_POINT_LIGHTS 2
+
+// binding point of the FrameUniforms block, every shader's block index is attached to it
+const unsigned int FRAME_UNIFORMS_BINDING = 0;
+
+// The structs below mirror the std140 layout of the FrameUniforms block in resources/shaders/frame_uniforms.glsl.
+// std140 aligns every vec3 to 16 bytes, so the light structs either pad each vec3 or pack a float into
+// the free slot after it. Keep both sides in sync when changing either of them.
+struct DirLightStd140 {
+    glm::vec3 direction;
+    float pad0;
+    glm::vec3 ambient;
+    float pad1;
+    glm::vec3 diffuse;
+    float pad2;
+    glm::vec3 specular;
+    float pad3;
+};
+
+struct PointLightStd140 {
+    glm::vec3 position;
+    float constant;
+    glm::vec3 ambient;
+    float linear;
+    glm::vec3 diffuse;
+    float quadratic;
+    glm::vec3 specular;
+    float radius; // unused by FrameUniforms, the light range in the clustered light list (see LightClusters)
+};
+
+struct FrameUniforms {
+    glm::mat4 projection;
+    glm::mat4 view;
+    glm::vec3 viewPos;
+    int day; // GLSL bool, 4 bytes in std140
+    DirLightStd140 dirLight;
+    PointLightStd140 pointLights[NR_POINT_LIGHTS];
+};
+
+static_assert(sizeof(DirLightStd140) == 64, "DirLight does not match the std140 layout");
+static_assert(sizeof(PointLightStd140) == 64, "PointLight does not match the std140 layout");
+static_assert(sizeof(FrameUniforms) == 208 + NR_POINT_LIGHTS * 64, "FrameUniforms does not match the std140 layout");
+
+// Uniform buffer holding the camera and the lights for the whole frame. It is filled once per frame and read
+// by every shader through the FrameUniforms block instead of setting the same uniforms on each program.
+class FrameUniformBuffer
+{
+public:
+    FrameUniformBuffer()
+    {
+        glGenBuffers(1, &UBO);
+        glBindBuffer(GL_UNIFORM_BUFFER, UBO);
+        glBufferData(GL_UNIFORM_BUFFER, sizeof(FrameUniforms), NULL, GL_DYNAMIC_DRAW);
+        glBindBuffer(GL_UNIFORM_BUFFER, 0);
+        glBindBufferBase(GL_UNIFORM_BUFFER, FRAME_UNIFORMS_BINDING, UBO);
+    }
+
+    ~FrameUniformBuffer()
+    {
+        glDeleteBuffers(1, &UBO);
+    }
+
+    FrameUniformBuffer(const FrameUniformBuffer&) = delete;
+    FrameUniformBuffer& operator=(const FrameUniformBuffer&) = delete;
+
+    // uploads the whole block with a single call
+    void Update(const FrameUniforms &data)
+    {
+        glBindBuffer(GL_UNIFORM_BUFFER, UBO);
+        glBufferSubData(GL_UNIFORM_BUFFER, 0, sizeof(FrameUniforms), &data);
+        glBindBuffer(GL_UNIFORM_BUFFER, 0);
+    }
+
+private:
+    unsigned int UBO = 0;
+};
+#endif
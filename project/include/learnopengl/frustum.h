@@ -0,0 +1,242 @@
+#ifndef FRUSTUM_H
+#define FRUSTUM_H
+
+#include <glm/glm.hpp>
+
+#include <learnopengl/bounds.h>
+#include <learnopengl/instance_data.h>
+#include <learnopengl/lod.h>
+
+#include <algorithm>
+#include <cfloat>
+#include <vector>
+
+// The six planes of a view frustum, extracted from a projection * view matrix (Gribb & Hartmann). Every plane
+// is stored as (normal, distance) with the normal pointing inwards and normalized, so dot(normal, p) + distance
+// is the signed distance of p from the plane.
+class Frustum
+{
+public:
+    enum Plane { LEFT_PLANE, RIGHT_PLANE, BOTTOM_PLANE, TOP_PLANE, NEAR_PLANE, FAR_PLANE, PLANE_COUNT };
+    glm::vec4 planes[PLANE_COUNT];
+
+    Frustum() = default;
+
+    explicit Frustum(const glm::mat4 &viewProjection)
+    {
+        // glm matrices are column major, row i is (m[0][i], m[1][i], m[2][i], m[3][i])
+        glm::vec4 rows[4];
+        for (int i = 0; i < 4; i++)
+            rows[i] = glm::vec4(viewProjection[0][i], viewProjection[1][i], viewProjection[2][i], viewProjection[3][i]);
+        planes[LEFT_PLANE] = rows[3] + rows[0];
+        planes[RIGHT_PLANE] = rows[3] - rows[0];
+        planes[BOTTOM_PLANE] = rows[3] + rows[1];
+        planes[TOP_PLANE] = rows[3] - rows[1];
+        planes[NEAR_PLANE] = rows[3] + rows[2];
+        planes[FAR_PLANE] = rows[3] - rows[2];
+        for (glm::vec4 &plane : planes)
+            plane = plane / glm::length(glm::vec3(plane));
+    }
+
+    // false only when the sphere lies completely outside one of the planes
+    bool Intersects(const BoundingSphere &sphere) const
+    {
+        for (const glm::vec4 &plane : planes)
+        {
+            if (glm::dot(glm::vec3(plane), sphere.center) + plane.w < -sphere.radius)
+                return false;
+        }
+        return true;
+    }
+
+    // false only when the box lies completely outside one of the planes
+    bool Intersects(const BoundingBox &box) const
+    {
+        for (const glm::vec4 &plane : planes)
+        {
+            // the corner farthest along the plane normal
+            glm::vec3 corner(plane.x >= 0.0f ? box.max.x : box.min.x,
+                             plane.y >= 0.0f ? box.max.y : box.min.y,
+                             plane.z >= 0.0f ? box.max.z : box.min.z);
+            if (glm::dot(glm::vec3(plane), corner) + plane.w < 0.0f)
+                return false;
+        }
+        return true;
+    }
+};
+
+// Bounding spheres in structure of arrays layout. Culling runs plane by plane over plain float arrays, a loop
+// without branches that the compiler turns into SIMD code.
+class SphereSet
+{
+public:
+    void Add(const BoundingSphere &sphere)
+    {
+        x.push_back(sphere.center.x);
+        y.push_back(sphere.center.y);
+        z.push_back(sphere.center.z);
+        radius.push_back(sphere.radius);
+    }
+
+    unsigned int Size() const
+    {
+        return x.size();
+    }
+
+    BoundingSphere Get(unsigned int index) const
+    {
+        BoundingSphere sphere;
+        sphere.center = glm::vec3(x[index], y[index], z[index]);
+        sphere.radius = radius[index];
+        return sphere;
+    }
+
+    // replaces visible with the indices of the spheres intersecting the frustum
+    void Cull(const Frustum &frustum, std::vector<unsigned int> &visible) const
+    {
+        unsigned int count = Size();
+        // smallest signed distance of each sphere surface to any plane, negative once it is outside one
+        distance.assign(count, FLT_MAX);
+        const float *px = x.data(), *py = y.data(), *pz = z.data(), *pr = radius.data();
+        float *pd = distance.data();
+        for (const glm::vec4 &plane : frustum.planes)
+        {
+            const float nx = plane.x, ny = plane.y, nz = plane.z, nw = plane.w;
+            for (unsigned int i = 0; i < count; i++)
+                pd[i] = std::min(pd[i], nx * px[i] + ny * py[i] + nz * pz[i] + nw + pr[i]);
+        }
+
+        visible.clear();
+        for (unsigned int i = 0; i < count; i++)
+        {
+            if (pd[i] >= 0.0f)
+                visible.push_back(i);
+        }
+    }
+
+private:
+    std::vector<float> x, y, z, radius;
+    mutable std::vector<float> distance; // scratch space, kept to avoid allocating every frame
+};
+
+// how many objects the culling let through this frame and how many it rejected, occluded ones counted apart
+struct CullStats {
+    unsigned int submitted = 0;
+    unsigned int culled = 0;
+    unsigned int occluded = 0;
+
+    void Reset()
+    {
+        submitted = culled = occluded = 0;
+    }
+
+    void Count(unsigned int visible, unsigned int total)
+    {
+        submitted += visible;
+        culled += total - visible;
+    }
+};
+
+// Static instances of one model: their world space spheres and normal matrices are computed once, and every
+// frame Cull returns the instances inside the frustum, ready for Model::DrawInstanced. SelectLods then splits
+// them by level of detail, each instance keeping its level from frame to frame.
+class InstanceList
+{
+public:
+    InstanceList(const std::vector<glm::mat4> &transforms, const BoundingSphere &modelSphere)
+    {
+        BuildInstanceData(transforms, instances);
+        for (const glm::mat4 &transform : transforms)
+        {
+            spheres.Add(modelSphere.Transformed(transform));
+            uniformScale = uniformScale && IsUniformScale(transform);
+        }
+        visibleInstances.reserve(instances.size());
+        lods.assign(instances.size(), 0);
+    }
+
+    const std::vector<InstanceData> &Cull(const Frustum &frustum, CullStats &stats)
+    {
+        spheres.Cull(frustum, visible);
+        visibleInstances.clear();
+        for (unsigned int index : visible)
+            visibleInstances.push_back(instances[index]);
+        stats.Count(visible.size(), instances.size());
+        return visibleInstances;
+    }
+
+    // appends the spheres of the instances the last Cull let through, in the same order
+    void VisibleSpheres(std::vector<BoundingSphere> &out) const
+    {
+        for (unsigned int index : visible)
+            out.push_back(spheres.Get(index));
+    }
+
+    // drops the instances the last Cull let through for which occluded(i) is true, i being their position in
+    // VisibleSpheres; returns the remaining instances
+    template <class Occluded>
+    const std::vector<InstanceData> &RemoveOccluded(Occluded occluded, CullStats &stats)
+    {
+        unsigned int kept = 0;
+        for (unsigned int i = 0; i < visible.size(); i++)
+        {
+            if (occluded(i))
+                continue;
+            visible[kept] = visible[i];
+            visibleInstances[kept] = visibleInstances[i];
+            kept++;
+        }
+        unsigned int removed = visible.size() - kept;
+        visible.resize(kept);
+        visibleInstances.resize(kept);
+        stats.submitted -= removed;
+        stats.occluded += removed;
+        return visibleInstances;
+    }
+
+    // splits the instances the last Cull let through by level of detail, out of lodCount levels, plus
+    // IMPOSTOR_LOD when the model has an impostor. coverage maps a world space sphere to its screen coverage
+    // (Camera::ScreenCoverage)
+    template <class Coverage>
+    void SelectLods(const LodSelector &selector, unsigned int lodCount, Coverage coverage, LodStats &stats, bool impostor = false)
+    {
+        for (std::vector<InstanceData> &list : lodInstances)
+            list.clear();
+        lodCount = std::min(lodCount, MAX_LODS);
+        for (unsigned int index : visible)
+        {
+            float size = coverage(spheres.Get(index));
+            lods[index] = impostor ? selector.SelectWithImpostor(size, lods[index], lodCount) : selector.Select(size, lods[index], lodCount);
+            lodInstances[lods[index]].push_back(instances[index]);
+            stats.instances[lods[index]]++;
+        }
+    }
+
+    // the visible instances SelectLods put at level lod, IMPOSTOR_LOD included
+    const std::vector<InstanceData> &LodInstances(unsigned int lod) const
+    {
+        return lodInstances[lod];
+    }
+
+    // every instance, visible or not
+    const std::vector<InstanceData> &Instances() const
+    {
+        return instances;
+    }
+
+    // true when no instance is scaled non-uniformly, the shader can use mat3(model) for the normals then
+    bool UniformScale() const
+    {
+        return uniformScale;
+    }
+
+private:
+    std::vector<InstanceData> instances;
+    bool uniformScale = true;
+    SphereSet spheres;
+    std::vector<unsigned int> visible;
+    std::vector<InstanceData> visibleInstances;
+    std::vector<unsigned int> lods; // level of every instance, kept while it is out of view
+    std::vector<InstanceData> lodInstances[MAX_LODS + 1];
+};
+#endif
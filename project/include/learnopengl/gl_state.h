@@ -0,0 +1,208 @@
+#ifndef GL_STATE_H
+#define GL_STATE_H
+
+#include <glad/glad.h>
+
+#include <cstdint>
+#include <unordered_map>
+
+// Shadow copy of the GL state the renderer changes every frame: bound program, vertex array, the texture bound
+// to each target of each unit, sampler uniforms, depth function, depth and color write masks and face culling. A call that wouldn't change
+// anything is skipped, every call is counted as issued or elided.
+//
+// The cache only knows about calls made through it. Code that changes this state directly (texture uploads,
+// ImGui) has to be followed by Invalidate, after which the next call of each kind is issued unconditionally.
+class GLStateCache
+{
+public:
+    static const unsigned int MAX_TEXTURE_UNITS = 32;
+
+    struct Counters {
+        unsigned int issued = 0;
+        unsigned int elided = 0;
+    };
+
+    static GLStateCache &Instance()
+    {
+        static GLStateCache cache;
+        return cache;
+    }
+
+    GLStateCache(const GLStateCache&) = delete;
+    GLStateCache& operator=(const GLStateCache&) = delete;
+
+    void UseProgram(GLuint program)
+    {
+        if(changed(currentProgram, program))
+            glUseProgram(program);
+    }
+
+    void BindVertexArray(GLuint vertexArray)
+    {
+        if(changed(currentVertexArray, vertexArray))
+            glBindVertexArray(vertexArray);
+    }
+
+    // binds texture to target on the given unit, making that unit active only if something has to be bound
+    void BindTexture(unsigned int unit, GLenum target, GLuint texture)
+    {
+        int slot = targetSlot(target);
+        if(unit >= MAX_TEXTURE_UNITS || slot < 0)
+        {
+            activeTexture(unit);
+            glBindTexture(target, texture);
+            counters.issued++;
+            return;
+        }
+        if(textures[unit][slot] == texture)
+        {
+            counters.elided++;
+            return;
+        }
+        activeTexture(unit);
+        textures[unit][slot] = texture;
+        glBindTexture(target, texture);
+        counters.issued++;
+    }
+
+    // binds texture like BindTexture and also makes unit active, for glTex* calls that edit the texture
+    void EditTexture(unsigned int unit, GLenum target, GLuint texture)
+    {
+        activeTexture(unit);
+        BindTexture(unit, target, texture);
+    }
+
+    // sets a sampler uniform of the bound program; the value is remembered per program and location
+    void SetSampler(GLint location, int unit)
+    {
+        if(location < 0)
+            return;
+        uint64_t key = (uint64_t)currentProgram << 32 | (uint32_t)location;
+        auto it = samplers.find(key);
+        if(currentProgram != UNKNOWN && it != samplers.end() && it->second == unit)
+        {
+            counters.elided++;
+            return;
+        }
+        samplers[key] = unit;
+        glUniform1i(location, unit);
+        counters.issued++;
+    }
+
+    void DepthFunc(GLenum func)
+    {
+        if(changed(depthFunc, func))
+            glDepthFunc(func);
+    }
+
+    void DepthMask(bool enabled)
+    {
+        if(changed(depthMask, enabled ? 1u : 0u))
+            glDepthMask(enabled ? GL_TRUE : GL_FALSE);
+    }
+
+    // all four channels at once, the renderer never masks them separately
+    void ColorMask(bool enabled)
+    {
+        if(changed(colorMask, enabled ? 1u : 0u))
+        {
+            GLboolean mask = enabled ? GL_TRUE : GL_FALSE;
+            glColorMask(mask, mask, mask, mask);
+        }
+    }
+
+    void CullFace(GLenum mode)
+    {
+        if(changed(cullFace, mode))
+            glCullFace(mode);
+    }
+
+    void SetCulling(bool enabled)
+    {
+        if(changed(culling, enabled ? 1u : 0u))
+            enabled ? glEnable(GL_CULL_FACE) : glDisable(GL_CULL_FACE);
+    }
+
+    // a deleted texture is unbound from every unit by GL, and its name may be handed out again
+    void ForgetTexture(GLuint texture)
+    {
+        for(auto &unit : textures)
+        {
+            for(GLuint &bound : unit)
+            {
+                if(bound == texture)
+                    bound = UNKNOWN;
+            }
+        }
+    }
+
+    // forgets everything, the state was changed behind the cache's back
+    void Invalidate()
+    {
+        currentProgram = currentVertexArray = activeUnit = UNKNOWN;
+        depthFunc = depthMask = colorMask = cullFace = culling = UNKNOWN;
+        for(auto &unit : textures)
+        {
+            for(GLuint &bound : unit)
+                bound = UNKNOWN;
+        }
+        // sampler values live in the programs and survive anything but relinking, they are kept
+    }
+
+    const Counters &Frame() const
+    {
+        return counters;
+    }
+
+    void ResetCounters()
+    {
+        counters = Counters();
+    }
+
+private:
+    static const GLuint UNKNOWN = ~0u;
+    static const int TARGET_COUNT = 4;
+
+    GLuint currentProgram, currentVertexArray, activeUnit;
+    GLuint depthFunc, depthMask, colorMask, cullFace, culling;
+    GLuint textures[MAX_TEXTURE_UNITS][TARGET_COUNT];
+    std::unordered_map<uint64_t, int> samplers;
+    Counters counters;
+
+    GLStateCache()
+    {
+        Invalidate();
+    }
+
+    // updates the shadowed value, true when the GL call has to be made
+    bool changed(GLuint &current, GLuint value)
+    {
+        if(current == value)
+        {
+            counters.elided++;
+            return false;
+        }
+        current = value;
+        counters.issued++;
+        return true;
+    }
+
+    void activeTexture(unsigned int unit)
+    {
+        if(changed(activeUnit, unit))
+            glActiveTexture(GL_TEXTURE0 + unit);
+    }
+
+    static int targetSlot(GLenum target)
+    {
+        switch(target)
+        {
+        case GL_TEXTURE_2D: return 0;
+        case GL_TEXTURE_CUBE_MAP: return 1;
+        case GL_TEXTURE_2D_ARRAY: return 2;
+        case GL_TEXTURE_BUFFER: return 3;
+        default: return -1;
+        }
+    }
+};
+#endif
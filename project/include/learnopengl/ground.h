@@ -0,0 +1,136 @@
+#ifndef GROUND_H
+#define GROUND_H
+
+#include <glad/glad.h>
+
+#include <glm/glm.hpp>
+
+#include <learnopengl/mesh.h>
+
+#include <vector>
+
+// A flat, normal mapped rectangle in the xy plane (facing +z) used for the grass plane and the stone path.
+// The geometry is generated and uploaded once in the constructor and owned by the object, so drawing it every
+// frame costs a single bind and draw call. For larger terrains the rectangle can be split into tiles x tiles
+// cells; every power of two coarser grid is kept as an extra level of detail in the same vertex buffer.
+class GroundQuad
+{
+public:
+    // min/max are the rectangle corners, uvRepeat the texture coordinates reached at the max corner
+    GroundQuad(glm::vec2 min, glm::vec2 max, glm::vec2 uvRepeat, float height = 0.0f, unsigned int tiles = 1)
+    {
+        // the texture coordinates are a linear function of the position, so one tangent frame is exact for the whole quad
+        glm::vec3 edge1(max.x - min.x, 0.0f, 0.0f);
+        glm::vec3 edge2(0.0f, max.y - min.y, 0.0f);
+        glm::vec2 deltaUV1(uvRepeat.x, 0.0f);
+        glm::vec2 deltaUV2(0.0f, uvRepeat.y);
+
+        float f = 1.0f / (deltaUV1.x * deltaUV2.y - deltaUV2.x * deltaUV1.y);
+        glm::vec3 tangent = glm::normalize(f * (deltaUV2.y * edge1 - deltaUV1.y * edge2));
+        glm::vec3 bitangent = glm::normalize(f * (-deltaUV2.x * edge1 + deltaUV1.x * edge2));
+
+        tiles = tiles == 0 ? 1 : tiles;
+        vector<Vertex> vertices;
+        for(unsigned int j = 0; j <= tiles; j++)
+        {
+            for(unsigned int i = 0; i <= tiles; i++)
+            {
+                glm::vec2 t((float)i / tiles, (float)j / tiles);
+                Vertex vertex;
+                vertex.Position = glm::vec3(min.x + t.x * (max.x - min.x), min.y + t.y * (max.y - min.y), height);
+                vertex.Normal = glm::vec3(0.0f, 0.0f, 1.0f);
+                vertex.TexCoords = t * uvRepeat;
+                vertex.Tangent = tangent;
+                vertex.Bitangent = bitangent;
+                vertices.push_back(vertex);
+            }
+        }
+
+        // level 0 uses every grid line, each further level skips every other line of the previous one
+        vector<unsigned int> indices;
+        for(unsigned int step = 1; step <= tiles && tiles % step == 0; step *= 2)
+        {
+            Lod lod;
+            lod.offset = indices.size();
+            for(unsigned int j = 0; j < tiles; j += step)
+            {
+                for(unsigned int i = 0; i < tiles; i += step)
+                {
+                    unsigned int bottomLeft = j * (tiles + 1) + i;
+                    unsigned int bottomRight = bottomLeft + step;
+                    unsigned int topLeft = bottomLeft + step * (tiles + 1);
+                    unsigned int topRight = topLeft + step;
+
+                    indices.push_back(topLeft);
+                    indices.push_back(bottomLeft);
+                    indices.push_back(bottomRight);
+
+                    indices.push_back(topLeft);
+                    indices.push_back(bottomRight);
+                    indices.push_back(topRight);
+                }
+            }
+            lod.count = indices.size() - lod.offset;
+            lods.push_back(lod);
+        }
+
+        glGenVertexArrays(1, &VAO);
+        glGenBuffers(1, &VBO);
+        glGenBuffers(1, &EBO);
+
+        GLStateCache::Instance().BindVertexArray(VAO);
+        glBindBuffer(GL_ARRAY_BUFFER, VBO);
+        glBufferData(GL_ARRAY_BUFFER, vertices.size() * sizeof(Vertex), &vertices[0], GL_STATIC_DRAW);
+        glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, EBO);
+        glBufferData(GL_ELEMENT_ARRAY_BUFFER, indices.size() * sizeof(unsigned int), &indices[0], GL_STATIC_DRAW);
+
+        glEnableVertexAttribArray(0);
+        glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, sizeof(Vertex), (void*)0);
+        glEnableVertexAttribArray(1);
+        glVertexAttribPointer(1, 3, GL_FLOAT, GL_FALSE, sizeof(Vertex), (void*)offsetof(Vertex, Normal));
+        glEnableVertexAttribArray(2);
+        glVertexAttribPointer(2, 2, GL_FLOAT, GL_FALSE, sizeof(Vertex), (void*)offsetof(Vertex, TexCoords));
+        glEnableVertexAttribArray(3);
+        glVertexAttribPointer(3, 3, GL_FLOAT, GL_FALSE, sizeof(Vertex), (void*)offsetof(Vertex, Tangent));
+        glEnableVertexAttribArray(4);
+        glVertexAttribPointer(4, 3, GL_FLOAT, GL_FALSE, sizeof(Vertex), (void*)offsetof(Vertex, Bitangent));
+
+        GLStateCache::Instance().BindVertexArray(0);
+    }
+
+    ~GroundQuad()
+    {
+        glDeleteVertexArrays(1, &VAO);
+        glDeleteBuffers(1, &VBO);
+        glDeleteBuffers(1, &EBO);
+    }
+
+    // the object owns GL handles, copying it would delete them twice
+    GroundQuad(const GroundQuad&) = delete;
+    GroundQuad& operator=(const GroundQuad&) = delete;
+
+    // number of available levels of detail, level 0 being the full resolution grid
+    unsigned int LodCount() const
+    {
+        return lods.size();
+    }
+
+    void Draw(unsigned int lod = 0)
+    {
+        if(lod >= lods.size())
+            lod = lods.size() - 1;
+        GLStateCache::Instance().BindVertexArray(VAO);
+        glDrawElements(GL_TRIANGLES, lods[lod].count, GL_UNSIGNED_INT, (void*)(lods[lod].offset * sizeof(unsigned int)));
+        RenderStats::Frame().CountDraw(lods[lod].count / 3);
+    }
+
+private:
+    struct Lod {
+        size_t offset;
+        size_t count;
+    };
+
+    unsigned int VAO = 0, VBO = 0, EBO = 0;
+    vector<Lod> lods;
+};
+#endif
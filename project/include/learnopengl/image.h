@@ -0,0 +1,35 @@
+#ifndef IMAGE_H
+#define IMAGE_H
+
+#include <stb_image.h>
+
+#include <iostream>
+#include <memory>
+#include <string>
+#include <vector>
+
+// Decoded pixels of an image file. Decoding doesn't touch OpenGL, so it can run on a worker thread; the pixels
+// are turned into an uploadable TextureData by the texture baker (see learnopengl/texture_bake.h).
+struct ImageData {
+    int width = 0;
+    int height = 0;
+    int channels = 0;
+    std::shared_ptr<unsigned char> pixels; // released with stbi_image_free once the last copy is gone
+
+    bool Valid() const
+    {
+        return pixels != nullptr;
+    }
+};
+
+inline ImageData DecodeImage(const std::string &path)
+{
+    ImageData image;
+    unsigned char *data = stbi_load(path.c_str(), &image.width, &image.height, &image.channels, 0);
+    if (data)
+        image.pixels = std::shared_ptr<unsigned char>(data, stbi_image_free);
+    else
+        std::cout << "Texture failed to load at path: " << path << std::endl;
+    return image;
+}
+#endif
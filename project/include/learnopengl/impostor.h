@@ -0,0 +1,251 @@
+#ifndef IMPOSTOR_H
+#define IMPOSTOR_H
+
+#include <glad/glad.h>
+
+#include <glm/glm.hpp>
+#include <glm/gtc/matrix_transform.hpp>
+
+#include <learnopengl/model.h>
+#include <learnopengl/shader.h>
+#include <learnopengl/gl_state.h>
+#include <learnopengl/instance_data.h>
+#include <learnopengl/render_stats.h>
+
+#include <cmath>
+#include <iostream>
+#include <vector>
+
+// Octahedral impostor of a model: at load time the model is rendered with an orthographic camera from
+// FRAMES x FRAMES directions spread over the whole sphere, each into its own cell of two atlases:
+//
+//     albedo       diffuse color, alpha is the coverage
+//     normalDepth  model space normal in rgb, in a the depth along the view direction across the bounding sphere
+//
+// Cell (i, j) looks at the model from the direction whose octahedral encoding is the cell center, so the
+// direction to the camera picks the cell directly. Far instances are then drawn as one quad each, facing the
+// camera along the nearest baked direction, in a single instanced draw (impostor.vs/.fs). The quads write
+// the depth of the baked surface, so they intersect the ground and other objects like the model would.
+//
+// The baked view directions and their camera basis have to match octahedralDecode and frameBasis in
+// impostor.vs.
+class Impostor
+{
+public:
+    static const unsigned int FRAMES = 16;
+    static const unsigned int FRAME_SIZE = 64; // impostors only cover a few dozen pixels
+    static const unsigned int ATLAS_SIZE = FRAMES * FRAME_SIZE;
+
+    // bakes model; bakeShader is impostor_bake.vs/.fs, compiled for the model's VertexLayout. Needs the GL
+    // context, the bound framebuffer and viewport are restored afterwards
+    Impostor(Model &model, Shader &bakeShader) : sphere(model.sphere)
+    {
+        createAtlas(albedoAtlas);
+        createAtlas(normalDepthAtlas);
+        bake(model, bakeShader);
+        createQuad();
+    }
+
+    ~Impostor()
+    {
+        GLStateCache::Instance().ForgetTexture(albedoAtlas);
+        GLStateCache::Instance().ForgetTexture(normalDepthAtlas);
+        glDeleteTextures(1, &albedoAtlas);
+        glDeleteTextures(1, &normalDepthAtlas);
+        glDeleteVertexArrays(1, &VAO);
+        glDeleteBuffers(1, &quadVBO);
+        glDeleteBuffers(1, &instanceVBO);
+    }
+
+    Impostor(const Impostor&) = delete;
+    Impostor& operator=(const Impostor&) = delete;
+
+    unsigned int AlbedoAtlas() const
+    {
+        return albedoAtlas;
+    }
+
+    // one quad per instance in a single instanced draw; shader is impostor.vs/.fs with its atlas samplers on
+    // texture units 0 and 1
+    void Draw(Shader &shader, const std::vector<InstanceData> &instances)
+    {
+        if (instances.empty())
+            return;
+        GLStateCache &state = GLStateCache::Instance();
+        if (uniforms.program != shader.ID)
+        {
+            uniforms.program = shader.ID;
+            uniforms.sphereCenter = shader.getUniform("sphereCenter");
+            uniforms.sphereRadius = shader.getUniform("sphereRadius");
+            uniforms.frames = shader.getUniform("frames");
+            uniforms.albedoAtlas = shader.getUniform("albedoAtlas");
+            uniforms.normalDepthAtlas = shader.getUniform("normalDepthAtlas");
+        }
+        shader.setVec3(uniforms.sphereCenter, sphere.center);
+        shader.setFloat(uniforms.sphereRadius, sphere.radius);
+        shader.setFloat(uniforms.frames, (float)FRAMES);
+        state.SetSampler(uniforms.albedoAtlas.location, 0);
+        state.SetSampler(uniforms.normalDepthAtlas.location, 1);
+        state.BindTexture(0, GL_TEXTURE_2D, albedoAtlas);
+        state.BindTexture(1, GL_TEXTURE_2D, normalDepthAtlas);
+
+        glBindBuffer(GL_ARRAY_BUFFER, instanceVBO);
+        if (instances.size() > instanceCapacity)
+        {
+            instanceCapacity = instances.size();
+            glBufferData(GL_ARRAY_BUFFER, instanceCapacity * sizeof(InstanceData), &instances[0], GL_STREAM_DRAW);
+        }
+        else
+            glBufferSubData(GL_ARRAY_BUFFER, 0, instances.size() * sizeof(InstanceData), &instances[0]);
+
+        state.BindVertexArray(VAO);
+        glDrawArraysInstanced(GL_TRIANGLE_STRIP, 0, 4, instances.size());
+        RenderStats::Frame().CountDraw(2 * instances.size());
+    }
+
+    // octahedral mapping of unit directions to [-1, 1]^2 with +y at the center
+    static glm::vec2 OctahedralEncode(const glm::vec3 &direction)
+    {
+        glm::vec3 n = direction / (std::fabs(direction.x) + std::fabs(direction.y) + std::fabs(direction.z));
+        glm::vec2 p(n.x, n.z);
+        if (n.y < 0.0f)
+            p = glm::vec2((1.0f - std::fabs(p.y)) * signNotZero(p.x), (1.0f - std::fabs(p.x)) * signNotZero(p.y));
+        return p;
+    }
+
+    static glm::vec3 OctahedralDecode(const glm::vec2 &p)
+    {
+        glm::vec3 n(p.x, 1.0f - std::fabs(p.x) - std::fabs(p.y), p.y);
+        if (n.y < 0.0f)
+        {
+            float x = (1.0f - std::fabs(n.z)) * signNotZero(n.x);
+            float z = (1.0f - std::fabs(n.x)) * signNotZero(n.z);
+            n.x = x;
+            n.z = z;
+        }
+        return glm::normalize(n);
+    }
+
+    // direction cell (i, j) was baked from, pointing from the model towards the camera
+    static glm::vec3 FrameDirection(unsigned int i, unsigned int j)
+    {
+        glm::vec2 cell((i + 0.5f) / FRAMES, (j + 0.5f) / FRAMES);
+        return OctahedralDecode(cell * 2.0f - 1.0f);
+    }
+
+    // the up vector the frames are baked with; the poles use z instead of y
+    static glm::vec3 FrameUp(const glm::vec3 &direction)
+    {
+        return std::fabs(direction.y) > 0.999f ? glm::vec3(0.0f, 0.0f, 1.0f) : glm::vec3(0.0f, 1.0f, 0.0f);
+    }
+
+private:
+    BoundingSphere sphere;
+    unsigned int albedoAtlas = 0, normalDepthAtlas = 0;
+    unsigned int VAO = 0, quadVBO = 0, instanceVBO = 0;
+    size_t instanceCapacity = 0;
+
+    struct Uniforms {
+        unsigned int program = 0;
+        UniformHandle sphereCenter, sphereRadius, frames, albedoAtlas, normalDepthAtlas;
+    };
+    Uniforms uniforms;
+
+    static float signNotZero(float value)
+    {
+        return value >= 0.0f ? 1.0f : -1.0f;
+    }
+
+    static void createAtlas(unsigned int &texture)
+    {
+        glGenTextures(1, &texture);
+        GLStateCache::Instance().EditTexture(0, GL_TEXTURE_2D, texture);
+        glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA8, ATLAS_SIZE, ATLAS_SIZE, 0, GL_RGBA, GL_UNSIGNED_BYTE, nullptr);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR_MIPMAP_LINEAR);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+        // past this level the mips would mix neighbouring cells
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAX_LEVEL, 4);
+    }
+
+    void bake(Model &model, Shader &bakeShader)
+    {
+        GLint previousFramebuffer = 0, previousViewport[4];
+        glGetIntegerv(GL_FRAMEBUFFER_BINDING, &previousFramebuffer);
+        glGetIntegerv(GL_VIEWPORT, previousViewport);
+
+        unsigned int FBO, depthBuffer;
+        glGenFramebuffers(1, &FBO);
+        glBindFramebuffer(GL_FRAMEBUFFER, FBO);
+        glFramebufferTexture2D(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_TEXTURE_2D, albedoAtlas, 0);
+        glFramebufferTexture2D(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT1, GL_TEXTURE_2D, normalDepthAtlas, 0);
+        glGenRenderbuffers(1, &depthBuffer);
+        glBindRenderbuffer(GL_RENDERBUFFER, depthBuffer);
+        glRenderbufferStorage(GL_RENDERBUFFER, GL_DEPTH_COMPONENT24, ATLAS_SIZE, ATLAS_SIZE);
+        glFramebufferRenderbuffer(GL_FRAMEBUFFER, GL_DEPTH_ATTACHMENT, GL_RENDERBUFFER, depthBuffer);
+        const GLenum attachments[2] = {GL_COLOR_ATTACHMENT0, GL_COLOR_ATTACHMENT1};
+        glDrawBuffers(2, attachments);
+        if (glCheckFramebufferStatus(GL_FRAMEBUFFER) != GL_FRAMEBUFFER_COMPLETE)
+            std::cout << "ERROR::FRAMEBUFFER:: Impostor atlas is not complete!" << std::endl;
+
+        glViewport(0, 0, ATLAS_SIZE, ATLAS_SIZE);
+        glClearColor(0.0f, 0.0f, 0.0f, 0.0f);
+        glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
+
+        // drawn with the scene's back face culling, so the frames show what the model would
+        GLStateCache &state = GLStateCache::Instance();
+        bakeShader.use();
+        UniformHandle viewProjection = bakeShader.getUniform("viewProjection");
+        UniformHandle viewDirection = bakeShader.getUniform("viewDirection");
+        bakeShader.setVec3("sphereCenter", sphere.center);
+        bakeShader.setFloat("sphereRadius", sphere.radius);
+        float radius = std::max(sphere.radius, 1e-6f);
+        glm::mat4 projection = glm::ortho(-radius, radius, -radius, radius, radius, 3.0f * radius);
+        for (unsigned int j = 0; j < FRAMES; j++)
+        {
+            for (unsigned int i = 0; i < FRAMES; i++)
+            {
+                glm::vec3 direction = FrameDirection(i, j);
+                glm::mat4 view = glm::lookAt(sphere.center + direction * 2.0f * radius, sphere.center, FrameUp(direction));
+                bakeShader.setMat4(viewProjection, projection * view);
+                bakeShader.setVec3(viewDirection, direction);
+                glViewport(i * FRAME_SIZE, j * FRAME_SIZE, FRAME_SIZE, FRAME_SIZE);
+                model.Draw(bakeShader);
+            }
+        }
+
+        glBindFramebuffer(GL_FRAMEBUFFER, previousFramebuffer);
+        glViewport(previousViewport[0], previousViewport[1], previousViewport[2], previousViewport[3]);
+        glDeleteRenderbuffers(1, &depthBuffer);
+        glDeleteFramebuffers(1, &FBO);
+
+        for (unsigned int texture : {albedoAtlas, normalDepthAtlas})
+        {
+            state.EditTexture(0, GL_TEXTURE_2D, texture);
+            glGenerateMipmap(GL_TEXTURE_2D);
+        }
+    }
+
+    // a unit quad as a triangle strip, plus the model matrices of InstanceData at locations 5-8
+    void createQuad()
+    {
+        const float corners[] = {-1.0f, -1.0f, 1.0f, -1.0f, -1.0f, 1.0f, 1.0f, 1.0f};
+        glGenVertexArrays(1, &VAO);
+        glGenBuffers(1, &quadVBO);
+        glGenBuffers(1, &instanceVBO);
+        GLStateCache::Instance().BindVertexArray(VAO);
+        glBindBuffer(GL_ARRAY_BUFFER, quadVBO);
+        glBufferData(GL_ARRAY_BUFFER, sizeof(corners), corners, GL_STATIC_DRAW);
+        glEnableVertexAttribArray(0);
+        glVertexAttribPointer(0, 2, GL_FLOAT, GL_FALSE, 2 * sizeof(float), (void*)0);
+        glBindBuffer(GL_ARRAY_BUFFER, instanceVBO);
+        for (unsigned int i = 0; i < 4; i++)
+        {
+            glEnableVertexAttribArray(5 + i);
+            glVertexAttribPointer(5 + i, 4, GL_FLOAT, GL_FALSE, sizeof(InstanceData), (void*)(offsetof(InstanceData, model) + i * sizeof(glm::vec4)));
+            glVertexAttribDivisor(5 + i, 1);
+        }
+    }
+};
+#endif
@@ -0,0 +1,78 @@
+#ifndef INSTANCE_DATA_H
+#define INSTANCE_DATA_H
+
+#include <glm/glm.hpp>
+
+#include <algorithm>
+#include <cmath>
+#include <vector>
+
+// what the instance buffer holds for every instance: the model matrix (attribute locations 5-8) and the
+// normal matrix, the inverse transpose of its upper 3x3 (locations 9-11), so shaders don't invert per vertex
+struct InstanceData {
+    glm::mat4 model;
+    glm::mat3 normal;
+};
+
+// true when the upper 3x3 of transform is a rotation (or reflection) times a uniform scale. mat3(transform)
+// then turns normals in the right direction, only their length is off, and the normal matrix isn't needed.
+inline bool IsUniformScale(const glm::mat4 &transform, float tolerance = 1e-4f)
+{
+    glm::vec3 x(transform[0]), y(transform[1]), z(transform[2]);
+    float xx = glm::dot(x, x), yy = glm::dot(y, y), zz = glm::dot(z, z);
+    float scale = std::max(xx, std::max(yy, zz));
+    if (scale == 0.0f)
+        return false;
+    float limit = tolerance * scale;
+    return std::fabs(xx - yy) <= limit && std::fabs(xx - zz) <= limit &&
+           std::fabs(glm::dot(x, y)) <= limit && std::fabs(glm::dot(y, z)) <= limit && std::fabs(glm::dot(z, x)) <= limit;
+}
+
+// Replaces instances with the transforms and their normal matrices. Every inverse transpose is the cofactor
+// matrix divided by the determinant; for a whole batch they are computed in structure of arrays layout, a
+// loop without branches that the compiler turns into SIMD code.
+inline void BuildInstanceData(const std::vector<glm::mat4> &transforms, std::vector<InstanceData> &instances)
+{
+    size_t count = transforms.size();
+    instances.resize(count);
+    if (count == 0)
+        return;
+
+    // columns a, b, c of the upper 3x3 of every transform, then the columns of the normal matrices
+    std::vector<float> scratch(18 * count);
+    float *in[9], *out[9];
+    for (int k = 0; k < 9; k++)
+    {
+        in[k] = &scratch[k * count];
+        out[k] = &scratch[(9 + k) * count];
+    }
+    for (size_t i = 0; i < count; i++)
+    {
+        instances[i].model = transforms[i];
+        for (int k = 0; k < 9; k++)
+            in[k][i] = transforms[i][k / 3][k % 3];
+    }
+
+    const float *ax = in[0], *ay = in[1], *az = in[2];
+    const float *bx = in[3], *by = in[4], *bz = in[5];
+    const float *cx = in[6], *cy = in[7], *cz = in[8];
+    for (size_t i = 0; i < count; i++)
+    {
+        // the cofactor columns are cross(b, c), cross(c, a) and cross(a, b)
+        float r0x = by[i] * cz[i] - bz[i] * cy[i], r0y = bz[i] * cx[i] - bx[i] * cz[i], r0z = bx[i] * cy[i] - by[i] * cx[i];
+        float r1x = cy[i] * az[i] - cz[i] * ay[i], r1y = cz[i] * ax[i] - cx[i] * az[i], r1z = cx[i] * ay[i] - cy[i] * ax[i];
+        float r2x = ay[i] * bz[i] - az[i] * by[i], r2y = az[i] * bx[i] - ax[i] * bz[i], r2z = ax[i] * by[i] - ay[i] * bx[i];
+        float determinant = ax[i] * r0x + ay[i] * r0y + az[i] * r0z;
+        float inverse = determinant != 0.0f ? 1.0f / determinant : 0.0f;
+        out[0][i] = r0x * inverse; out[1][i] = r0y * inverse; out[2][i] = r0z * inverse;
+        out[3][i] = r1x * inverse; out[4][i] = r1y * inverse; out[5][i] = r1z * inverse;
+        out[6][i] = r2x * inverse; out[7][i] = r2y * inverse; out[8][i] = r2z * inverse;
+    }
+
+    for (size_t i = 0; i < count; i++)
+    {
+        for (int k = 0; k < 9; k++)
+            instances[i].normal[k / 3][k % 3] = out[k][i];
+    }
+}
+#endif
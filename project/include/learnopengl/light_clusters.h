@@ -0,0 +1,272 @@
+#ifndef LIGHT_CLUSTERS_H
+#define LIGHT_CLUSTERS_H
+
+#include <glad/glad.h>
+
+#include <glm/glm.hpp>
+
+#include <learnopengl/frame_uniforms.h>
+#include <learnopengl/gl_state.h>
+#include <learnopengl/thread_pool.h>
+
+#include <algorithm>
+#include <chrono>
+#include <cfloat>
+#include <cmath>
+#include <vector>
+
+#define CLUSTERS_X 16
+#define CLUSTERS_Y 9
+#define CLUSTERS_Z 24
+
+// binding point of the ClusterUniforms block and the texture units of the cluster samplers in the lit shaders:
+// clusterLights, clusterRanges and clusterIndices, in that order
+const unsigned int CLUSTER_UNIFORMS_BINDING = 2;
+const unsigned int CLUSTER_LIGHTS_UNIT = 11;
+
+// mirrors the std140 ClusterUniforms block in resources/shaders/clusters.glsl
+struct ClusterUniforms {
+    glm::vec2 clusterDepth; // slice = log(depth) * x - y
+    glm::vec2 pad0;
+};
+
+// Clustered forward lighting: the view frustum is split into CLUSTERS_X x CLUSTERS_Y screen tiles and
+// CLUSTERS_Z exponentially spaced depth slices, and every frame the point lights are binned into the clusters
+// their range touches. A fragment then only loops over the lights of its own cluster, so the cost per fragment
+// follows the lights nearby instead of all lights.
+//
+//     clusters.Update(lights, view, projection, nearPlane, farPlane);
+//     clusters.BindTextures();
+//
+// The lights are PointLightStd140, the layout of FrameUniforms, with their range in the last float (see
+// Range). Three texture buffers hold the result:
+//
+//     clusterLights   RGBA32F, four texels per light
+//     clusterRanges   RG32UI, offset and count of each cluster's slice of clusterIndices
+//     clusterIndices  R32UI, light indices, cluster after cluster
+//
+// Binning runs on the CPU: a light's sphere covers a box of clusters, found slice by slice from the circle the
+// sphere cuts out of the slice, and a counting pass followed by a fill pass writes the indices without
+// per-cluster allocations. The boxes are split across the thread pool by light, the two passes by depth
+// slice, whose clusters no other slice writes to.
+class LightClusters
+{
+public:
+    static const unsigned int CLUSTER_COUNT = CLUSTERS_X * CLUSTERS_Y * CLUSTERS_Z;
+
+    struct Stats {
+        unsigned int lights = 0;
+        unsigned int indices = 0;
+        unsigned int maxPerCluster = 0;
+        double binningMs = 0.0;
+    };
+
+    explicit LightClusters(ThreadPool &pool)
+        : pool(pool)
+    {
+        GLStateCache &state = GLStateCache::Instance();
+        const GLenum formats[3] = {GL_RGBA32F, GL_RG32UI, GL_R32UI};
+        glGenBuffers(3, buffers);
+        glGenTextures(3, textures);
+        for (unsigned int i = 0; i < 3; i++)
+        {
+            glBindBuffer(GL_TEXTURE_BUFFER, buffers[i]);
+            glBufferData(GL_TEXTURE_BUFFER, 16, nullptr, GL_STREAM_DRAW);
+            state.EditTexture(0, GL_TEXTURE_BUFFER, textures[i]);
+            glTexBuffer(GL_TEXTURE_BUFFER, formats[i], buffers[i]);
+        }
+        glBindBuffer(GL_TEXTURE_BUFFER, 0);
+
+        glGenBuffers(1, &UBO);
+        glBindBuffer(GL_UNIFORM_BUFFER, UBO);
+        glBufferData(GL_UNIFORM_BUFFER, sizeof(ClusterUniforms), NULL, GL_DYNAMIC_DRAW);
+        glBindBuffer(GL_UNIFORM_BUFFER, 0);
+        glBindBufferBase(GL_UNIFORM_BUFFER, CLUSTER_UNIFORMS_BINDING, UBO);
+    }
+
+    ~LightClusters()
+    {
+        for (unsigned int texture : textures)
+            GLStateCache::Instance().ForgetTexture(texture);
+        glDeleteTextures(3, textures);
+        glDeleteBuffers(3, buffers);
+        glDeleteBuffers(1, &UBO);
+    }
+
+    LightClusters(const LightClusters&) = delete;
+    LightClusters& operator=(const LightClusters&) = delete;
+
+    // distance where the light's attenuation drops its brightest ambient, diffuse or specular channel below
+    // 1/256. The shaders fade the light out towards it, so cutting it off there doesn't leave an edge
+    static float Range(const PointLightStd140 &light)
+    {
+        glm::vec3 brightest = glm::max(light.ambient, glm::max(light.diffuse, light.specular));
+        float intensity = std::max(brightest.x, std::max(brightest.y, brightest.z));
+        float target = 256.0f * intensity - light.constant;
+        if (target <= 0.0f)
+            return 0.0f;
+        if (light.quadratic > 0.0f)
+            return (-light.linear + std::sqrt(light.linear * light.linear + 4.0f * light.quadratic * target)) / (2.0f * light.quadratic);
+        if (light.linear > 0.0f)
+            return target / light.linear;
+        return FLT_MAX;
+    }
+
+    // bins lights, whose radius field holds their Range, with the frame's camera and uploads the result
+    void Update(const std::vector<PointLightStd140> &lights, const glm::mat4 &view, const glm::mat4 &projection,
+                float nearPlane, float farPlane)
+    {
+        auto start = std::chrono::steady_clock::now();
+        float logRatio = std::log(farPlane / nearPlane);
+        for (unsigned int z = 0; z <= CLUSTERS_Z; z++)
+            sliceDepth[z] = nearPlane * std::exp(logRatio * z / CLUSTERS_Z);
+
+        // distance from the camera to the far corners of the frustum. A light reaching further than its own
+        // distance plus this covers the whole frustum already, which also keeps unlimited ranges (no linear and
+        // quadratic attenuation, see Range) finite
+        float farCorner = farPlane * std::sqrt(1.0f + 1.0f / (projection[0][0] * projection[0][0]) +
+                                               1.0f / (projection[1][1] * projection[1][1]));
+
+        // every light's cluster box first, the counts give each cluster its offset. With few lights waking the
+        // workers costs more than it saves, then everything runs on this thread
+        unsigned int lightCount = lights.size();
+        unsigned int sliceGrain = lightCount < PARALLEL_LIGHTS ? CLUSTERS_Z : 1;
+        boxes.resize(lightCount);
+        pool.ParallelFor(lightCount, PARALLEL_LIGHTS, [&](unsigned int begin, unsigned int end) {
+            for (unsigned int i = begin; i < end; i++)
+            {
+                glm::vec3 center = glm::vec3(view * glm::vec4(lights[i].position, 1.0f));
+                float radius = std::min(lights[i].radius, glm::length(center) + farCorner);
+                clusterBox(center, radius, projection[0][0], projection[1][1], boxes[i]);
+            }
+        });
+        pool.ParallelFor(CLUSTERS_Z, sliceGrain, [&](unsigned int zBegin, unsigned int zEnd) {
+            std::fill(counts.begin() + zBegin * CLUSTERS_X * CLUSTERS_Y, counts.begin() + zEnd * CLUSTERS_X * CLUSTERS_Y, 0u);
+            for (unsigned int i = 0; i < lightCount; i++)
+                forEachCluster(boxes[i], zBegin, zEnd, [&](unsigned int cluster) { counts[cluster]++; });
+        });
+        unsigned int offset = 0;
+        stats.maxPerCluster = 0;
+        for (unsigned int cluster = 0; cluster < CLUSTER_COUNT; cluster++)
+        {
+            ranges[2 * cluster] = offset;
+            ranges[2 * cluster + 1] = 0;
+            offset += counts[cluster];
+            stats.maxPerCluster = std::max(stats.maxPerCluster, counts[cluster]);
+        }
+        indices.resize(std::max(offset, 1u));
+        pool.ParallelFor(CLUSTERS_Z, sliceGrain, [&](unsigned int zBegin, unsigned int zEnd) {
+            for (unsigned int i = 0; i < lightCount; i++)
+            {
+                forEachCluster(boxes[i], zBegin, zEnd, [&](unsigned int cluster) {
+                    indices[ranges[2 * cluster] + ranges[2 * cluster + 1]++] = i;
+                });
+            }
+        });
+
+        upload(0, lights.empty() ? nullptr : &lights[0], std::max<size_t>(lights.size(), 1) * sizeof(PointLightStd140));
+        upload(1, &ranges[0], ranges.size() * sizeof(unsigned int));
+        upload(2, &indices[0], indices.size() * sizeof(unsigned int));
+
+        ClusterUniforms uniforms;
+        uniforms.clusterDepth = glm::vec2(CLUSTERS_Z / logRatio, CLUSTERS_Z * std::log(nearPlane) / logRatio);
+        uniforms.pad0 = glm::vec2(0.0f);
+        glBindBuffer(GL_UNIFORM_BUFFER, UBO);
+        glBufferSubData(GL_UNIFORM_BUFFER, 0, sizeof(ClusterUniforms), &uniforms);
+        glBindBuffer(GL_UNIFORM_BUFFER, 0);
+
+        stats.lights = lightCount;
+        stats.indices = offset;
+        stats.binningMs = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+    }
+
+    // binds the three texture buffers to CLUSTER_LIGHTS_UNIT and the two units after it
+    void BindTextures() const
+    {
+        for (unsigned int i = 0; i < 3; i++)
+            GLStateCache::Instance().BindTexture(CLUSTER_LIGHTS_UNIT + i, GL_TEXTURE_BUFFER, textures[i]);
+    }
+
+    const Stats &LastStats() const
+    {
+        return stats;
+    }
+
+private:
+    // clusters covered by a light, per slice since the tile range narrows away from the sphere's center
+    struct ClusterBox {
+        unsigned int zBegin = 0, zEnd = 0;
+        unsigned short x0[CLUSTERS_Z], x1[CLUSTERS_Z], y0[CLUSTERS_Z], y1[CLUSTERS_Z];
+    };
+
+    // fewest lights worth splitting across the pool, and the fewest per worker
+    static const unsigned int PARALLEL_LIGHTS = 128;
+
+    ThreadPool &pool;
+    unsigned int buffers[3], textures[3];
+    unsigned int UBO = 0;
+    float sliceDepth[CLUSTERS_Z + 1];
+    std::vector<ClusterBox> boxes;
+    std::vector<unsigned int> counts = std::vector<unsigned int>(CLUSTER_COUNT);
+    std::vector<unsigned int> ranges = std::vector<unsigned int>(2 * CLUSTER_COUNT);
+    std::vector<unsigned int> indices;
+    Stats stats;
+
+    // center in view space, looking down -z. The slices in reach are found first, the loop over them then has
+    // no branches and the compiler vectorizes it across slices
+    void clusterBox(const glm::vec3 &center, float radius, float scaleX, float scaleY, ClusterBox &box) const
+    {
+        float depth = -center.z;
+        // the slices with sliceDepth[z + 1] >= depth - radius and sliceDepth[z] <= depth + radius
+        box.zBegin = std::lower_bound(sliceDepth + 1, sliceDepth + CLUSTERS_Z + 1, depth - radius) - (sliceDepth + 1);
+        box.zEnd = std::upper_bound(sliceDepth, sliceDepth + CLUSTERS_Z, depth + radius) - sliceDepth;
+        for (unsigned int z = box.zBegin; z < box.zEnd; z++)
+        {
+            float sliceNear = std::max(sliceDepth[z], depth - radius);
+            float sliceFar = std::min(sliceDepth[z + 1], depth + radius);
+
+            // the widest circle the sphere cuts out of the slice, projected at both ends of the slice
+            float gap = std::max(std::max(sliceNear - depth, depth - sliceFar), 0.0f);
+            float chord = std::sqrt(std::max(radius * radius - gap * gap, 0.0f));
+            tileRange(center.x - chord, center.x + chord, sliceNear, sliceFar, scaleX, CLUSTERS_X, box.x0[z], box.x1[z]);
+            tileRange(center.y - chord, center.y + chord, sliceNear, sliceFar, scaleY, CLUSTERS_Y, box.y0[z], box.y1[z]);
+        }
+    }
+
+    // tiles covered by [low, high] seen at depths between nearDepth and farDepth, end exclusive
+    static void tileRange(float low, float high, float nearDepth, float farDepth, float scale, unsigned int tiles,
+                          unsigned short &first, unsigned short &end)
+    {
+        float ndcLow = std::min(low / nearDepth, low / farDepth) * scale;
+        float ndcHigh = std::max(high / nearDepth, high / farDepth) * scale;
+        bool visible = (ndcHigh >= -1.0f) & (ndcLow <= 1.0f);
+        // clamped to the screen, the tile coordinates are positive and truncating them rounds down
+        int firstTile = (int)((std::max(ndcLow, -1.0f) * 0.5f + 0.5f) * tiles);
+        int lastTile = (int)((std::min(ndcHigh, 1.0f) * 0.5f + 0.5f) * tiles);
+        first = (unsigned short)(visible ? firstTile : 0);
+        end = (unsigned short)(visible ? std::min(lastTile + 1, (int)tiles) : 0);
+    }
+
+    // the box's clusters within the slices [zFirst, zLast)
+    template <class Visit>
+    static void forEachCluster(const ClusterBox &box, unsigned int zFirst, unsigned int zLast, Visit visit)
+    {
+        for (unsigned int z = std::max(box.zBegin, zFirst); z < std::min(box.zEnd, zLast); z++)
+        {
+            for (unsigned int y = box.y0[z]; y < box.y1[z]; y++)
+            {
+                for (unsigned int x = box.x0[z]; x < box.x1[z]; x++)
+                    visit((z * CLUSTERS_Y + y) * CLUSTERS_X + x);
+            }
+        }
+    }
+
+    void upload(unsigned int buffer, const void *data, size_t size)
+    {
+        // orphaned every frame, the previous frame's draws may still read the old storage
+        glBindBuffer(GL_TEXTURE_BUFFER, buffers[buffer]);
+        glBufferData(GL_TEXTURE_BUFFER, size, data, GL_STREAM_DRAW);
+        glBindBuffer(GL_TEXTURE_BUFFER, 0);
+    }
+};
+#endif
@@ -0,0 +1,54 @@
+#ifndef LOD_H
+#define LOD_H
+
+// Levels of detail: level 0 is the full mesh, every following one a coarser simplification of it (see
+// MeshSimplifier), so a model has at most MAX_LODS levels.
+const unsigned int MAX_LODS = 4;
+// the level past the meshes, for instances drawn as an Impostor
+const unsigned int IMPOSTOR_LOD = MAX_LODS;
+
+// Picks the level of an object from its screen coverage, the height of its bounding sphere on screen as a
+// fraction of the viewport (Camera::ScreenCoverage). Level i is used while the coverage stays below
+// thresholds[i - 1]. Switching only happens once the coverage is past a threshold by the hysteresis fraction,
+// so objects sitting right at a threshold don't pop back and forth every frame. Objects that have an impostor
+// switch to it below impostorThreshold, with the same hysteresis.
+struct LodSelector {
+    float thresholds[MAX_LODS - 1] = {0.3f, 0.15f, 0.07f};
+    float impostorThreshold = 0.04f;
+    float hysteresis = 0.15f;
+
+    // the level to use now for an object that was drawn at current, out of lodCount levels
+    unsigned int Select(float coverage, unsigned int current, unsigned int lodCount) const
+    {
+        if (lodCount == 0)
+            return 0;
+        if (current >= lodCount)
+            current = lodCount - 1;
+        while (current + 1 < lodCount && coverage < thresholds[current] * (1.0f - hysteresis))
+            current++;
+        while (current > 0 && coverage > thresholds[current - 1] * (1.0f + hysteresis))
+            current--;
+        return current;
+    }
+
+    // same, for objects that can also be drawn as an impostor; current may be IMPOSTOR_LOD
+    unsigned int SelectWithImpostor(float coverage, unsigned int current, unsigned int lodCount) const
+    {
+        bool impostor = current == IMPOSTOR_LOD;
+        if (coverage < impostorThreshold * (impostor ? 1.0f + hysteresis : 1.0f - hysteresis))
+            return IMPOSTOR_LOD;
+        return Select(coverage, current, lodCount);
+    }
+};
+
+// how many instances were drawn at each level this frame, impostors last
+struct LodStats {
+    unsigned int instances[MAX_LODS + 1] = {};
+
+    void Reset()
+    {
+        for (unsigned int &count : instances)
+            count = 0;
+    }
+};
+#endif
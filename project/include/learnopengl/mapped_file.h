@@ -0,0 +1,91 @@
+#ifndef MAPPED_FILE_H
+#define MAPPED_FILE_H
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include <cstdint>
+#include <string>
+
+// Read-only memory mapping of a whole file, unmapped when the object goes out of scope.
+class MappedFile
+{
+public:
+    explicit MappedFile(const std::string &path)
+    {
+        int fd = open(path.c_str(), O_RDONLY);
+        if (fd < 0)
+            return;
+        struct stat info;
+        if (fstat(fd, &info) == 0 && info.st_size > 0)
+        {
+            void *mapping = mmap(nullptr, info.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+            if (mapping != MAP_FAILED)
+            {
+                bytes = static_cast<const unsigned char*>(mapping);
+                length = info.st_size;
+            }
+        }
+        close(fd); // the mapping stays valid after the descriptor is closed
+    }
+
+    ~MappedFile()
+    {
+        if (bytes)
+            munmap(const_cast<unsigned char*>(bytes), length);
+    }
+
+    MappedFile(const MappedFile&) = delete;
+    MappedFile& operator=(const MappedFile&) = delete;
+
+    const unsigned char *Data() const
+    {
+        return bytes;
+    }
+
+    size_t Size() const
+    {
+        return length;
+    }
+
+private:
+    const unsigned char *bytes = nullptr;
+    size_t length = 0;
+};
+
+// 64-bit FNV-1a
+inline uint64_t HashBytes(const unsigned char *data, size_t size)
+{
+    uint64_t hash = 14695981039346656037ull;
+    for (size_t i = 0; i < size; i++)
+    {
+        hash ^= data[i];
+        hash *= 1099511628211ull;
+    }
+    return hash;
+}
+
+// identifies the exact contents of a source asset, stored in the headers of files derived from it so that
+// a stale derived file is detected even when the modification time alone would not show it
+struct SourceStamp {
+    uint64_t size = 0;
+    int64_t  mtime = 0;
+    uint64_t hash = 0;
+};
+
+inline bool StampSource(const std::string &path, SourceStamp &stamp)
+{
+    struct stat info;
+    if (stat(path.c_str(), &info) != 0)
+        return false;
+    MappedFile source(path);
+    if (!source.Data())
+        return false;
+    stamp.size = info.st_size;
+    stamp.mtime = info.st_mtime;
+    stamp.hash = HashBytes(source.Data(), source.Size());
+    return true;
+}
+#endif
@@ -7,32 +7,32 @@
 #include <glm/gtc/matrix_transform.hpp>
 
 #include <learnopengl/shader.h>
+#include <learnopengl/bounds.h>
+#include <learnopengl/instance_data.h>
+#include <learnopengl/render_stats.h>
+#include <learnopengl/gl_state.h>
+#include <learnopengl/static_geometry.h>
+#include <learnopengl/vertex.h>
 
 #include <string>
 #include <vector>
 using namespace std;
 
-struct Vertex {
-    // position
-    glm::vec3 Position;
-    // normal
-    glm::vec3 Normal;
-    // texCoords
-    glm::vec2 TexCoords;
-    // tangent
-    glm::vec3 Tangent;
-    // bitangent
-    glm::vec3 Bitangent;
-};
-
-
-
 struct Texture {
     unsigned int id;
     string type;
     string path;
 };
 
+// CPU side copy of a mesh before it is uploaded, the texture ids are filled in by the Model on upload
+struct MeshData {
+    vector<Vertex>       vertices;
+    vector<unsigned int> indices;
+    vector<Texture>      textures;
+    // index buffers of the simplified levels of detail, coarsest last; they use the same vertices
+    vector<vector<unsigned int>> lods;
+};
+
 class Mesh {
 public:
     // mesh Data
@@ -40,30 +40,133 @@ public:
     vector<unsigned int> indices;
     vector<Texture>      textures;
 
+    // the arena block VAO the mesh is drawn with, shared with the other meshes of the block
     unsigned int VAO;
+    GeometryRange range;
+    // range of every level of detail, the first one is range itself
+    vector<GeometryRange> lods;
+    VertexFormat format;
     std::string glslIdentifierPrefix;
+    // bounding volumes in model space, computed once from the vertices
+    BoundingBox bounds;
+    BoundingSphere sphere;
     // constructor
-    Mesh(vector<Vertex> vertices, vector<unsigned int> indices, vector<Texture> textures)
+    Mesh(vector<Vertex> vertices, vector<unsigned int> indices, vector<Texture> textures, VertexFormat format = VertexFormat(),
+         const vector<vector<unsigned int>> &lodIndices = {})
     {
-        this->vertices = vertices;
-        this->indices = indices;
-        this->textures = textures;
+        this->vertices = std::move(vertices);
+        this->indices = std::move(indices);
+        this->textures = std::move(textures);
+        this->format = format;
 
         // now that we have all the required data, set the vertex buffers and its attribute pointers.
-        setupMesh();
+        setupMesh(lodIndices);
+        computeBounds();
+    }
+
+    // prefix prepended to the sampler names, e.g. "material." for a Material struct in the shader
+    void SetShaderTextureNamePrefix(const std::string &prefix)
+    {
+        glslIdentifierPrefix = prefix;
+        shaderBindings.clear();
+    }
+
+    unsigned int LodCount() const
+    {
+        return lods.size();
+    }
+
+    // render the mesh; levels past the coarsest one the mesh has draw the coarsest
+    void Draw(Shader &shader, unsigned int lod = 0)
+    {
+        bindTextures(shader);
+        // the VAO stays bound, the next draw binds its own through the state cache
+        StaticGeometryArena::Instance().Draw(lodRange(lod));
+    }
+
+    // render instanceCount copies of the mesh in a single draw call. The per-instance data is read from
+    // instanceVBO, a buffer of InstanceData: the model matrix as attribute locations 5-8 and the normal matrix
+    // as 9-11, advanced once per instance instead of once per vertex.
+    void DrawInstanced(Shader &shader, unsigned int instanceVBO, unsigned int instanceCount, unsigned int lod = 0)
+    {
+        bindTextures(shader);
+        StaticGeometryArena::Instance().DrawInstanced(lodRange(lod), instanceVBO, instanceCount);
+    }
+
+    // true when other can be drawn in the same call: same arena block, quantization and textures
+    bool SharesStateWith(const Mesh &other) const
+    {
+        if(range.block != other.range.block || textures.size() != other.textures.size())
+            return false;
+        if(format.layout == VertexLayout::Packed &&
+           (format.positionBounds.min != other.format.positionBounds.min || format.positionBounds.max != other.format.positionBounds.max))
+            return false;
+        for(unsigned int i = 0; i < textures.size(); i++)
+        {
+            if(textures[i].id != other.textures[i].id || textures[i].type != other.textures[i].type)
+                return false;
+        }
+        return true;
+    }
+
+    // draws meshes that all share state with the first one in a single multi-draw call
+    static void DrawMerged(Shader &shader, const vector<Mesh*> &meshes, vector<GeometryRange> &scratch)
+    {
+        if(meshes.empty())
+            return;
+        meshes[0]->bindTextures(shader);
+        scratch.clear();
+        for(const Mesh *mesh : meshes)
+            scratch.push_back(mesh->range);
+        StaticGeometryArena::Instance().MultiDraw(scratch);
+    }
+
+private:
+    // uniform locations of the mesh, resolved once per shader program the mesh is drawn with
+    struct ShaderBinding {
+        unsigned int program;
+        vector<GLint> samplers;
+        GLint positionOffset, positionScale;
+    };
+    vector<ShaderBinding> shaderBindings;
+
+    // binds every texture of the mesh to its own unit and points the matching sampler uniform at it,
+    // leaving out what is already in place from the previous draw. Packed meshes also pass their quantization box.
+    void bindTextures(Shader &shader)
+    {
+        GLStateCache &state = GLStateCache::Instance();
+        const ShaderBinding &binding = resolveBinding(shader);
+        for(unsigned int i = 0; i < textures.size(); i++)
+        {
+            state.SetSampler(binding.samplers[i], i);
+            state.BindTexture(i, GL_TEXTURE_2D, textures[i].id);
+        }
+        if(format.layout == VertexLayout::Packed)
+        {
+            glm::vec3 offset = format.PositionOffset(), scale = format.PositionScale();
+            glUniform3fv(binding.positionOffset, 1, &offset[0]);
+            glUniform3fv(binding.positionScale, 1, &scale[0]);
+        }
     }
 
-    // render the mesh
-    void Draw(Shader &shader)
+    // builds the sampler names (prefix + type + N, e.g. material.texture_diffuse1) the first time the mesh is
+    // drawn with a given shader and looks them up, later draws with the same shader reuse the locations
+    const ShaderBinding &resolveBinding(Shader &shader)
     {
-        // bind appropriate textures
+        for(unsigned int i = 0; i < shaderBindings.size(); i++)
+        {
+            if(shaderBindings[i].program == shader.ID)
+                return shaderBindings[i];
+        }
+
         unsigned int diffuseNr  = 1;
         unsigned int specularNr = 1;
         unsigned int normalNr   = 1;
         unsigned int heightNr   = 1;
+        ShaderBinding binding;
+        binding.program = shader.ID;
         for(unsigned int i = 0; i < textures.size(); i++)
         {
-            glActiveTexture(GL_TEXTURE0 + i); // active proper texture unit before binding
             // retrieve texture number (the N in diffuse_textureN)
             string number;
             string name = textures[i].type;
@@ -76,64 +179,42 @@ public:
             else if(name == "texture_height")
                 number = std::to_string(heightNr++); // transfer unsigned int to stream
 
-            // now set the sampler to the correct texture unit
-            glUniform1i(glGetUniformLocation(shader.ID, (glslIdentifierPrefix + name + number).c_str()), i);
-            // and finally bind the texture
-            glBindTexture(GL_TEXTURE_2D, textures[i].id);
+            binding.samplers.push_back(shader.getUniform(glslIdentifierPrefix + name + number).location);
         }
+        binding.positionOffset = shader.getUniform("positionOffset").location;
+        binding.positionScale = shader.getUniform("positionScale").location;
+        shaderBindings.push_back(binding);
+        return shaderBindings.back();
+    }
 
-
-
-        // draw mesh
-        glBindVertexArray(VAO);
-        glDrawElements(GL_TRIANGLES, indices.size(), GL_UNSIGNED_INT, 0);
-        glBindVertexArray(0);
-
-        // always good practice to set everything back to defaults once configured.
-        glActiveTexture(GL_TEXTURE0);
+    // box around all vertices and the sphere centered on it that reaches the farthest vertex
+    void computeBounds()
+    {
+        for(const Vertex &vertex : vertices)
+            bounds.Expand(vertex.Position);
+        if(bounds.Empty())
+            return;
+        sphere.center = bounds.Center();
+        float radiusSquared = 0.0f;
+        for(const Vertex &vertex : vertices)
+        {
+            glm::vec3 offset = vertex.Position - sphere.center;
+            radiusSquared = std::max(radiusSquared, glm::dot(offset, offset));
+        }
+        sphere.radius = std::sqrt(radiusSquared);
     }
 
-private:
-    // render data
-    unsigned int VBO, EBO;
+    const GeometryRange &lodRange(unsigned int lod) const
+    {
+        return lods[std::min<size_t>(lod, lods.size() - 1)];
+    }
 
-    // initializes all the buffer objects/arrays
-    void setupMesh()
+    // copies the vertices, encoded in the mesh's format, and the indices of every level into the shared arena
+    void setupMesh(const vector<vector<unsigned int>> &lodIndices)
     {
-        // create buffers/arrays
-        glGenVertexArrays(1, &VAO);
-        glGenBuffers(1, &VBO);
-        glGenBuffers(1, &EBO);
-
-        glBindVertexArray(VAO);
-        // load data into vertex buffers
-        glBindBuffer(GL_ARRAY_BUFFER, VBO);
-        // A great thing about structs is that their memory layout is sequential for all its items.
-        // The effect is that we can simply pass a pointer to the struct and it translates perfectly to a glm::vec3/2 array which
-        // again translates to 3/2 floats which translates to a byte array.
-        glBufferData(GL_ARRAY_BUFFER, vertices.size() * sizeof(Vertex), &vertices[0], GL_STATIC_DRAW);
-
-        glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, EBO);
-        glBufferData(GL_ELEMENT_ARRAY_BUFFER, indices.size() * sizeof(unsigned int), &indices[0], GL_STATIC_DRAW);
-
-        // set the vertex attribute pointers
-        // vertex Positions
-        glEnableVertexAttribArray(0);
-        glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, sizeof(Vertex), (void*)0);
-        // vertex normals
-        glEnableVertexAttribArray(1);
-        glVertexAttribPointer(1, 3, GL_FLOAT, GL_FALSE, sizeof(Vertex), (void*)offsetof(Vertex, Normal));
-        // vertex texture coords
-        glEnableVertexAttribArray(2);
-        glVertexAttribPointer(2, 2, GL_FLOAT, GL_FALSE, sizeof(Vertex), (void*)offsetof(Vertex, TexCoords));
-        // vertex tangent
-        glEnableVertexAttribArray(3);
-        glVertexAttribPointer(3, 3, GL_FLOAT, GL_FALSE, sizeof(Vertex), (void*)offsetof(Vertex, Tangent));
-        // vertex bitangent
-        glEnableVertexAttribArray(4);
-        glVertexAttribPointer(4, 3, GL_FLOAT, GL_FALSE, sizeof(Vertex), (void*)offsetof(Vertex, Bitangent));
-
-        glBindVertexArray(0);
+        lods = StaticGeometryArena::Instance().Allocate(format, vertices, indices, lodIndices);
+        range = lods[0];
+        VAO = StaticGeometryArena::Instance().VertexArray(range.block);
     }
 };
 #endif
\ No newline at end of file
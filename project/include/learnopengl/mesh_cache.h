@@ -0,0 +1,209 @@
+#ifndef MESH_CACHE_H
+#define MESH_CACHE_H
+
+#include <learnopengl/mesh.h>
+#include <learnopengl/mapped_file.h>
+
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+#include <string>
+#include <vector>
+
+// Binary copy of the meshes of an imported model, written next to the source file (<source>.meshcache) after
+// the first ASSIMP import so that later runs can skip parsing the text format entirely. Layout, all fields
+// little endian and every section padded to 4 bytes:
+//
+//     MeshCacheHeader
+//     per mesh: MeshCacheMeshHeader, Vertex[vertexCount], uint32[indexCount],
+//               per level of detail: uint32 count + uint32[count],
+//               per texture: uint32 length + type string, uint32 length + path string
+//
+// A cache is only used when its version matches and the source file still has the size, modification time
+// and content hash recorded in the header.
+namespace MeshCache {
+
+const uint32_t MAGIC = 0x434d4752; // "RGMC"
+const uint32_t VERSION = 3; // 2: meshes are stored after MeshOptimizer, 3: levels of detail
+
+struct MeshCacheHeader {
+    uint32_t magic;
+    uint32_t version;
+    uint32_t vertexSize;
+    uint32_t meshCount;
+    uint64_t sourceSize;
+    int64_t  sourceMtime;
+    uint64_t sourceHash;
+};
+
+struct MeshCacheMeshHeader {
+    uint32_t vertexCount;
+    uint32_t indexCount;
+    uint32_t textureCount;
+    uint32_t lodCount;
+};
+
+inline std::string CachePath(const std::string &sourcePath)
+{
+    return sourcePath + ".meshcache";
+}
+
+inline bool DescribeSource(const std::string &sourcePath, MeshCacheHeader &header)
+{
+    SourceStamp stamp;
+    if (!StampSource(sourcePath, stamp))
+        return false;
+    header.magic = MAGIC;
+    header.version = VERSION;
+    header.vertexSize = sizeof(Vertex);
+    header.sourceSize = stamp.size;
+    header.sourceMtime = stamp.mtime;
+    header.sourceHash = stamp.hash;
+    return true;
+}
+
+// sequential reader over the mapped cache that fails instead of reading past the end
+class Reader
+{
+public:
+    Reader(const unsigned char *data, size_t size) : data(data), size(size) {}
+
+    bool Read(void *destination, size_t bytes)
+    {
+        if (offset + bytes > size)
+            return false;
+        memcpy(destination, data + offset, bytes);
+        offset += (bytes + 3) & ~size_t(3);
+        return true;
+    }
+
+    bool ReadString(std::string &value)
+    {
+        uint32_t length;
+        if (!Read(&length, sizeof(length)) || offset + length > size)
+            return false;
+        value.assign(reinterpret_cast<const char*>(data + offset), length);
+        offset += (length + 3) & ~size_t(3);
+        return true;
+    }
+
+private:
+    const unsigned char *data;
+    size_t size;
+    size_t offset = 0;
+};
+
+// fills meshes from the cache of sourcePath, returns false when there is no usable cache
+inline bool Load(const std::string &sourcePath, vector<MeshData> &meshes)
+{
+    MappedFile cache(CachePath(sourcePath));
+    if (!cache.Data())
+        return false;
+
+    Reader reader(cache.Data(), cache.Size());
+    MeshCacheHeader header, expected;
+    if (!reader.Read(&header, sizeof(header)) || !DescribeSource(sourcePath, expected))
+        return false;
+    if (header.magic != expected.magic || header.version != expected.version || header.vertexSize != expected.vertexSize ||
+        header.sourceSize != expected.sourceSize || header.sourceMtime != expected.sourceMtime ||
+        header.sourceHash != expected.sourceHash)
+        return false;
+
+    vector<MeshData> result(header.meshCount);
+    for (MeshData &mesh : result)
+    {
+        MeshCacheMeshHeader meshHeader;
+        if (!reader.Read(&meshHeader, sizeof(meshHeader)))
+            return false;
+        mesh.vertices.resize(meshHeader.vertexCount);
+        mesh.indices.resize(meshHeader.indexCount);
+        mesh.textures.resize(meshHeader.textureCount);
+        if (!reader.Read(mesh.vertices.data(), mesh.vertices.size() * sizeof(Vertex)) ||
+            !reader.Read(mesh.indices.data(), mesh.indices.size() * sizeof(unsigned int)))
+            return false;
+        mesh.lods.resize(meshHeader.lodCount);
+        for (vector<unsigned int> &lod : mesh.lods)
+        {
+            uint32_t count;
+            if (!reader.Read(&count, sizeof(count)) || count > mesh.indices.size())
+                return false;
+            lod.resize(count);
+            if (!reader.Read(lod.data(), lod.size() * sizeof(unsigned int)))
+                return false;
+        }
+        for (Texture &texture : mesh.textures)
+        {
+            texture.id = 0;
+            if (!reader.ReadString(texture.type) || !reader.ReadString(texture.path))
+                return false;
+        }
+    }
+    meshes.swap(result);
+    return true;
+}
+
+inline void writePadded(std::ofstream &out, const void *data, size_t bytes)
+{
+    static const char padding[4] = {0, 0, 0, 0};
+    out.write(static_cast<const char*>(data), bytes);
+    out.write(padding, ((bytes + 3) & ~size_t(3)) - bytes);
+}
+
+inline void writeString(std::ofstream &out, const std::string &value)
+{
+    uint32_t length = value.size();
+    writePadded(out, &length, sizeof(length));
+    writePadded(out, value.data(), value.size());
+}
+
+// writes the cache for sourcePath; failures (e.g. a read-only resources directory) only cost the next start-up
+inline bool Save(const std::string &sourcePath, const vector<MeshData> &meshes)
+{
+    MeshCacheHeader header;
+    if (!DescribeSource(sourcePath, header))
+        return false;
+    header.meshCount = meshes.size();
+
+    // write to a temporary file and rename it, so a crash or a concurrent reader never sees a partial cache
+    std::string cachePath = CachePath(sourcePath);
+    std::string temporaryPath = cachePath + ".tmp";
+    {
+        std::ofstream out(temporaryPath, std::ios::binary | std::ios::trunc);
+        if (!out)
+            return false;
+        writePadded(out, &header, sizeof(header));
+        for (const MeshData &mesh : meshes)
+        {
+            MeshCacheMeshHeader meshHeader;
+            meshHeader.vertexCount = mesh.vertices.size();
+            meshHeader.indexCount = mesh.indices.size();
+            meshHeader.textureCount = mesh.textures.size();
+            meshHeader.lodCount = mesh.lods.size();
+            writePadded(out, &meshHeader, sizeof(meshHeader));
+            writePadded(out, mesh.vertices.data(), mesh.vertices.size() * sizeof(Vertex));
+            writePadded(out, mesh.indices.data(), mesh.indices.size() * sizeof(unsigned int));
+            for (const vector<unsigned int> &lod : mesh.lods)
+            {
+                uint32_t count = lod.size();
+                writePadded(out, &count, sizeof(count));
+                writePadded(out, lod.data(), lod.size() * sizeof(unsigned int));
+            }
+            for (const Texture &texture : mesh.textures)
+            {
+                writeString(out, texture.type);
+                writeString(out, texture.path);
+            }
+        }
+        if (!out)
+        {
+            out.close();
+            std::remove(temporaryPath.c_str());
+            return false;
+        }
+    }
+    return std::rename(temporaryPath.c_str(), cachePath.c_str()) == 0;
+}
+
+}
+#endif
@@ -0,0 +1,207 @@
+#ifndef MESH_OPTIMIZER_H
+#define MESH_OPTIMIZER_H
+
+#include <learnopengl/vertex.h>
+#include <learnopengl/mapped_file.h>
+
+#include <cstdint>
+#include <cstring>
+#include <unordered_map>
+#include <vector>
+
+// Import time reordering of indexed triangle meshes, run once before a mesh goes into the mesh cache:
+//
+//     DeduplicateVertices  merges bit-identical vertices, which Assimp emits per face corner
+//     OptimizeVertexCache  reorders triangles for the post-transform vertex cache (Tipsify, Sander et al. 2007)
+//     OptimizeVertexFetch  renumbers vertices in the order the triangles first use them, dropping unused ones
+//
+// ACMR (average cache miss ratio, transformed vertices per triangle) measures the result against a FIFO cache.
+namespace MeshOptimizer {
+
+const unsigned int CACHE_SIZE = 16;
+
+struct Report {
+    size_t verticesBefore = 0;
+    size_t verticesAfter = 0;
+    float acmrBefore = 0.0f;
+    float acmrAfter = 0.0f;
+};
+
+// vertex shader invocations per triangle with a FIFO cache of cacheSize entries; 3 is the worst, 0.5 the ideal
+inline float ACMR(const std::vector<unsigned int> &indices, size_t vertexCount, unsigned int cacheSize = CACHE_SIZE)
+{
+    if (indices.size() < 3)
+        return 0.0f;
+    // a vertex is in the cache while fewer than cacheSize misses happened since it was loaded
+    std::vector<size_t> loadedAt(vertexCount, SIZE_MAX);
+    size_t misses = 0;
+    for (unsigned int index : indices)
+    {
+        if (loadedAt[index] == SIZE_MAX || misses - loadedAt[index] >= cacheSize)
+        {
+            loadedAt[index] = misses;
+            misses++;
+        }
+    }
+    return float(misses) / float(indices.size() / 3);
+}
+
+inline void DeduplicateVertices(std::vector<Vertex> &vertices, std::vector<unsigned int> &indices)
+{
+    struct VertexHash {
+        size_t operator()(const Vertex &vertex) const
+        {
+            return HashBytes(reinterpret_cast<const unsigned char*>(&vertex), sizeof(Vertex));
+        }
+    };
+    struct VertexEqual {
+        bool operator()(const Vertex &a, const Vertex &b) const
+        {
+            return memcmp(&a, &b, sizeof(Vertex)) == 0;
+        }
+    };
+
+    std::unordered_map<Vertex, unsigned int, VertexHash, VertexEqual> unique;
+    unique.reserve(vertices.size());
+    std::vector<unsigned int> remap(vertices.size());
+    std::vector<Vertex> merged;
+    merged.reserve(vertices.size());
+    for (size_t i = 0; i < vertices.size(); i++)
+    {
+        auto inserted = unique.insert(std::make_pair(vertices[i], (unsigned int)merged.size()));
+        if (inserted.second)
+            merged.push_back(vertices[i]);
+        remap[i] = inserted.first->second;
+    }
+    for (unsigned int &index : indices)
+        index = remap[index];
+    vertices.swap(merged);
+}
+
+// Tipsify: fans around one vertex at a time, moving on to the neighbour that is still in the cache and has the
+// fewest triangles left, or back along the dead-end stack when none qualifies. Linear in the triangle count.
+inline void OptimizeVertexCache(std::vector<unsigned int> &indices, size_t vertexCount, unsigned int cacheSize = CACHE_SIZE)
+{
+    size_t triangleCount = indices.size() / 3;
+    if (triangleCount == 0)
+        return;
+
+    // triangles around every vertex, as offsets into one array
+    std::vector<unsigned int> liveCount(vertexCount, 0);
+    for (unsigned int index : indices)
+        liveCount[index]++;
+    std::vector<size_t> adjacencyStart(vertexCount + 1, 0);
+    for (size_t v = 0; v < vertexCount; v++)
+        adjacencyStart[v + 1] = adjacencyStart[v] + liveCount[v];
+    std::vector<unsigned int> adjacency(indices.size());
+    {
+        std::vector<size_t> fill(adjacencyStart.begin(), adjacencyStart.end() - 1);
+        for (size_t i = 0; i < indices.size(); i++)
+            adjacency[fill[indices[i]]++] = (unsigned int)(i / 3);
+    }
+
+    std::vector<size_t> cacheTime(vertexCount, 0);
+    std::vector<bool> emitted(triangleCount, false);
+    std::vector<unsigned int> deadEnd, candidates, result;
+    result.reserve(indices.size());
+    size_t time = cacheSize + 1;
+    size_t cursor = 0;    // scan position for when the dead-end stack runs dry
+    long fanning = 0;
+
+    while (fanning >= 0)
+    {
+        candidates.clear();
+        for (size_t a = adjacencyStart[fanning]; a < adjacencyStart[fanning + 1]; a++)
+        {
+            unsigned int triangle = adjacency[a];
+            if (emitted[triangle])
+                continue;
+            emitted[triangle] = true;
+            for (int corner = 0; corner < 3; corner++)
+            {
+                unsigned int v = indices[triangle * 3 + corner];
+                result.push_back(v);
+                deadEnd.push_back(v);
+                candidates.push_back(v);
+                liveCount[v]--;
+                if (time - cacheTime[v] > cacheSize)
+                {
+                    cacheTime[v] = time;
+                    time++;
+                }
+            }
+        }
+
+        // the candidate that stays in the cache through its remaining fan and is oldest in it
+        // (its age is at least 1, the ones that don't qualify keep priority 0 and leave best unset)
+        long best = -1;
+        long bestPriority = 0;
+        for (unsigned int v : candidates)
+        {
+            if (liveCount[v] == 0)
+                continue;
+            long priority = 0;
+            if (time - cacheTime[v] + 2 * liveCount[v] <= cacheSize)
+                priority = long(time - cacheTime[v]);
+            if (priority > bestPriority)
+            {
+                bestPriority = priority;
+                best = v;
+            }
+        }
+        if (best < 0)
+        {
+            // dead end: the most recent vertex with triangles left, else the next one in input order
+            while (!deadEnd.empty() && best < 0)
+            {
+                unsigned int v = deadEnd.back();
+                deadEnd.pop_back();
+                if (liveCount[v] > 0)
+                    best = v;
+            }
+            while (best < 0 && cursor < vertexCount)
+            {
+                if (liveCount[cursor] > 0)
+                    best = long(cursor);
+                cursor++;
+            }
+        }
+        fanning = best;
+    }
+    indices.swap(result);
+}
+
+// renumbers the vertices in the order the index buffer first reaches them, so fetches walk memory forwards
+inline void OptimizeVertexFetch(std::vector<Vertex> &vertices, std::vector<unsigned int> &indices)
+{
+    const unsigned int UNUSED = ~0u;
+    std::vector<unsigned int> remap(vertices.size(), UNUSED);
+    std::vector<Vertex> ordered;
+    ordered.reserve(vertices.size());
+    for (unsigned int &index : indices)
+    {
+        if (remap[index] == UNUSED)
+        {
+            remap[index] = (unsigned int)ordered.size();
+            ordered.push_back(vertices[index]);
+        }
+        index = remap[index];
+    }
+    vertices.swap(ordered);
+}
+
+// the whole pass, in the order the steps depend on each other
+inline Report Optimize(std::vector<Vertex> &vertices, std::vector<unsigned int> &indices)
+{
+    Report report;
+    report.verticesBefore = vertices.size();
+    report.acmrBefore = ACMR(indices, vertices.size());
+    DeduplicateVertices(vertices, indices);
+    OptimizeVertexCache(indices, vertices.size());
+    OptimizeVertexFetch(vertices, indices);
+    report.verticesAfter = vertices.size();
+    report.acmrAfter = ACMR(indices, vertices.size());
+    return report;
+}
+}
+#endif
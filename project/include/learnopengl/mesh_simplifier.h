@@ -0,0 +1,315 @@
+#ifndef MESH_SIMPLIFIER_H
+#define MESH_SIMPLIFIER_H
+
+#include <glm/glm.hpp>
+
+#include <learnopengl/bounds.h>
+#include <learnopengl/lod.h>
+#include <learnopengl/mesh_optimizer.h>
+#include <learnopengl/vertex.h>
+
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <numeric>
+#include <unordered_map>
+#include <vector>
+
+// Import time levels of detail by edge collapse with quadric error metrics (Garland & Heckbert 1997). Every
+// collapse moves a vertex onto one of its neighbours, so only the index buffer changes: all levels share the
+// vertices of the full mesh and just add an index range each. To keep the simplified mesh looking like the
+// original:
+//
+//     vertices sharing their position with another vertex (UV or normal seams) never move, so seams stay closed
+//     border vertices only slide along their border, which also carries a quadric of its own to hold the outline
+//     collapses that would flip a triangle over are rejected
+//
+// Errors are distances relative to the mesh extent (the longest side of its box).
+namespace MeshSimplifier {
+
+const double BORDER_WEIGHT = 10.0;
+
+// simplification steps of the levels after the full mesh: share of the triangles to keep, largest error allowed
+struct LevelTarget {
+    float triangleRatio;
+    float maxError;
+};
+const LevelTarget LEVELS[MAX_LODS - 1] = {{0.5f, 0.01f}, {0.25f, 0.03f}, {0.1f, 0.08f}};
+
+// a level that keeps more than this share of the previous level's triangles isn't worth drawing
+const float MIN_REDUCTION = 0.8f;
+
+// sum of squared plane distances, as the upper triangle of the symmetric 4x4 matrix, and of the plane weights
+struct Quadric {
+    double a00 = 0, a01 = 0, a02 = 0, a03 = 0, a11 = 0, a12 = 0, a13 = 0, a22 = 0, a23 = 0, a33 = 0;
+    double weight = 0;
+
+    // the plane dot(normal, p) + distance = 0, normal of unit length
+    void AddPlane(const glm::dvec3 &normal, double distance, double planeWeight)
+    {
+        a00 += planeWeight * normal.x * normal.x;
+        a01 += planeWeight * normal.x * normal.y;
+        a02 += planeWeight * normal.x * normal.z;
+        a03 += planeWeight * normal.x * distance;
+        a11 += planeWeight * normal.y * normal.y;
+        a12 += planeWeight * normal.y * normal.z;
+        a13 += planeWeight * normal.y * distance;
+        a22 += planeWeight * normal.z * normal.z;
+        a23 += planeWeight * normal.z * distance;
+        a33 += planeWeight * distance * distance;
+        weight += planeWeight;
+    }
+
+    void Add(const Quadric &other)
+    {
+        a00 += other.a00; a01 += other.a01; a02 += other.a02; a03 += other.a03;
+        a11 += other.a11; a12 += other.a12; a13 += other.a13;
+        a22 += other.a22; a23 += other.a23;
+        a33 += other.a33;
+        weight += other.weight;
+    }
+
+    // weighted mean of the squared distances of p to the planes
+    double Error(const glm::dvec3 &p) const
+    {
+        if (weight <= 0.0)
+            return 0.0;
+        double error = a00 * p.x * p.x + 2.0 * a01 * p.x * p.y + 2.0 * a02 * p.x * p.z + 2.0 * a03 * p.x +
+                       a11 * p.y * p.y + 2.0 * a12 * p.y * p.z + 2.0 * a13 * p.y +
+                       a22 * p.z * p.z + 2.0 * a23 * p.z + a33;
+        return std::fabs(error) / weight;
+    }
+};
+
+inline uint64_t edgeKey(unsigned int a, unsigned int b)
+{
+    return a < b ? (uint64_t)a << 32 | b : (uint64_t)b << 32 | a;
+}
+
+// how many triangles use each edge; edges used by a single one are on a border
+inline void countEdges(const std::vector<unsigned int> &indices, std::unordered_map<uint64_t, unsigned int> &edges)
+{
+    edges.clear();
+    edges.reserve(indices.size());
+    for (size_t i = 0; i < indices.size(); i += 3)
+    {
+        for (int corner = 0; corner < 3; corner++)
+            edges[edgeKey(indices[i + corner], indices[i + (corner + 1) % 3])]++;
+    }
+}
+
+// simplifies until at most targetIndexCount indices are left or the next collapse would cost more than
+// targetError; returns the new index buffer, still referring to vertices. resultError receives the largest
+// error of a collapse that was made.
+inline std::vector<unsigned int> Simplify(const std::vector<Vertex> &vertices, const std::vector<unsigned int> &indices,
+                                          size_t targetIndexCount, float targetError, float *resultError = nullptr)
+{
+    std::vector<unsigned int> result(indices);
+    if (resultError)
+        *resultError = 0.0f;
+    size_t vertexCount = vertices.size();
+    if (result.size() <= targetIndexCount || vertexCount == 0)
+        return result;
+
+    BoundingBox box;
+    for (const Vertex &vertex : vertices)
+        box.Expand(vertex.Position);
+    glm::vec3 size = box.max - box.min;
+    float extent = std::max(size.x, std::max(size.y, size.z));
+    if (extent <= 0.0f)
+        return result;
+    std::vector<glm::dvec3> positions(vertexCount);
+    for (size_t i = 0; i < vertexCount; i++)
+        positions[i] = glm::dvec3((vertices[i].Position - box.min) / extent);
+
+    // seams: vertices with the same position end up next to each other when sorted by position
+    std::vector<bool> locked(vertexCount, false);
+    {
+        std::vector<unsigned int> order(vertexCount);
+        std::iota(order.begin(), order.end(), 0u);
+        auto less = [&](unsigned int a, unsigned int b) {
+            const glm::vec3 &p = vertices[a].Position, &q = vertices[b].Position;
+            return p.x != q.x ? p.x < q.x : p.y != q.y ? p.y < q.y : p.z < q.z;
+        };
+        std::sort(order.begin(), order.end(), less);
+        for (size_t i = 1; i < vertexCount; i++)
+        {
+            if (vertices[order[i]].Position == vertices[order[i - 1]].Position)
+                locked[order[i]] = locked[order[i - 1]] = true;
+        }
+    }
+
+    // every vertex starts with the planes of its triangles, weighted by area, and border vertices also with the
+    // planes through their border edges, perpendicular to the triangle
+    std::vector<Quadric> quadrics(vertexCount);
+    std::unordered_map<uint64_t, unsigned int> edges;
+    countEdges(result, edges);
+    for (size_t i = 0; i < result.size(); i += 3)
+    {
+        const unsigned int *triangle = &result[i];
+        glm::dvec3 normal = glm::cross(positions[triangle[1]] - positions[triangle[0]], positions[triangle[2]] - positions[triangle[0]]);
+        double area = glm::length(normal);
+        if (area <= 0.0)
+            continue;
+        normal /= area;
+        for (int corner = 0; corner < 3; corner++)
+            quadrics[triangle[corner]].AddPlane(normal, -glm::dot(normal, positions[triangle[0]]), area * 0.5);
+        for (int corner = 0; corner < 3; corner++)
+        {
+            unsigned int a = triangle[corner], b = triangle[(corner + 1) % 3];
+            if (edges[edgeKey(a, b)] != 1)
+                continue;
+            glm::dvec3 edge = positions[b] - positions[a];
+            glm::dvec3 borderNormal = glm::cross(edge, normal);
+            double length = glm::length(borderNormal);
+            if (length <= 0.0)
+                continue;
+            borderNormal /= length;
+            double weight = glm::dot(edge, edge) * BORDER_WEIGHT;
+            quadrics[a].AddPlane(borderNormal, -glm::dot(borderNormal, positions[a]), weight);
+            quadrics[b].AddPlane(borderNormal, -glm::dot(borderNormal, positions[a]), weight);
+        }
+    }
+
+    struct Collapse {
+        unsigned int from, to;
+        double error;
+    };
+    std::vector<Collapse> collapses;
+    std::vector<bool> border(vertexCount), touched(vertexCount);
+    std::vector<unsigned int> remap(vertexCount), adjacency;
+    std::vector<size_t> adjacencyStart(vertexCount + 1);
+    double maxError = double(targetError) * targetError;
+    double madeError = 0.0;
+
+    // passes of independent collapses, cheapest first, until the target is met or nothing is cheap enough
+    while (result.size() > targetIndexCount)
+    {
+        countEdges(result, edges);
+        std::fill(border.begin(), border.end(), false);
+        for (const auto &edge : edges)
+        {
+            if (edge.second == 1)
+                border[edge.first >> 32] = border[edge.first & 0xffffffffu] = true;
+        }
+
+        collapses.clear();
+        auto consider = [&](unsigned int from, unsigned int to) {
+            if (locked[from] || (border[from] && edges[edgeKey(from, to)] != 1))
+                return;
+            Quadric quadric = quadrics[from];
+            quadric.Add(quadrics[to]);
+            collapses.push_back(Collapse{from, to, quadric.Error(positions[to])});
+        };
+        for (const auto &edge : edges)
+        {
+            consider(edge.first >> 32, edge.first & 0xffffffffu);
+            consider(edge.first & 0xffffffffu, edge.first >> 32);
+        }
+        std::sort(collapses.begin(), collapses.end(), [](const Collapse &a, const Collapse &b) { return a.error < b.error; });
+        if (collapses.empty() || collapses[0].error > maxError)
+            break;
+
+        // triangles around every vertex, for the flip test
+        std::fill(adjacencyStart.begin(), adjacencyStart.end(), 0);
+        for (unsigned int index : result)
+            adjacencyStart[index + 1]++;
+        for (size_t v = 0; v < vertexCount; v++)
+            adjacencyStart[v + 1] += adjacencyStart[v];
+        adjacency.resize(result.size());
+        {
+            std::vector<size_t> fill(adjacencyStart.begin(), adjacencyStart.end() - 1);
+            for (size_t i = 0; i < result.size(); i++)
+                adjacency[fill[result[i]]++] = (unsigned int)(i / 3);
+        }
+
+        std::iota(remap.begin(), remap.end(), 0u);
+        std::fill(touched.begin(), touched.end(), false);
+        size_t trianglesToRemove = (result.size() - targetIndexCount) / 3, removed = 0;
+        for (const Collapse &collapse : collapses)
+        {
+            if (collapse.error > maxError || removed >= trianglesToRemove)
+                break;
+            if (touched[collapse.from] || touched[collapse.to])
+                continue;
+
+            // the triangles around from must not flip once it sits on to, and none of their vertices may have
+            // moved earlier in this pass, or the test would look at stale positions
+            bool rejected = false;
+            unsigned int shared = 0;
+            for (size_t a = adjacencyStart[collapse.from]; a < adjacencyStart[collapse.from + 1] && !rejected; a++)
+            {
+                const unsigned int *triangle = &result[adjacency[a] * 3];
+                if (touched[triangle[0]] || touched[triangle[1]] || touched[triangle[2]])
+                    rejected = true;
+                if (triangle[0] == collapse.to || triangle[1] == collapse.to || triangle[2] == collapse.to)
+                {
+                    shared++;
+                    continue;
+                }
+                glm::dvec3 corners[3], moved[3];
+                for (int corner = 0; corner < 3; corner++)
+                {
+                    corners[corner] = positions[triangle[corner]];
+                    moved[corner] = triangle[corner] == collapse.from ? positions[collapse.to] : corners[corner];
+                }
+                glm::dvec3 before = glm::cross(corners[1] - corners[0], corners[2] - corners[0]);
+                glm::dvec3 after = glm::cross(moved[1] - moved[0], moved[2] - moved[0]);
+                if (glm::dot(before, after) <= 0.0)
+                    rejected = true;
+            }
+            if (rejected || shared == 0)
+                continue;
+
+            remap[collapse.from] = collapse.to;
+            quadrics[collapse.to].Add(quadrics[collapse.from]);
+            for (size_t a = adjacencyStart[collapse.from]; a < adjacencyStart[collapse.from + 1]; a++)
+            {
+                const unsigned int *triangle = &result[adjacency[a] * 3];
+                touched[triangle[0]] = touched[triangle[1]] = touched[triangle[2]] = true;
+            }
+            removed += shared;
+            madeError = std::max(madeError, collapse.error);
+        }
+        if (removed == 0)
+            break;
+
+        // apply the collapses and drop the triangles that became degenerate
+        size_t write = 0;
+        for (size_t i = 0; i < result.size(); i += 3)
+        {
+            unsigned int a = remap[result[i]], b = remap[result[i + 1]], c = remap[result[i + 2]];
+            if (a == b || b == c || a == c)
+                continue;
+            result[write++] = a;
+            result[write++] = b;
+            result[write++] = c;
+        }
+        result.resize(write);
+    }
+
+    if (resultError)
+        *resultError = (float)std::sqrt(madeError);
+    return result;
+}
+
+// the index buffers of the levels after the full mesh, coarsest last and ordered for the vertex cache; stops
+// early when a level wouldn't be much smaller than the one before
+inline std::vector<std::vector<unsigned int>> BuildLods(const std::vector<Vertex> &vertices, const std::vector<unsigned int> &indices)
+{
+    std::vector<std::vector<unsigned int>> lods;
+    size_t previous = indices.size();
+    for (const LevelTarget &level : LEVELS)
+    {
+        size_t target = size_t(indices.size() / 3 * level.triangleRatio) * 3;
+        std::vector<unsigned int> lod = Simplify(vertices, indices, target, level.maxError);
+        if (lod.empty() || lod.size() > previous * MIN_REDUCTION)
+            break;
+        MeshOptimizer::OptimizeVertexCache(lod, vertices.size());
+        previous = lod.size();
+        lods.push_back(std::move(lod));
+    }
+    return lods;
+}
+}
+#endif
@@ -12,32 +12,117 @@
 
 #include <learnopengl/mesh.h>
 #include <learnopengl/shader.h>
+#include <learnopengl/texture_cache.h>
+#include <learnopengl/mesh_cache.h>
+#include <learnopengl/mesh_optimizer.h>
+#include <learnopengl/mesh_simplifier.h>
+#include <learnopengl/render_queue.h>
 
 #include <string>
 #include <fstream>
 #include <sstream>
 #include <iostream>
+#include <algorithm>
+#include <cfloat>
 #include <map>
+#include <unordered_map>
 #include <vector>
 using namespace std;
 
 unsigned int TextureFromFile(const char *path, const string &directory, bool gamma = false);
 
-
+// everything read from a model file; the textures themselves are already fetched into the TextureCache
+struct ModelData {
+    string directory;
+    vector<MeshData> meshes;
+};
 
 class Model
 {
 public:
     // model data
-    vector<Texture> textures_loaded;	// stores all the textures loaded so far, optimization to make sure textures aren't loaded more than once.
+    vector<Texture> textures_loaded;	// every distinct texture of the model, each holding one reference in the TextureCache
     vector<Mesh>    meshes;
     string directory;
     bool gammaCorrection;
+    // bounding volumes of all meshes together, in model space
+    BoundingBox bounds;
+    BoundingSphere sphere;
 
     // constructor, expects a filepath to a 3D model.
-    Model(string const &path, bool gamma = false) : gammaCorrection(gamma)
+    Model(string const &path, bool gamma = false, VertexLayout layout = VertexLayout::Full) : gammaCorrection(gamma)
+    {
+        ModelData data = Import(path);
+        upload(data, layout);
+    }
+
+    // constructor from data imported earlier (possibly on another thread), must run on the thread owning the GL context.
+    // layout has to match the shader the model is drawn with, see VertexLayout
+    explicit Model(ModelData &data, bool gamma = false, VertexLayout layout = VertexLayout::Full) : gammaCorrection(gamma)
     {
-        loadModel(path);
+        upload(data, layout);
+    }
+
+    ~Model()
+    {
+        for(const Texture &texture : textures_loaded)
+            TextureCache::Instance().Release(texture.id);
+        for(const InstanceBuffer &buffer : instanceBuffers)
+        {
+            if(buffer.VBO != 0)
+                glDeleteBuffers(1, &buffer.VBO);
+        }
+    }
+
+    Model(const Model&) = delete;
+    Model& operator=(const Model&) = delete;
+
+    // reads the model and fetches the baked versions of all of its textures into the TextureCache. Doesn't touch any OpenGL state, so it is safe to call
+    // from a worker thread. The meshes come from the binary mesh cache next to the file when it is up to date,
+    // otherwise the file is parsed with ASSIMP and the cache is (re)written for the next run.
+    static ModelData Import(string const &path)
+    {
+        ModelData data;
+        // retrieve the directory path of the filepath
+        data.directory = path.substr(0, path.find_last_of('/'));
+
+        if(!MeshCache::Load(path, data.meshes))
+        {
+            // read file via ASSIMP
+            Assimp::Importer importer;
+            const aiScene* scene = importer.ReadFile(path, aiProcess_Triangulate | aiProcess_GenSmoothNormals | aiProcess_FlipUVs | aiProcess_CalcTangentSpace);
+            // check for errors
+            if(!scene || scene->mFlags & AI_SCENE_FLAGS_INCOMPLETE || !scene->mRootNode) // if is Not Zero
+            {
+                cout << "ERROR::ASSIMP:: " << importer.GetErrorString() << endl;
+                return data;
+            }
+
+            // process ASSIMP's root node recursively
+            processNode(scene->mRootNode, scene, data);
+            // the cache stores the optimized meshes and their levels of detail, so this only runs when the source changes
+            for(unsigned int i = 0; i < data.meshes.size(); i++)
+            {
+                MeshData &mesh = data.meshes[i];
+                MeshOptimizer::Report report = MeshOptimizer::Optimize(mesh.vertices, mesh.indices);
+                cout << "MESH_OPTIMIZER:: " << path << " mesh " << i << ": " << report.verticesBefore << " -> "
+                     << report.verticesAfter << " vertices, ACMR " << report.acmrBefore << " -> " << report.acmrAfter << endl;
+                mesh.lods = MeshSimplifier::BuildLods(mesh.vertices, mesh.indices);
+                cout << "MESH_SIMPLIFIER:: " << path << " mesh " << i << ": " << mesh.indices.size() / 3 << " triangles";
+                for(const vector<unsigned int> &lod : mesh.lods)
+                    cout << " -> " << lod.size() / 3;
+                cout << endl;
+            }
+            MeshCache::Save(path, data.meshes);
+        }
+
+        // the cache skips textures that are already there, also when another model brought them
+        for(const MeshData &mesh : data.meshes)
+        {
+            for(const Texture &texture : mesh.textures)
+                TextureCache::Instance().Fetch(data.directory + '/' + texture.path, textureUsage(texture));
+        }
+        return data;
     }
 
     // draws the model, and thus all its meshes
@@ -47,33 +132,161 @@ public:
             meshes[i].Draw(shader);
     }
 
+    // the most levels of detail any mesh has
+    unsigned int LodCount() const
+    {
+        unsigned int count = 1;
+        for(const Mesh &mesh : meshes)
+            count = std::max(count, mesh.LodCount());
+        return count;
+    }
+
+    // draws one copy of the model per instance with a single instanced draw call per mesh, at level lod.
+    // the shader is expected to read the model matrix from attribute locations 5-8 and the normal matrix
+    // from 9-11 (see decoration_instanced.vs)
+    void DrawInstanced(Shader &shader, const vector<InstanceData> &instances, unsigned int lod = 0)
+    {
+        if(instances.empty())
+            return;
+        unsigned int instanceVBO = uploadInstances(instances, lod);
+        for(unsigned int i = 0; i < meshes.size(); i++)
+            meshes[i].DrawInstanced(shader, instanceVBO, instances.size(), lod);
+    }
+
+    // same, for instances already uploaded to instanceVBO, e.g. static ones drawn again and again
+    void DrawInstanced(Shader &shader, unsigned int instanceVBO, unsigned int instanceCount, unsigned int lod = 0)
+    {
+        for(unsigned int i = 0; i < meshes.size(); i++)
+            meshes[i].DrawInstanced(shader, instanceVBO, instanceCount, lod);
+    }
+
+    // same, for transforms that change every frame: their normal matrices are computed here, as one batch
+    void DrawInstanced(Shader &shader, const vector<glm::mat4> &transforms)
+    {
+        BuildInstanceData(transforms, transformInstances);
+        DrawInstanced(shader, transformInstances);
+    }
+
+    // queues one draw per mesh with the model matrix, each ordered by the distance of its own bounding sphere
+    void Submit(RenderQueue &queue, Shader &shader, const glm::mat4 &transform)
+    {
+        for(unsigned int i = 0; i < meshes.size(); i++)
+        {
+            glm::vec3 center = glm::vec3(transform * glm::vec4(meshes[i].sphere.center, 1.0f));
+            queue.Submit(RenderQueue::OPAQUE_PASS, shader, meshes[i], transform, center);
+        }
+    }
+
+    // uploads the instances now and queues one instanced draw per mesh at level lod, ordered by the nearest
+    // instance. Every level has its own instance buffer, so all levels can be queued in the same frame. With a
+    // depthShader the instances are drawn into a depth prepass first and shaded in the depth equal pass
+    void SubmitInstanced(RenderQueue &queue, Shader &shader, const vector<InstanceData> &instances, unsigned int lod = 0,
+                         Shader *depthShader = nullptr)
+    {
+        if(instances.empty())
+            return;
+        unsigned int instanceVBO = uploadInstances(instances, lod);
+        float distance = FLT_MAX;
+        for(const InstanceData &instance : instances)
+            distance = std::min(distance, queue.Distance(glm::vec3(instance.model[3])));
+        RenderQueue::Pass pass = depthShader ? RenderQueue::DEPTH_EQUAL_PASS : RenderQueue::OPAQUE_PASS;
+        for(unsigned int i = 0; i < meshes.size(); i++)
+        {
+            if(depthShader)
+                queue.SubmitInstanced(RenderQueue::DEPTH_PREPASS, *depthShader, meshes[i], instanceVBO, instances.size(), distance, lod);
+            queue.SubmitInstanced(pass, shader, meshes[i], instanceVBO, instances.size(), distance, lod);
+        }
+    }
+
     void SetShaderTextureNamePrefix(std::string prefix) {
         for (Mesh& mesh: meshes) {
-            mesh.glslIdentifierPrefix = prefix;
+            mesh.SetShaderTextureNamePrefix(prefix);
         }
     }
 private:
-    // loads a model with supported ASSIMP extensions from file and stores the resulting meshes in the meshes vector.
-    void loadModel(string const &path)
+    // per-instance model and normal matrices shared by all meshes of the model, one buffer per level of detail
+    struct InstanceBuffer {
+        unsigned int VBO = 0;
+        size_t capacity = 0;
+    };
+    InstanceBuffer instanceBuffers[MAX_LODS];
+    vector<InstanceData> transformInstances;
+
+    // streams the instances into the buffer of level lod, creating and growing it on first use
+    unsigned int uploadInstances(const vector<InstanceData> &instances, unsigned int lod)
     {
-        // read file via ASSIMP
-        Assimp::Importer importer;
-        const aiScene* scene = importer.ReadFile(path, aiProcess_Triangulate | aiProcess_GenSmoothNormals | aiProcess_FlipUVs | aiProcess_CalcTangentSpace);
-        // check for errors
-        if(!scene || scene->mFlags & AI_SCENE_FLAGS_INCOMPLETE || !scene->mRootNode) // if is Not Zero
+        InstanceBuffer &buffer = instanceBuffers[std::min(lod, MAX_LODS - 1)];
+        if(buffer.VBO == 0)
+            glGenBuffers(1, &buffer.VBO);
+        glBindBuffer(GL_ARRAY_BUFFER, buffer.VBO);
+        if(instances.size() > buffer.capacity)
         {
-            cout << "ERROR::ASSIMP:: " << importer.GetErrorString() << endl;
-            return;
+            buffer.capacity = instances.size();
+            glBufferData(GL_ARRAY_BUFFER, buffer.capacity * sizeof(InstanceData), &instances[0], GL_STREAM_DRAW);
         }
-        // retrieve the directory path of the filepath
-        directory = path.substr(0, path.find_last_of('/'));
+        else
+        {
+            glBufferSubData(GL_ARRAY_BUFFER, 0, instances.size() * sizeof(InstanceData), &instances[0]);
+        }
+        return buffer.VBO;
+    }
 
-        // process ASSIMP's root node recursively
-        processNode(scene->mRootNode, scene);
+    static TextureUsage textureUsage(const Texture &texture)
+    {
+        return texture.type == "texture_normal" ? TextureUsage::Normal : TextureUsage::Color;
+    }
+
+    // acquires the textures and copies every mesh into the geometry arena
+    void upload(ModelData &data, VertexLayout layout)
+    {
+        directory = data.directory;
+        // all meshes are quantized across the model box
+        VertexFormat format;
+        format.layout = layout;
+        for(const MeshData &mesh : data.meshes)
+        {
+            for(const Vertex &vertex : mesh.vertices)
+                format.positionBounds.Expand(vertex.Position);
+        }
+        unordered_map<string, unsigned int> acquired;
+        meshes.reserve(data.meshes.size());
+        for(unsigned int i = 0; i < data.meshes.size(); i++)
+        {
+            MeshData &mesh = data.meshes[i];
+            for(Texture &texture : mesh.textures)
+            {
+                auto it = acquired.find(texture.path);
+                if(it == acquired.end())
+                {
+                    texture.id = TextureCache::Instance().Acquire(directory + '/' + texture.path, textureUsage(texture));
+                    acquired[texture.path] = texture.id;
+                    textures_loaded.push_back(texture);
+                }
+                else
+                    texture.id = it->second;
+            }
+            meshes.push_back(Mesh(std::move(mesh.vertices), std::move(mesh.indices), std::move(mesh.textures), format, mesh.lods));
+        }
+        computeBounds();
+    }
+
+    // the model sphere is centered on the model box and encloses the sphere of every mesh
+    void computeBounds()
+    {
+        for(const Mesh &mesh : meshes)
+            bounds.Expand(mesh.bounds);
+        if(bounds.Empty())
+            return;
+        sphere.center = bounds.Center();
+        for(const Mesh &mesh : meshes)
+        {
+            if(!mesh.bounds.Empty())
+                sphere.radius = std::max(sphere.radius, glm::distance(sphere.center, mesh.sphere.center) + mesh.sphere.radius);
+        }
     }
 
     // processes a node in a recursive fashion. Processes each individual mesh located at the node and repeats this process on its children nodes (if any).
-    void processNode(aiNode *node, const aiScene *scene)
+    static void processNode(aiNode *node, const aiScene *scene, ModelData &data)
     {
         // process each mesh located at the current node
         for(unsigned int i = 0; i < node->mNumMeshes; i++)
@@ -81,23 +294,25 @@ private:
             // the node object only contains indices to index the actual objects in the scene.
             // the scene contains all the data, node is just to keep stuff organized (like relations between nodes).
             aiMesh* mesh = scene->mMeshes[node->mMeshes[i]];
-            meshes.push_back(processMesh(mesh, scene));
+            data.meshes.push_back(processMesh(mesh, scene));
         }
         // after we've processed all of the meshes (if any) we then recursively process each of the children nodes
         for(unsigned int i = 0; i < node->mNumChildren; i++)
         {
-            processNode(node->mChildren[i], scene);
+            processNode(node->mChildren[i], scene, data);
         }
 
     }
 
-    Mesh processMesh(aiMesh *mesh, const aiScene *scene)
+    static MeshData processMesh(aiMesh *mesh, const aiScene *scene)
     {
         // data to fill
-        vector<Vertex> vertices;
-        vector<unsigned int> indices;
-        vector<Texture> textures;
-
+        MeshData result;
+        vector<Vertex> &vertices = result.vertices;
+        vector<unsigned int> &indices = result.indices;
+        vector<Texture> &textures = result.textures;
+        vertices.reserve(mesh->mNumVertices);
+        indices.reserve(mesh->mNumFaces * 3);
         // walk through each of the mesh's vertices
         for(unsigned int i = 0; i < mesh->mNumVertices; i++)
         {
@@ -178,39 +393,23 @@ private:
 
 
 
-        // return a mesh object created from the extracted mesh data
-        return Mesh(vertices, indices, textures);
+        return result;
     }
 
-    // checks all material textures of a given type and loads the textures if they're not loaded yet.
-    // the required info is returned as a Texture struct.
-    vector<Texture> loadMaterialTextures(aiMaterial *mat, aiTextureType type, string typeName)
+    // collects all material textures of a given type, the textures are loaded once the whole model is read.
+    // the required info is returned as a Texture struct, its id is assigned on upload.
+    static vector<Texture> loadMaterialTextures(aiMaterial *mat, aiTextureType type, string typeName)
     {
         vector<Texture> textures;
         for(unsigned int i = 0; i < mat->GetTextureCount(type); i++)
         {
             aiString str;
             mat->GetTexture(type, i, &str);
-            // check if texture was loaded before and if so, continue to next iteration: skip loading a new texture
-            bool skip = false;
-            for(unsigned int j = 0; j < textures_loaded.size(); j++)
-            {
-                if(std::strcmp(textures_loaded[j].path.data(), str.C_Str()) == 0)
-                {
-                    textures.push_back(textures_loaded[j]);
-                    skip = true; // a texture with the same filepath has already been loaded, continue to next one. (optimization)
-                    break;
-                }
-            }
-            if(!skip)
-            {   // if texture hasn't been loaded already, load it
-                Texture texture;
-                texture.id = TextureFromFile(str.C_Str(), this->directory);
-                texture.type = typeName;
-                texture.path = str.C_Str();
-                textures.push_back(texture);
-                textures_loaded.push_back(texture);  // store it as texture loaded for entire model, to ensure we won't unnecesery load duplicate textures.
-            }
+            Texture texture;
+            texture.id = 0;
+            texture.type = typeName;
+            texture.path = str.C_Str();
+            textures.push_back(texture);
         }
         return textures;
     }
@@ -222,38 +421,7 @@ unsigned int TextureFromFile(const char *path, const string &directory, bool gam
     string filename = string(path);
     filename = directory + '/' + filename;
 
-    unsigned int textureID;
-    glGenTextures(1, &textureID);
-
-    int width, height, nrComponents;
-    unsigned char *data = stbi_load(filename.c_str(), &width, &height, &nrComponents, 0);
-    if (data)
-    {
-        GLenum format;
-        if (nrComponents == 1)
-            format = GL_RED;
-        else if (nrComponents == 3)
-            format = GL_RGB;
-        else if (nrComponents == 4)
-            format = GL_RGBA;
-
-        glBindTexture(GL_TEXTURE_2D, textureID);
-        glTexImage2D(GL_TEXTURE_2D, 0, format, width, height, 0, format, GL_UNSIGNED_BYTE, data);
-        glGenerateMipmap(GL_TEXTURE_2D);
-
-        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_REPEAT);
-        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_REPEAT);
-        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR_MIPMAP_LINEAR);
-        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
-
-        stbi_image_free(data);
-    }
-    else
-    {
-        std::cout << "Texture failed to load at path: " << path << std::endl;
-        stbi_image_free(data);
-    }
-
-    return textureID;
+    // the texture stays in the TextureCache, shared with every other user of the same file
+    return TextureCache::Instance().Acquire(filename, TextureUsage::Color);
 }
 #endif
@@ -0,0 +1,212 @@
+#ifndef OCCLUSION_CULLER_H
+#define OCCLUSION_CULLER_H
+
+#include <glad/glad.h>
+
+#include <glm/glm.hpp>
+
+#include <learnopengl/bounds.h>
+#include <learnopengl/gl_state.h>
+#include <learnopengl/shader.h>
+
+#include <algorithm>
+#include <cmath>
+#include <iostream>
+#include <vector>
+
+// Hierarchical-Z occlusion culling on GL 3.3. Every frame:
+//
+//     culler.BeginOccluders();        // a reduced resolution target, depth cleared to the far plane
+//     house->Draw(occluderShader);    // the big occluders, occluder.vs/.fs store their depth as a color
+//     culler.EndOccluders();          // max-reduces the depth into a mip chain, a texel of level i covering
+//                                     // 2^i x 2^i texels of the base
+//     culler.Queue(spheres);          // bounding spheres of the candidates, e.g. InstanceList::VisibleSpheres
+//     culler.Run();                   // tests them all in one transform feedback pass and reads the results back
+//     culler.Visible(first)           // per queued sphere, in queue order
+//
+// The test (hiz_test.vs) projects the box around each sphere, picks the mip level where that rectangle spans
+// at most 2x2 texels and compares the nearest depth of the box with the farthest occluder depth there. Boxes
+// reaching behind the near plane always pass. The occluders are rasterized at reduced resolution, so objects
+// peeking out by less than a texel can be dropped; the pyramid is sized to keep that below a couple of pixels.
+//
+// The results are read back in the same frame, so the CPU waits for the occluder pass; it's a small pass and
+// this keeps objects from popping in a frame late when they come out from behind an occluder.
+class OcclusionCuller
+{
+public:
+    // width x height is the base of the pyramid; downsampleShader is fullscreen.vs with hiz_downsample.fs, testShader hiz_test.vs/.fs
+    // built with {"visible"} as its transform feedback varyings
+    OcclusionCuller(unsigned int width, unsigned int height, Shader &downsampleShader, Shader &testShader)
+        : width(width), height(height), downsampleShader(downsampleShader), testShader(testShader)
+    {
+        levels = 1;
+        while ((std::max(width, height) >> levels) > 0)
+            levels++;
+
+        GLStateCache &state = GLStateCache::Instance();
+        glGenTextures(1, &pyramid);
+        state.EditTexture(0, GL_TEXTURE_2D, pyramid);
+        for (unsigned int level = 0; level < levels; level++)
+            glTexImage2D(GL_TEXTURE_2D, level, GL_R32F, levelSize(width, level), levelSize(height, level), 0, GL_RED, GL_FLOAT, nullptr);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST_MIPMAP_NEAREST);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAX_LEVEL, levels - 1);
+
+        // one framebuffer per level; level 0 also gets a depth buffer for drawing the occluders
+        levelFBOs.resize(levels);
+        glGenFramebuffers(levels, &levelFBOs[0]);
+        glGenRenderbuffers(1, &depthBuffer);
+        glBindRenderbuffer(GL_RENDERBUFFER, depthBuffer);
+        glRenderbufferStorage(GL_RENDERBUFFER, GL_DEPTH_COMPONENT24, width, height);
+        for (unsigned int level = 0; level < levels; level++)
+        {
+            glBindFramebuffer(GL_FRAMEBUFFER, levelFBOs[level]);
+            glFramebufferTexture2D(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_TEXTURE_2D, pyramid, level);
+            if (level == 0)
+                glFramebufferRenderbuffer(GL_FRAMEBUFFER, GL_DEPTH_ATTACHMENT, GL_RENDERBUFFER, depthBuffer);
+            if (glCheckFramebufferStatus(GL_FRAMEBUFFER) != GL_FRAMEBUFFER_COMPLETE)
+                std::cout << "ERROR::FRAMEBUFFER:: Hi-Z level " << level << " is not complete!" << std::endl;
+        }
+        glBindFramebuffer(GL_FRAMEBUFFER, 0);
+
+        // the downsample pass draws a full screen triangle from gl_VertexID, the core profile still wants a VAO
+        glGenVertexArrays(1, &emptyVAO);
+
+        // spheres in, one float per sphere out
+        glGenVertexArrays(1, &sphereVAO);
+        glGenBuffers(1, &sphereVBO);
+        glGenBuffers(1, &resultBuffer);
+        state.BindVertexArray(sphereVAO);
+        glBindBuffer(GL_ARRAY_BUFFER, sphereVBO);
+        glEnableVertexAttribArray(0);
+        glVertexAttribPointer(0, 4, GL_FLOAT, GL_FALSE, sizeof(glm::vec4), (void*)0);
+
+        pyramidSize = testShader.getUniform("pyramidSize");
+        pyramidLevels = testShader.getUniform("pyramidLevels");
+        downsampleShader.use();
+        downsampleShader.setInt("source", 0);
+        testShader.use();
+        testShader.setInt("pyramid", 0);
+    }
+
+    ~OcclusionCuller()
+    {
+        GLStateCache::Instance().ForgetTexture(pyramid);
+        glDeleteTextures(1, &pyramid);
+        glDeleteFramebuffers(levels, &levelFBOs[0]);
+        glDeleteRenderbuffers(1, &depthBuffer);
+        glDeleteVertexArrays(1, &emptyVAO);
+        glDeleteVertexArrays(1, &sphereVAO);
+        glDeleteBuffers(1, &sphereVBO);
+        glDeleteBuffers(1, &resultBuffer);
+    }
+
+    OcclusionCuller(const OcclusionCuller&) = delete;
+    OcclusionCuller& operator=(const OcclusionCuller&) = delete;
+
+    // binds the base level for drawing the occluders with the frame's camera; also starts a new queue
+    void BeginOccluders()
+    {
+        glGetIntegerv(GL_FRAMEBUFFER_BINDING, &previousFramebuffer);
+        glGetIntegerv(GL_VIEWPORT, previousViewport);
+        glBindFramebuffer(GL_FRAMEBUFFER, levelFBOs[0]);
+        glViewport(0, 0, width, height);
+        const float farDepth[4] = {1.0f, 1.0f, 1.0f, 1.0f};
+        glClearBufferfv(GL_COLOR, 0, farDepth);
+        glClear(GL_DEPTH_BUFFER_BIT);
+        spheres.clear();
+    }
+
+    // builds the rest of the pyramid and switches back to the framebuffer and viewport from before
+    void EndOccluders()
+    {
+        GLStateCache &state = GLStateCache::Instance();
+        downsampleShader.use();
+        state.BindVertexArray(emptyVAO);
+        state.EditTexture(0, GL_TEXTURE_2D, pyramid);
+        for (unsigned int level = 1; level < levels; level++)
+        {
+            // only the level read from is visible to the sampler, so reading and writing never overlap
+            glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_BASE_LEVEL, level - 1);
+            glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAX_LEVEL, level - 1);
+            glBindFramebuffer(GL_FRAMEBUFFER, levelFBOs[level]);
+            glViewport(0, 0, levelSize(width, level), levelSize(height, level));
+            glDrawArrays(GL_TRIANGLES, 0, 3);
+        }
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_BASE_LEVEL, 0);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAX_LEVEL, levels - 1);
+
+        glBindFramebuffer(GL_FRAMEBUFFER, previousFramebuffer);
+        glViewport(previousViewport[0], previousViewport[1], previousViewport[2], previousViewport[3]);
+    }
+
+    // adds spheres to the next Run, returns the index of the first one for Visible
+    unsigned int Queue(const std::vector<BoundingSphere> &candidates)
+    {
+        unsigned int first = spheres.size();
+        for (const BoundingSphere &sphere : candidates)
+            spheres.push_back(glm::vec4(sphere.center, sphere.radius));
+        return first;
+    }
+
+    // tests every queued sphere against the pyramid
+    void Run()
+    {
+        results.assign(spheres.size(), 1.0f);
+        if (spheres.empty())
+            return;
+        GLStateCache &state = GLStateCache::Instance();
+        testShader.use();
+        testShader.setVec2(pyramidSize, glm::vec2(width, height));
+        testShader.setInt(pyramidLevels, levels);
+        state.BindTexture(0, GL_TEXTURE_2D, pyramid);
+        state.BindVertexArray(sphereVAO);
+
+        glBindBuffer(GL_ARRAY_BUFFER, sphereVBO);
+        glBindBuffer(GL_TRANSFORM_FEEDBACK_BUFFER, resultBuffer);
+        if (spheres.size() > capacity)
+        {
+            capacity = spheres.size();
+            glBufferData(GL_ARRAY_BUFFER, capacity * sizeof(glm::vec4), nullptr, GL_STREAM_DRAW);
+            glBufferData(GL_TRANSFORM_FEEDBACK_BUFFER, capacity * sizeof(float), nullptr, GL_STREAM_READ);
+        }
+        glBufferSubData(GL_ARRAY_BUFFER, 0, spheres.size() * sizeof(glm::vec4), &spheres[0]);
+
+        glEnable(GL_RASTERIZER_DISCARD);
+        glBindBufferBase(GL_TRANSFORM_FEEDBACK_BUFFER, 0, resultBuffer);
+        glBeginTransformFeedback(GL_POINTS);
+        glDrawArrays(GL_POINTS, 0, spheres.size());
+        glEndTransformFeedback();
+        glDisable(GL_RASTERIZER_DISCARD);
+        glGetBufferSubData(GL_TRANSFORM_FEEDBACK_BUFFER, 0, results.size() * sizeof(float), &results[0]);
+        glBindBufferBase(GL_TRANSFORM_FEEDBACK_BUFFER, 0, 0);
+    }
+
+    bool Visible(unsigned int index) const
+    {
+        return results[index] > 0.5f;
+    }
+
+private:
+    unsigned int width, height, levels;
+    Shader &downsampleShader;
+    Shader &testShader;
+    UniformHandle pyramidSize, pyramidLevels;
+
+    unsigned int pyramid = 0, depthBuffer = 0, emptyVAO = 0;
+    std::vector<unsigned int> levelFBOs;
+    GLint previousFramebuffer = 0, previousViewport[4] = {0, 0, 0, 0};
+
+    unsigned int sphereVAO = 0, sphereVBO = 0, resultBuffer = 0;
+    size_t capacity = 0;
+    std::vector<glm::vec4> spheres;
+    std::vector<float> results;
+
+    static unsigned int levelSize(unsigned int size, unsigned int level)
+    {
+        return std::max(1u, size >> level);
+    }
+};
+#endif
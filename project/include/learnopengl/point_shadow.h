@@ -0,0 +1,159 @@
+#ifndef POINT_SHADOW_H
+#define POINT_SHADOW_H
+
+#include <glad/glad.h>
+
+#include <glm/glm.hpp>
+#include <glm/gtc/matrix_transform.hpp>
+
+#include <learnopengl/frame_uniforms.h>
+#include <learnopengl/gl_state.h>
+#include <learnopengl/render_stats.h>
+#include <learnopengl/shadow_casters.h>
+
+#include <iostream>
+
+// texture units of the pointShadowMaps samplers in the lit shaders, one per light from here on
+const unsigned int POINT_SHADOW_UNIT = 9;
+
+// Shadows of the NR_POINT_LIGHTS point lights: one depth cube map per light, holding the distance to the light
+// divided by FAR. Each cube is rendered in a single pass, the geometry shader (point_shadow.gs) sends every
+// triangle to all six faces through gl_Layer, and point_shadow.fs writes the linear distance as depth.
+//
+//     PointShadowMaps pointShadows(casters);   // the static ShadowCasters, drawn with their cubeShader
+//     pointShadows.Update(lightPositions);     // every frame, before the lit draws
+//     pointShadows.BindTextures();
+//
+// The lights and the casters are static, so a cube is only rendered again when its light or the casters
+// moved: after the first frame the shadows cost one lookup per light and fragment.
+class PointShadowMaps
+{
+public:
+    // the distance covered by the cube maps, the lit shaders have to use the same value for pointShadowFar
+    static constexpr float FAR = 10.0f;
+
+    // size x size texels per cube face
+    explicit PointShadowMaps(const ShadowCasters &casters, unsigned int size = 512) : casters(casters), size(size)
+    {
+        GLStateCache &state = GLStateCache::Instance();
+        glGenTextures(NR_POINT_LIGHTS, cubes);
+        glGenFramebuffers(NR_POINT_LIGHTS, FBOs);
+        for (unsigned int i = 0; i < NR_POINT_LIGHTS; i++)
+        {
+            state.EditTexture(0, GL_TEXTURE_CUBE_MAP, cubes[i]);
+            for (unsigned int face = 0; face < 6; face++)
+                glTexImage2D(GL_TEXTURE_CUBE_MAP_POSITIVE_X + face, 0, GL_DEPTH_COMPONENT24, size, size, 0, GL_DEPTH_COMPONENT, GL_FLOAT, nullptr);
+            glTexParameteri(GL_TEXTURE_CUBE_MAP, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
+            glTexParameteri(GL_TEXTURE_CUBE_MAP, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+            glTexParameteri(GL_TEXTURE_CUBE_MAP, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+            glTexParameteri(GL_TEXTURE_CUBE_MAP, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+            glTexParameteri(GL_TEXTURE_CUBE_MAP, GL_TEXTURE_WRAP_R, GL_CLAMP_TO_EDGE);
+            glTexParameteri(GL_TEXTURE_CUBE_MAP, GL_TEXTURE_COMPARE_MODE, GL_COMPARE_REF_TO_TEXTURE);
+            glTexParameteri(GL_TEXTURE_CUBE_MAP, GL_TEXTURE_COMPARE_FUNC, GL_LEQUAL);
+
+            // the whole cube is attached, the geometry shader picks the face
+            glBindFramebuffer(GL_FRAMEBUFFER, FBOs[i]);
+            glFramebufferTexture(GL_FRAMEBUFFER, GL_DEPTH_ATTACHMENT, cubes[i], 0);
+            glDrawBuffer(GL_NONE);
+            glReadBuffer(GL_NONE);
+            if (glCheckFramebufferStatus(GL_FRAMEBUFFER) != GL_FRAMEBUFFER_COMPLETE)
+                std::cout << "ERROR::FRAMEBUFFER:: Point shadow cube " << i << " is not complete!" << std::endl;
+        }
+        glBindFramebuffer(GL_FRAMEBUFFER, 0);
+    }
+
+    ~PointShadowMaps()
+    {
+        for (unsigned int cube : cubes)
+            GLStateCache::Instance().ForgetTexture(cube);
+        glDeleteTextures(NR_POINT_LIGHTS, cubes);
+        glDeleteFramebuffers(NR_POINT_LIGHTS, FBOs);
+    }
+
+    PointShadowMaps(const PointShadowMaps&) = delete;
+    PointShadowMaps& operator=(const PointShadowMaps&) = delete;
+
+    // renders the cubes whose light or casters moved since they were last rendered. The bound framebuffer and
+    // viewport are restored afterwards
+    void Update(const glm::vec3 (&positions)[NR_POINT_LIGHTS])
+    {
+        rendered = 0;
+        GLint previousFramebuffer = 0, previousViewport[4] = {0, 0, 0, 0};
+        for (unsigned int i = 0; i < NR_POINT_LIGHTS; i++)
+        {
+            if (lights[i].version == casters.Version() && lights[i].position == positions[i])
+                continue;
+            if (rendered == 0)
+            {
+                glGetIntegerv(GL_FRAMEBUFFER_BINDING, &previousFramebuffer);
+                glGetIntegerv(GL_VIEWPORT, previousViewport);
+            }
+            render(i, positions[i]);
+            lights[i].version = casters.Version();
+            lights[i].position = positions[i];
+            rendered++;
+        }
+        if (rendered > 0)
+        {
+            glBindFramebuffer(GL_FRAMEBUFFER, previousFramebuffer);
+            glViewport(previousViewport[0], previousViewport[1], previousViewport[2], previousViewport[3]);
+        }
+    }
+
+    // binds cube i to POINT_SHADOW_UNIT + i
+    void BindTextures() const
+    {
+        for (unsigned int i = 0; i < NR_POINT_LIGHTS; i++)
+            GLStateCache::Instance().BindTexture(POINT_SHADOW_UNIT + i, GL_TEXTURE_CUBE_MAP, cubes[i]);
+    }
+
+    // how many cubes the last Update rendered, 0 while nothing moves
+    unsigned int Rendered() const
+    {
+        return rendered;
+    }
+
+private:
+    struct Light {
+        unsigned int version = ~0u; // casters version the cube was rendered with
+        glm::vec3 position = glm::vec3(0.0f);
+    };
+
+    const ShadowCasters &casters;
+    unsigned int size;
+    unsigned int cubes[NR_POINT_LIGHTS];
+    unsigned int FBOs[NR_POINT_LIGHTS];
+    Light lights[NR_POINT_LIGHTS];
+    unsigned int rendered = 0;
+
+    void render(unsigned int light, const glm::vec3 &position)
+    {
+        // the usual cube map face orientations, +x -x +y -y +z -z
+        static const glm::vec3 directions[6] = {{1, 0, 0}, {-1, 0, 0}, {0, 1, 0}, {0, -1, 0}, {0, 0, 1}, {0, 0, -1}};
+        static const glm::vec3 ups[6] = {{0, -1, 0}, {0, -1, 0}, {0, 0, 1}, {0, 0, -1}, {0, -1, 0}, {0, -1, 0}};
+        glm::mat4 projection = glm::perspective(glm::radians(90.0f), 1.0f, 0.01f, FAR);
+        glm::mat4 faces[6];
+        for (unsigned int face = 0; face < 6; face++)
+            faces[face] = projection * glm::lookAt(position, position + directions[face], ups[face]);
+
+        GLStateCache &state = GLStateCache::Instance();
+        state.DepthMask(true);
+        state.DepthFunc(GL_LESS);
+        glBindFramebuffer(GL_FRAMEBUFFER, FBOs[light]);
+        glViewport(0, 0, size, size);
+        glClear(GL_DEPTH_BUFFER_BIT);
+        for (const ShadowCasters::Caster &caster : casters.All())
+        {
+            if (!caster.cubeShader)
+                continue;
+            Shader &shader = *caster.cubeShader;
+            shader.use();
+            for (unsigned int face = 0; face < 6; face++)
+                shader.setMat4(caster.faceViewProjection[face], faces[face]);
+            shader.setVec3(caster.lightPosition, position);
+            shader.setFloat(caster.farPlane, FAR);
+            caster.model->DrawInstanced(shader, caster.instanceVBO, caster.instanceCount);
+        }
+    }
+};
+#endif
@@ -0,0 +1,252 @@
+#ifndef RENDER_QUEUE_H
+#define RENDER_QUEUE_H
+
+#include <glm/glm.hpp>
+
+#include <learnopengl/gl_state.h>
+#include <learnopengl/mesh.h>
+#include <learnopengl/shader.h>
+
+#include <algorithm>
+#include <cstdint>
+#include <functional>
+#include <vector>
+
+// Collects the draws of a frame and executes them sorted by a 64 bit key, most significant bits first:
+//
+//     pass (4) | shader (12) | material (24) | depth (24)
+//
+// Passes run in order, within a pass draws are grouped by shader and then by material (the first texture of a
+// mesh) to keep state changes down, and draws sharing both run front to back so early-Z rejects hidden pixels.
+// Shaders are numbered in the order they are first submitted, so a frame controls which one comes first.
+// Consecutive mesh draws that share shader, model matrix, textures and arena block are merged into one call.
+//
+// Draws that are expensive to shade and would defeat early-Z (alpha tested foliage) can be split in two: a
+// depth-only draw in DEPTH_PREPASS, before everything else, and the shading draw in DEPTH_EQUAL_PASS, after the
+// opaque pass, which only shades the fragments whose depth matches what the prepass left. Both draws must
+// produce bit identical positions, their vertex shaders declare gl_Position invariant. Execute sets the depth
+// and color masks and the depth function of each pass and leaves the defaults behind.
+//
+// With deferred shading the passes before LIGHTING_PASS fill the G-buffer, and the one draw of LIGHTING_PASS
+// lights it into the frame with depth writes forced on (GL_ALWAYS), so the sky is tested against the scene.
+//
+//     queue.Begin(camera.Position, farPlane);
+//     model.Submit(queue, shader, transform);
+//     queue.Execute();
+class RenderQueue
+{
+public:
+    enum Pass { DEPTH_PREPASS, OPAQUE_PASS, DEPTH_EQUAL_PASS, LIGHTING_PASS, SKY_PASS };
+
+    static const uint64_t SHADER_BITS = 12, MATERIAL_BITS = 24, DEPTH_BITS = 24;
+
+    static uint64_t MakeKey(Pass pass, unsigned int shader, unsigned int material, unsigned int depth)
+    {
+        return (uint64_t)pass << (SHADER_BITS + MATERIAL_BITS + DEPTH_BITS) |
+               (uint64_t)(shader & mask(SHADER_BITS)) << (MATERIAL_BITS + DEPTH_BITS) |
+               (uint64_t)(material & mask(MATERIAL_BITS)) << DEPTH_BITS |
+               (uint64_t)(depth & mask(DEPTH_BITS));
+    }
+
+    // starts a frame; distances are measured from viewPosition and quantized over [0, farPlane]
+    void Begin(const glm::vec3 &viewPosition, float farPlane)
+    {
+        this->viewPosition = viewPosition;
+        this->farPlane = farPlane;
+        items.clear();
+        shaders.clear();
+    }
+
+    float Distance(const glm::vec3 &point) const
+    {
+        return glm::length(point - viewPosition);
+    }
+
+    // one draw of mesh with the model matrix; center is the world space point used for the depth order
+    void Submit(Pass pass, Shader &shader, Mesh &mesh, const glm::mat4 &model, const glm::vec3 &center)
+    {
+        RenderItem &item = add(pass, shader, materialOf(mesh), Distance(center));
+        item.mesh = &mesh;
+        item.model = model;
+    }
+
+    // an instanced draw of level lod of mesh, reading InstanceData from instanceVBO; distance is of the nearest
+    // instance
+    void SubmitInstanced(Pass pass, Shader &shader, Mesh &mesh, unsigned int instanceVBO, unsigned int instanceCount,
+                         float distance, unsigned int lod = 0)
+    {
+        RenderItem &item = add(pass, shader, materialOf(mesh), distance);
+        item.mesh = &mesh;
+        item.instanceVBO = instanceVBO;
+        item.instanceCount = instanceCount;
+        item.lod = lod;
+    }
+
+    // any other draw; the shader is bound before draw is called
+    void Submit(Pass pass, Shader &shader, unsigned int material, float distance, std::function<void()> draw)
+    {
+        RenderItem &item = add(pass, shader, material, distance);
+        item.draw = std::move(draw);
+    }
+
+    // sorts the submitted draws and runs them
+    void Execute()
+    {
+        order.resize(items.size());
+        for (unsigned int i = 0; i < items.size(); i++)
+            order[i] = SortEntry{items[i].key, i};
+        RadixSort(order, scratch);
+
+        unsigned int pass = ~0u;
+        for (unsigned int i = 0; i < order.size();)
+        {
+            RenderItem &item = items[order[i].index];
+            if (passOf(item.key) != pass)
+            {
+                pass = passOf(item.key);
+                setPassState((Pass)pass);
+            }
+            ShaderSlot &slot = shaders[item.shader];
+            slot.shader->use();
+            if (item.draw)
+                item.draw();
+            else if (item.instanceCount > 0)
+                item.mesh->DrawInstanced(*slot.shader, item.instanceVBO, item.instanceCount, item.lod);
+            else
+            {
+                // the plain draws that follow with the same shader, model matrix and textures go out in one call
+                merged.assign(1, item.mesh);
+                while (i + merged.size() < order.size() && mergeable(item, items[order[i + merged.size()].index]))
+                    merged.push_back(items[order[i + merged.size()].index].mesh);
+                slot.shader->setMat4(slot.model, item.model);
+                if (merged.size() == 1)
+                    item.mesh->Draw(*slot.shader);
+                else
+                    Mesh::DrawMerged(*slot.shader, merged, ranges);
+                i += merged.size();
+                continue;
+            }
+            i++;
+        }
+        setPassState(OPAQUE_PASS);
+    }
+
+    unsigned int Size() const
+    {
+        return items.size();
+    }
+
+    struct SortEntry {
+        uint64_t key;
+        unsigned int index;
+    };
+
+    // stable least significant digit radix sort on the keys, one byte per pass. Bytes that are the same in
+    // every key (the unused pass bits, mostly) are skipped.
+    static void RadixSort(std::vector<SortEntry> &entries, std::vector<SortEntry> &scratch)
+    {
+        scratch.resize(entries.size());
+        for (unsigned int shift = 0; shift < 64; shift += 8)
+        {
+            unsigned int counts[256] = {};
+            for (const SortEntry &entry : entries)
+                counts[(entry.key >> shift) & 0xff]++;
+            if (entries.empty() || counts[(entries[0].key >> shift) & 0xff] == entries.size())
+                continue;
+
+            unsigned int offset = 0;
+            for (unsigned int &count : counts)
+            {
+                unsigned int digitCount = count;
+                count = offset;
+                offset += digitCount;
+            }
+            for (const SortEntry &entry : entries)
+                scratch[counts[(entry.key >> shift) & 0xff]++] = entry;
+            entries.swap(scratch);
+        }
+    }
+
+private:
+    struct RenderItem {
+        uint64_t key = 0;
+        unsigned int shader = 0;        // index into shaders
+        Mesh *mesh = nullptr;
+        unsigned int instanceVBO = 0;
+        unsigned int instanceCount = 0; // 0 draws the mesh once with model
+        unsigned int lod = 0;
+        glm::mat4 model = glm::mat4(1.0f);
+        std::function<void()> draw;     // used instead of the mesh when set
+    };
+
+    struct ShaderSlot {
+        Shader *shader;
+        UniformHandle model;
+    };
+
+    glm::vec3 viewPosition = glm::vec3(0.0f);
+    float farPlane = 100.0f;
+    std::vector<RenderItem> items;
+    std::vector<ShaderSlot> shaders;
+    std::vector<ShaderSlot> modelUniforms;  // every shader ever submitted, so "model" is looked up once per shader
+    std::vector<SortEntry> order, scratch;
+    std::vector<Mesh*> merged;
+    std::vector<GeometryRange> ranges;
+
+    static uint64_t mask(uint64_t bits)
+    {
+        return (uint64_t(1) << bits) - 1;
+    }
+
+    static unsigned int materialOf(const Mesh &mesh)
+    {
+        return mesh.textures.empty() ? 0 : mesh.textures[0].id;
+    }
+
+    static unsigned int passOf(uint64_t key)
+    {
+        return (unsigned int)(key >> (SHADER_BITS + MATERIAL_BITS + DEPTH_BITS));
+    }
+
+    static void setPassState(Pass pass)
+    {
+        GLStateCache &state = GLStateCache::Instance();
+        state.ColorMask(pass != DEPTH_PREPASS);
+        state.DepthMask(pass != DEPTH_EQUAL_PASS);
+        state.DepthFunc(pass == DEPTH_EQUAL_PASS ? GL_EQUAL : (pass == LIGHTING_PASS ? GL_ALWAYS : GL_LESS));
+    }
+
+    UniformHandle modelUniform(Shader &shader)
+    {
+        for (const ShaderSlot &known : modelUniforms)
+        {
+            if (known.shader == &shader)
+                return known.model;
+        }
+        modelUniforms.push_back(ShaderSlot{&shader, shader.getUniform("model")});
+        return modelUniforms.back().model;
+    }
+
+    static bool mergeable(const RenderItem &first, const RenderItem &next)
+    {
+        return !next.draw && next.instanceCount == 0 && next.shader == first.shader && next.model == first.model &&
+               next.mesh->SharesStateWith(*first.mesh);
+    }
+
+    RenderItem &add(Pass pass, Shader &shader, unsigned int material, float distance)
+    {
+        unsigned int shaderIndex = 0;
+        while (shaderIndex < shaders.size() && shaders[shaderIndex].shader != &shader)
+            shaderIndex++;
+        if (shaderIndex == shaders.size())
+            shaders.push_back(ShaderSlot{&shader, modelUniform(shader)});
+
+        float depth = glm::clamp(distance / farPlane, 0.0f, 1.0f);
+        items.emplace_back();
+        RenderItem &item = items.back();
+        item.shader = shaderIndex;
+        item.key = MakeKey(pass, shaderIndex, material, (unsigned int)(depth * mask(DEPTH_BITS)));
+        return item;
+    }
+};
+#endif
@@ -0,0 +1,28 @@
+#ifndef RENDER_STATS_H
+#define RENDER_STATS_H
+
+// Draw calls and triangles submitted since the last Reset. The draw functions of Mesh and GroundQuad count
+// themselves, other draws are counted by their caller; main resets the counters at the start of every frame.
+struct RenderStats {
+    unsigned int drawCalls = 0;
+    unsigned long long triangles = 0;
+
+    void Reset()
+    {
+        drawCalls = 0;
+        triangles = 0;
+    }
+
+    void CountDraw(unsigned long long drawnTriangles)
+    {
+        drawCalls++;
+        triangles += drawnTriangles;
+    }
+
+    static RenderStats &Frame()
+    {
+        static RenderStats stats;
+        return stats;
+    }
+};
+#endif
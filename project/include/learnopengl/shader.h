@@ -8,17 +8,34 @@
 #include <fstream>
 #include <sstream>
 #include <iostream>
+#include <set>
+#include <unordered_map>
+#include <vector>
 #include <common.h>
+#include <learnopengl/gl_state.h>
+
+// pre-resolved location of a uniform, obtained once with Shader::getUniform and then used on hot paths
+// where looking the name up every frame would cost a string allocation and a hash
+struct UniformHandle
+{
+    GLint location = -1;
+};
+
 class Shader
 {
 public:
     unsigned int ID;
-    // constructor generates the shader on the fly
+    // constructor generates the shader on the fly; #include "file" lines are replaced with the file, found next
+    // to the including source, and every name in defines is #defined right after the #version line of each
+    // stage, so one source file can be compiled into several variants. The vertex shader outputs
+    // named in feedbackVaryings are captured with transform feedback, interleaved into one buffer
     // ------------------------------------------------------------------------
-    Shader(const char* vertexPath, const char* fragmentPath, const char* geometryPath = nullptr)
+    Shader(const char* vertexPath, const char* fragmentPath, const char* geometryPath = nullptr,
+           const std::vector<std::string> &defines = {}, const std::vector<std::string> &feedbackVaryings = {})
     {
         std::string vertexPathString(vertexPath);
         std::string fragmentPathString(fragmentPath);
+        std::string geometryPathString(geometryPath != nullptr ? geometryPath : "");
 
         vertexPath = vertexPathString.c_str();
         fragmentPath= fragmentPathString.c_str();
@@ -51,7 +68,6 @@ public:
             // if geometry shader path is present, also load a geometry shader
             if(geometryPath != nullptr)
             {
-                std::string geometryPathString(geometryPath);
                 geometryPath = geometryPathString.c_str();
                 gShaderFile.open(geometryPath);
                 std::stringstream gShaderStream;
@@ -64,6 +80,13 @@ public:
         {
             std::cout << "ERROR::SHADER::FILE_NOT_SUCCESFULLY_READ" << std::endl;
         }
+        resolveIncludes(vertexCode, vertexPathString);
+        resolveIncludes(fragmentCode, fragmentPathString);
+        if(geometryPath != nullptr)
+            resolveIncludes(geometryCode, geometryPathString);
+        injectDefines(vertexCode, defines);
+        injectDefines(fragmentCode, defines);
+        injectDefines(geometryCode, defines);
         const char* vShaderCode = vertexCode.c_str();
         const char * fShaderCode = fragmentCode.c_str();
         // 2. compile shaders
@@ -94,8 +117,17 @@ public:
         glAttachShader(ID, fragment);
         if(geometryPath != nullptr)
             glAttachShader(ID, geometry);
+        // the varyings only take effect on link
+        if(!feedbackVaryings.empty())
+        {
+            std::vector<const char*> names;
+            for(const std::string &varying : feedbackVaryings)
+                names.push_back(varying.c_str());
+            glTransformFeedbackVaryings(ID, names.size(), names.data(), GL_INTERLEAVED_ATTRIBS);
+        }
         glLinkProgram(ID);
         checkCompileErrors(ID, "PROGRAM");
+        cacheUniformLocations();
         // delete the shaders as they're linked into our program now and no longer necessery
         glDeleteShader(vertex);
         glDeleteShader(fragment);
@@ -103,72 +135,226 @@ public:
             glDeleteShader(geometry);
 
     }
-    // activate the shader
+    // activate the shader, skipped when it is already the bound program
     // ------------------------------------------------------------------------
     void use() 
     { 
-        glUseProgram(ID); 
+        GLStateCache::Instance().UseProgram(ID);
+    }
+    // attach a uniform block to a binding point, blocks the program doesn't declare are ignored
+    // ------------------------------------------------------------------------
+    void bindUniformBlock(const std::string &name, unsigned int binding) const
+    {
+        unsigned int index = glGetUniformBlockIndex(ID, name.c_str());
+        if(index != GL_INVALID_INDEX)
+            glUniformBlockBinding(ID, index, binding);
+    }
+    // resolve a uniform once, the handle stays valid for the lifetime of the program
+    // ------------------------------------------------------------------------
+    UniformHandle getUniform(const std::string &name) const
+    {
+        UniformHandle handle;
+        handle.location = uniformLocation(name);
+        return handle;
     }
     // utility uniform functions
     // ------------------------------------------------------------------------
     void setBool(const std::string &name, bool value) const
     {         
-        glUniform1i(glGetUniformLocation(ID, name.c_str()), (int)value); 
+        glUniform1i(uniformLocation(name), (int)value); 
     }
     // ------------------------------------------------------------------------
     void setInt(const std::string &name, int value) const
     { 
-        glUniform1i(glGetUniformLocation(ID, name.c_str()), value); 
+        glUniform1i(uniformLocation(name), value); 
     }
     // ------------------------------------------------------------------------
     void setFloat(const std::string &name, float value) const
     { 
-        glUniform1f(glGetUniformLocation(ID, name.c_str()), value); 
+        glUniform1f(uniformLocation(name), value); 
     }
     // ------------------------------------------------------------------------
     void setVec2(const std::string &name, const glm::vec2 &value) const
     { 
-        glUniform2fv(glGetUniformLocation(ID, name.c_str()), 1, &value[0]); 
+        glUniform2fv(uniformLocation(name), 1, &value[0]); 
     }
     void setVec2(const std::string &name, float x, float y) const
     { 
-        glUniform2f(glGetUniformLocation(ID, name.c_str()), x, y); 
+        glUniform2f(uniformLocation(name), x, y); 
     }
     // ------------------------------------------------------------------------
     void setVec3(const std::string &name, const glm::vec3 &value) const
     { 
-        glUniform3fv(glGetUniformLocation(ID, name.c_str()), 1, &value[0]); 
+        glUniform3fv(uniformLocation(name), 1, &value[0]); 
     }
     void setVec3(const std::string &name, float x, float y, float z) const
     { 
-        glUniform3f(glGetUniformLocation(ID, name.c_str()), x, y, z); 
+        glUniform3f(uniformLocation(name), x, y, z); 
     }
     // ------------------------------------------------------------------------
     void setVec4(const std::string &name, const glm::vec4 &value) const
     { 
-        glUniform4fv(glGetUniformLocation(ID, name.c_str()), 1, &value[0]); 
+        glUniform4fv(uniformLocation(name), 1, &value[0]); 
     }
     void setVec4(const std::string &name, float x, float y, float z, float w) 
     { 
-        glUniform4f(glGetUniformLocation(ID, name.c_str()), x, y, z, w); 
+        glUniform4f(uniformLocation(name), x, y, z, w); 
     }
     // ------------------------------------------------------------------------
     void setMat2(const std::string &name, const glm::mat2 &mat) const
     {
-        glUniformMatrix2fv(glGetUniformLocation(ID, name.c_str()), 1, GL_FALSE, &mat[0][0]);
+        glUniformMatrix2fv(uniformLocation(name), 1, GL_FALSE, &mat[0][0]);
     }
     // ------------------------------------------------------------------------
     void setMat3(const std::string &name, const glm::mat3 &mat) const
     {
-        glUniformMatrix3fv(glGetUniformLocation(ID, name.c_str()), 1, GL_FALSE, &mat[0][0]);
+        glUniformMatrix3fv(uniformLocation(name), 1, GL_FALSE, &mat[0][0]);
     }
     // ------------------------------------------------------------------------
     void setMat4(const std::string &name, const glm::mat4 &mat) const
     {
-        glUniformMatrix4fv(glGetUniformLocation(ID, name.c_str()), 1, GL_FALSE, &mat[0][0]);
+        glUniformMatrix4fv(uniformLocation(name), 1, GL_FALSE, &mat[0][0]);
+    }
+    // uniform functions taking a pre-resolved handle
+    // ------------------------------------------------------------------------
+    void setBool(UniformHandle handle, bool value) const
+    {
+        glUniform1i(handle.location, (int)value);
+    }
+    void setInt(UniformHandle handle, int value) const
+    {
+        glUniform1i(handle.location, value);
+    }
+    void setFloat(UniformHandle handle, float value) const
+    {
+        glUniform1f(handle.location, value);
+    }
+    void setVec2(UniformHandle handle, const glm::vec2 &value) const
+    {
+        glUniform2fv(handle.location, 1, &value[0]);
+    }
+    void setVec3(UniformHandle handle, const glm::vec3 &value) const
+    {
+        glUniform3fv(handle.location, 1, &value[0]);
+    }
+    void setVec4(UniformHandle handle, const glm::vec4 &value) const
+    {
+        glUniform4fv(handle.location, 1, &value[0]);
+    }
+    void setMat3(UniformHandle handle, const glm::mat3 &mat) const
+    {
+        glUniformMatrix3fv(handle.location, 1, GL_FALSE, &mat[0][0]);
+    }
+    void setMat4(UniformHandle handle, const glm::mat4 &mat) const
+    {
+        glUniformMatrix4fv(handle.location, 1, GL_FALSE, &mat[0][0]);
     }
 
 private:
+    // locations of all active uniforms of the program, keyed by name
+    std::unordered_map<std::string, GLint> uniformLocations;
+
+    // returns -1 (ignored by glUniform*) for names the program doesn't use, same as glGetUniformLocation
+    GLint uniformLocation(const std::string &name) const
+    {
+        auto it = uniformLocations.find(name);
+        return it != uniformLocations.end() ? it->second : -1;
+    }
+
+    // pastes the file of every #include "name" line in place of the line, name relative to the directory of
+    // path. Each file is pasted once per stage and later includes of it are dropped, so shared files can include
+    // the declarations they build on
+    // ------------------------------------------------------------------------
+    static void resolveIncludes(std::string &code, const std::string &path)
+    {
+        std::set<std::string> included;
+        code = expandIncludes(code, path, included);
+    }
+
+    static std::string expandIncludes(const std::string &code, const std::string &path, std::set<std::string> &included)
+    {
+        std::string directory = path.substr(0, path.find_last_of('/') + 1);
+        std::istringstream lines(code);
+        std::string result, line;
+        while(std::getline(lines, line))
+        {
+            size_t start = line.find_first_not_of(" \t");
+            size_t open = line.find('"');
+            size_t close = open == std::string::npos ? std::string::npos : line.find('"', open + 1);
+            if(start == std::string::npos || line.compare(start, 8, "#include") != 0 || close == std::string::npos)
+            {
+                result += line + "\n";
+                continue;
+            }
+            std::string file = directory + line.substr(open + 1, close - open - 1);
+            if(!included.insert(file).second)
+                continue;
+            std::ifstream stream(file);
+            if(!stream)
+            {
+                std::cout << "ERROR::SHADER::INCLUDE_NOT_FOUND " << file << std::endl;
+                continue;
+            }
+            std::stringstream text;
+            text << stream.rdbuf();
+            result += expandIncludes(text.str(), file, included);
+        }
+        return result;
+    }
+
+    // inserts the defines after the #version line, which has to stay the first statement of the source
+    // ------------------------------------------------------------------------
+    static void injectDefines(std::string &code, const std::vector<std::string> &defines)
+    {
+        if(code.empty() || defines.empty())
+            return;
+        std::string block;
+        for(const std::string &define : defines)
+            block += "#define " + define + "\n";
+        size_t version = code.find("#version");
+        size_t lineEnd = version == std::string::npos ? std::string::npos : code.find('\n', version);
+        if(version == std::string::npos)
+            code.insert(0, block);
+        else if(lineEnd == std::string::npos)
+            code += "\n" + block;
+        else
+            code.insert(lineEnd + 1, block);
+    }
+
+    // introspects every active uniform once after linking, so setting a uniform never queries the driver
+    // ------------------------------------------------------------------------
+    void cacheUniformLocations()
+    {
+        GLint count = 0, maxLength = 0;
+        glGetProgramiv(ID, GL_ACTIVE_UNIFORMS, &count);
+        glGetProgramiv(ID, GL_ACTIVE_UNIFORM_MAX_LENGTH, &maxLength);
+        std::string name(maxLength, '\0');
+        for(GLint i = 0; i < count; i++)
+        {
+            GLsizei length = 0;
+            GLint size = 0;
+            GLenum type;
+            glGetActiveUniform(ID, i, maxLength, &length, &size, &type, &name[0]);
+            std::string uniformName = name.substr(0, length);
+            GLint location = glGetUniformLocation(ID, uniformName.c_str());
+            if(location == -1)
+                continue; // member of a uniform block
+            uniformLocations[uniformName] = location;
+            // arrays of basic types are reported once as "name[0]", register the bare name and every element
+            size_t bracket = uniformName.rfind("[0]");
+            if(bracket != std::string::npos && bracket + 3 == uniformName.size())
+            {
+                std::string base = uniformName.substr(0, bracket);
+                uniformLocations[base] = location;
+                for(GLint element = 1; element < size; element++)
+                {
+                    std::string elementName = base + "[" + std::to_string(element) + "]";
+                    uniformLocations[elementName] = glGetUniformLocation(ID, elementName.c_str());
+                }
+            }
+        }
+    }
+
     // utility function for checking shader compilation/linking errors.
     // ------------------------------------------------------------------------
     void checkCompileErrors(GLuint shader, std::string type)
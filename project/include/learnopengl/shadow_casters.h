@@ -0,0 +1,100 @@
+#ifndef SHADOW_CASTERS_H
+#define SHADOW_CASTERS_H
+
+#include <glad/glad.h>
+
+#include <learnopengl/bounds.h>
+#include <learnopengl/instance_data.h>
+#include <learnopengl/model.h>
+#include <learnopengl/shader.h>
+
+#include <string>
+#include <vector>
+
+// The static objects that cast shadows, shared by every shadow map: each model's instances are uploaded once
+// and drawn instanced from then on. The shadow maps cache what they rendered and compare Version to find out
+// when the casters changed.
+class ShadowCasters
+{
+public:
+    struct Caster {
+        Model *model;
+        unsigned int instanceVBO;
+        unsigned int instanceCount;
+        Shader *cascadeShader; // for CascadedShadowMap
+        Shader *cubeShader;    // for PointShadowMaps, nullptr when the model casts no point light shadows
+        // the per-render uniforms of both shaders, resolved once in Add
+        UniformHandle shadowViewProjection;
+        UniformHandle faceViewProjection[6];
+        UniformHandle lightPosition;
+        UniformHandle farPlane;
+    };
+
+    ShadowCasters() = default;
+
+    ~ShadowCasters()
+    {
+        for (Caster &caster : casters)
+            glDeleteBuffers(1, &caster.instanceVBO);
+    }
+
+    ShadowCasters(const ShadowCasters&) = delete;
+    ShadowCasters& operator=(const ShadowCasters&) = delete;
+
+    // instances of model; the shaders are decoration_instanced.vs compiled for the model's VertexLayout, with
+    // SHADOW_PASS and decoration_depth.fs for the cascades and with WORLD_POSITION, point_shadow.gs and
+    // point_shadow.fs for the point lights
+    void Add(Model &model, const std::vector<InstanceData> &instances, Shader &cascadeShader, Shader *cubeShader)
+    {
+        if (instances.empty())
+            return;
+        Caster caster;
+        caster.model = &model;
+        caster.instanceCount = instances.size();
+        caster.cascadeShader = &cascadeShader;
+        caster.cubeShader = cubeShader;
+        caster.shadowViewProjection = cascadeShader.getUniform("shadowViewProjection");
+        if (cubeShader)
+        {
+            for (unsigned int face = 0; face < 6; face++)
+                caster.faceViewProjection[face] = cubeShader->getUniform("faceViewProjection[" + std::to_string(face) + "]");
+            caster.lightPosition = cubeShader->getUniform("lightPosition");
+            caster.farPlane = cubeShader->getUniform("farPlane");
+        }
+        glGenBuffers(1, &caster.instanceVBO);
+        glBindBuffer(GL_ARRAY_BUFFER, caster.instanceVBO);
+        glBufferData(GL_ARRAY_BUFFER, instances.size() * sizeof(InstanceData), &instances[0], GL_STATIC_DRAW);
+        casters.push_back(caster);
+        for (const InstanceData &instance : instances)
+            bounds.Expand(model.bounds.Transformed(instance.model));
+        Moved();
+    }
+
+    // call when a caster moved, the shadow maps render again
+    void Moved()
+    {
+        version++;
+    }
+
+    unsigned int Version() const
+    {
+        return version;
+    }
+
+    const std::vector<Caster> &All() const
+    {
+        return casters;
+    }
+
+    // world space box around every caster
+    const BoundingBox &Bounds() const
+    {
+        return bounds;
+    }
+
+private:
+    std::vector<Caster> casters;
+    BoundingBox bounds;
+    unsigned int version = 0;
+};
+#endif
@@ -0,0 +1,270 @@
+#ifndef SHADOW_MAP_H
+#define SHADOW_MAP_H
+
+#include <glad/glad.h>
+
+#include <glm/glm.hpp>
+#include <glm/gtc/matrix_transform.hpp>
+
+#include <learnopengl/bounds.h>
+#include <learnopengl/camera.h>
+#include <learnopengl/gl_state.h>
+#include <learnopengl/render_stats.h>
+#include <learnopengl/shader.h>
+#include <learnopengl/shadow_casters.h>
+
+#include <algorithm>
+#include <cmath>
+#include <iostream>
+#include <vector>
+
+#define NR_CASCADES 4
+
+// binding point of the ShadowUniforms block and the texture unit of the shadowMap sampler in the lit shaders
+const unsigned int SHADOW_UNIFORMS_BINDING = 1;
+const unsigned int SHADOW_MAP_UNIT = 8;
+
+// mirrors the std140 ShadowUniforms block in resources/shaders/shadows.glsl
+struct ShadowUniforms {
+    glm::mat4 lightViewProjection[NR_CASCADES];
+    glm::vec4 cascadeSplits; // view space distance where each cascade ends
+    glm::vec4 cascadeBias;   // depth bias of each cascade in [0, 1] depth, about a texel of slope
+};
+
+static_assert(sizeof(ShadowUniforms) == NR_CASCADES * 64 + 32, "ShadowUniforms does not match the std140 layout");
+
+// Cascaded shadow map of the directional light: the view frustum up to shadowDistance is split into
+// NR_CASCADES slices, each rendered into a layer of one depth texture array with an orthographic camera looking
+// along the light.
+//
+//     CascadedShadowMap shadows(casters);                  // the static ShadowCasters
+//     shadows.Update(camera, aspect, nearPlane, light);    // every frame, before the lit draws
+//     shadows.BindTexture();
+//
+// Each cascade's projection is fitted to the bounding sphere of its slice. The sphere only depends on the
+// field of view and the split distances, so its size stays the same when the camera turns. The center is
+// snapped to whole texels in light space, so moving the camera moves the shadow map in whole texel steps, and
+// shadow edges don't shimmer. The depth range covers the slice and every caster between it and the light.
+//
+// A cascade is only rendered again when its matrix changed (the camera moved by a texel or more, the light
+// turned) or the casters moved; a still camera costs nothing. The casters are drawn with instanced depth-only
+// draws from their static instance buffers, at a level of detail that gets coarser with every cascade.
+class CascadedShadowMap
+{
+public:
+    // what the last render of a cascade cost; gpuMs arrives a frame or two late
+    struct CascadeStats {
+        bool rendered = false;   // this frame, false when the cached map was reused
+        unsigned int drawCalls = 0;
+        unsigned long long triangles = 0;
+        double gpuMs = 0.0;
+    };
+
+    float shadowDistance = 20.0f;
+    // blend of logarithmic (1) and uniform (0) split distances
+    float splitLambda = 0.8f;
+
+    // size x size texels per cascade
+    explicit CascadedShadowMap(const ShadowCasters &casters, unsigned int size = 2048) : casters(casters), size(size)
+    {
+        GLStateCache &state = GLStateCache::Instance();
+        glGenTextures(1, &depthArray);
+        state.EditTexture(0, GL_TEXTURE_2D_ARRAY, depthArray);
+        glTexImage3D(GL_TEXTURE_2D_ARRAY, 0, GL_DEPTH_COMPONENT24, size, size, NR_CASCADES, 0, GL_DEPTH_COMPONENT, GL_FLOAT, nullptr);
+        // linear filtering with comparison gives a bilinear weighted 2x2 test per lookup
+        glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
+        glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+        glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+        glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+        glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_COMPARE_MODE, GL_COMPARE_REF_TO_TEXTURE);
+        glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_COMPARE_FUNC, GL_LEQUAL);
+
+        glGenFramebuffers(NR_CASCADES, FBOs);
+        for (unsigned int i = 0; i < NR_CASCADES; i++)
+        {
+            glBindFramebuffer(GL_FRAMEBUFFER, FBOs[i]);
+            glFramebufferTextureLayer(GL_FRAMEBUFFER, GL_DEPTH_ATTACHMENT, depthArray, 0, i);
+            glDrawBuffer(GL_NONE);
+            glReadBuffer(GL_NONE);
+            if (glCheckFramebufferStatus(GL_FRAMEBUFFER) != GL_FRAMEBUFFER_COMPLETE)
+                std::cout << "ERROR::FRAMEBUFFER:: Shadow cascade " << i << " is not complete!" << std::endl;
+        }
+        glBindFramebuffer(GL_FRAMEBUFFER, 0);
+
+        glGenQueries(2 * NR_CASCADES, queries);
+        glGenBuffers(1, &UBO);
+        glBindBuffer(GL_UNIFORM_BUFFER, UBO);
+        glBufferData(GL_UNIFORM_BUFFER, sizeof(ShadowUniforms), NULL, GL_DYNAMIC_DRAW);
+        glBindBuffer(GL_UNIFORM_BUFFER, 0);
+        glBindBufferBase(GL_UNIFORM_BUFFER, SHADOW_UNIFORMS_BINDING, UBO);
+    }
+
+    ~CascadedShadowMap()
+    {
+        GLStateCache::Instance().ForgetTexture(depthArray);
+        glDeleteTextures(1, &depthArray);
+        glDeleteFramebuffers(NR_CASCADES, FBOs);
+        glDeleteQueries(2 * NR_CASCADES, queries);
+        glDeleteBuffers(1, &UBO);
+    }
+
+    CascadedShadowMap(const CascadedShadowMap&) = delete;
+    CascadedShadowMap& operator=(const CascadedShadowMap&) = delete;
+
+    // fits the cascades to the camera and renders the ones that changed. The bound framebuffer and viewport
+    // are restored afterwards
+    void Update(const Camera &camera, float aspect, float nearPlane, const glm::vec3 &lightDirection)
+    {
+        collectTimings();
+
+        glm::vec3 direction = glm::normalize(lightDirection);
+        glm::vec3 up = std::abs(direction.y) > 0.99f ? glm::vec3(1.0f, 0.0f, 0.0f) : glm::vec3(0.0f, 1.0f, 0.0f);
+        glm::mat4 lightView = glm::lookAt(glm::vec3(0.0f), direction, up);
+
+        // the highest light space z of any caster, the near plane of every cascade reaches at least that far
+        const BoundingBox &casterBounds = casters.Bounds();
+        float casterTop = -FLT_MAX;
+        for (int corner = 0; corner < 8; corner++)
+        {
+            glm::vec3 point(corner & 1 ? casterBounds.max.x : casterBounds.min.x, corner & 2 ? casterBounds.max.y : casterBounds.min.y,
+                            corner & 4 ? casterBounds.max.z : casterBounds.min.z);
+            casterTop = std::max(casterTop, (lightView * glm::vec4(point, 1.0f)).z);
+        }
+        bool castersMoved = casters.Version() != renderedVersion;
+
+        // squared slope of the frustum's corner edges
+        float tanHalfFov = std::tan(glm::radians(camera.Zoom) * 0.5f);
+        float slope2 = tanHalfFov * tanHalfFov * (1.0f + aspect * aspect);
+
+        float sliceNear = nearPlane;
+        for (unsigned int i = 0; i < NR_CASCADES; i++)
+        {
+            float t = float(i + 1) / NR_CASCADES;
+            float sliceFar = splitLambda * nearPlane * std::pow(shadowDistance / nearPlane, t) +
+                             (1.0f - splitLambda) * (nearPlane + (shadowDistance - nearPlane) * t);
+
+            // smallest sphere around the slice, centered on the view axis
+            float center = std::min(0.5f * (sliceNear + sliceFar) * (1.0f + slope2), sliceFar);
+            float radius = std::sqrt((sliceFar - center) * (sliceFar - center) + sliceFar * sliceFar * slope2);
+            glm::vec3 lightCenter = glm::vec3(lightView * glm::vec4(camera.Position + camera.Front * center, 1.0f));
+
+            float texel = 2.0f * radius / size;
+            lightCenter.x = std::floor(lightCenter.x / texel) * texel;
+            lightCenter.y = std::floor(lightCenter.y / texel) * texel;
+            // the depth range moves in coarse steps, it only has to contain the slice and the casters
+            float step = 0.25f * radius;
+            float zMax = std::ceil(std::max(lightCenter.z + radius, casterTop) / step) * step;
+            float zMin = std::floor((lightCenter.z - radius) / step) * step;
+
+            glm::mat4 projection = glm::ortho(lightCenter.x - radius, lightCenter.x + radius, lightCenter.y - radius,
+                                              lightCenter.y + radius, -zMax, -zMin);
+            glm::mat4 viewProjection = projection * lightView;
+            uniforms.cascadeSplits[i] = sliceFar;
+            uniforms.cascadeBias[i] = 1.5f * texel / (zMax - zMin);
+
+            stats[i].rendered = castersMoved || viewProjection != uniforms.lightViewProjection[i];
+            uniforms.lightViewProjection[i] = viewProjection;
+            sliceNear = sliceFar;
+        }
+
+        bool anyRendered = false;
+        for (unsigned int i = 0; i < NR_CASCADES; i++)
+            anyRendered = anyRendered || stats[i].rendered;
+        if (anyRendered)
+            render();
+        renderedVersion = casters.Version();
+
+        glBindBuffer(GL_UNIFORM_BUFFER, UBO);
+        glBufferSubData(GL_UNIFORM_BUFFER, 0, sizeof(ShadowUniforms), &uniforms);
+        glBindBuffer(GL_UNIFORM_BUFFER, 0);
+    }
+
+    // binds the depth array to SHADOW_MAP_UNIT for the lit shaders
+    void BindTexture() const
+    {
+        GLStateCache::Instance().BindTexture(SHADOW_MAP_UNIT, GL_TEXTURE_2D_ARRAY, depthArray);
+    }
+
+    const CascadeStats &Stats(unsigned int cascade) const
+    {
+        return stats[cascade];
+    }
+
+private:
+    const ShadowCasters &casters;
+    unsigned int renderedVersion = ~0u;
+    unsigned int size;
+    unsigned int depthArray = 0, UBO = 0;
+    unsigned int FBOs[NR_CASCADES];
+    unsigned int queries[2 * NR_CASCADES]; // GL_TIMESTAMP before and after each cascade
+    bool timing[NR_CASCADES] = {};         // queries issued but not read back yet
+    ShadowUniforms uniforms = {};
+    CascadeStats stats[NR_CASCADES];
+
+    void render()
+    {
+        GLint previousFramebuffer, previousViewport[4];
+        glGetIntegerv(GL_FRAMEBUFFER_BINDING, &previousFramebuffer);
+        glGetIntegerv(GL_VIEWPORT, previousViewport);
+
+        GLStateCache &state = GLStateCache::Instance();
+        state.DepthMask(true);
+        state.DepthFunc(GL_LESS);
+        // slope scaled offset against acne on surfaces at a grazing angle to the light
+        glEnable(GL_POLYGON_OFFSET_FILL);
+        glPolygonOffset(2.0f, 1.0f);
+        glViewport(0, 0, size, size);
+        for (unsigned int i = 0; i < NR_CASCADES; i++)
+        {
+            if (!stats[i].rendered)
+                continue;
+            // timestamps rather than a GL_TIME_ELAPSED query, which can't nest in the benchmark's frame query
+            bool timed = !timing[i];
+            if (timed)
+                glQueryCounter(queries[2 * i], GL_TIMESTAMP);
+            RenderStats before = RenderStats::Frame();
+
+            glBindFramebuffer(GL_FRAMEBUFFER, FBOs[i]);
+            glClear(GL_DEPTH_BUFFER_BIT);
+            for (const ShadowCasters::Caster &caster : casters.All())
+            {
+                caster.cascadeShader->use();
+                caster.cascadeShader->setMat4(caster.shadowViewProjection, uniforms.lightViewProjection[i]);
+                // farther cascades have larger texels, coarser levels of detail are enough there
+                caster.model->DrawInstanced(*caster.cascadeShader, caster.instanceVBO, caster.instanceCount, i);
+            }
+
+            stats[i].drawCalls = RenderStats::Frame().drawCalls - before.drawCalls;
+            stats[i].triangles = RenderStats::Frame().triangles - before.triangles;
+            if (timed)
+            {
+                glQueryCounter(queries[2 * i + 1], GL_TIMESTAMP);
+                timing[i] = true;
+            }
+        }
+        glDisable(GL_POLYGON_OFFSET_FILL);
+
+        glBindFramebuffer(GL_FRAMEBUFFER, previousFramebuffer);
+        glViewport(previousViewport[0], previousViewport[1], previousViewport[2], previousViewport[3]);
+    }
+
+    // reads back the timestamps that are ready, without waiting for the others
+    void collectTimings()
+    {
+        for (unsigned int i = 0; i < NR_CASCADES; i++)
+        {
+            if (!timing[i])
+                continue;
+            GLint available = 0;
+            glGetQueryObjectiv(queries[2 * i + 1], GL_QUERY_RESULT_AVAILABLE, &available);
+            if (!available)
+                continue;
+            GLuint64 start = 0, end = 0;
+            glGetQueryObjectui64v(queries[2 * i], GL_QUERY_RESULT, &start);
+            glGetQueryObjectui64v(queries[2 * i + 1], GL_QUERY_RESULT, &end);
+            stats[i].gpuMs = (end - start) / 1.0e6;
+            timing[i] = false;
+        }
+    }
+};
+#endif
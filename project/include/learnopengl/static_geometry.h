@@ -0,0 +1,328 @@
+#ifndef STATIC_GEOMETRY_H
+#define STATIC_GEOMETRY_H
+
+#include <glad/glad.h>
+
+#include <learnopengl/gl_state.h>
+#include <learnopengl/instance_data.h>
+#include <learnopengl/render_stats.h>
+#include <learnopengl/vertex.h>
+
+#include <algorithm>
+#include <cstdint>
+#include <cstring>
+#include <vector>
+
+// GL 4.3 indirect drawing, not part of the 3.3 core profile glad was generated for
+#ifndef GL_DRAW_INDIRECT_BUFFER
+#define GL_DRAW_INDIRECT_BUFFER 0x8F3F
+#endif
+typedef void (APIENTRYP MultiDrawElementsIndirectProc)(GLenum mode, GLenum type, const void *indirect, GLsizei drawcount, GLsizei stride);
+
+// where a mesh lives inside the arena: its vertices start at baseVertex and its indices at firstIndex of a block
+struct GeometryRange {
+    unsigned int block = 0;
+    GLint baseVertex = 0;
+    GLuint firstIndex = 0;
+    GLsizei count = 0;
+    GLenum indexType = GL_UNSIGNED_INT;
+};
+
+// Vertex and index storage shared by every static mesh. Meshes are appended to a few large VBO/EBO pairs
+// (blocks), each holding one VertexLayout and index type and a VAO describing it, and drawn with base vertex
+// offsets. Indices are relative to the mesh's base vertex, so every mesh of up to 65536 vertices gets 16 bit
+// indices. Drawing
+// meshes of the same block back to back never switches the VAO, and several of them can go out in one call.
+//
+// The instance attributes (locations 5-11) of a block point at the instance buffer of the last instanced
+// draw; they are only re-pointed when the next instanced draw reads a different buffer.
+class StaticGeometryArena
+{
+public:
+    static const unsigned int BLOCK_VERTICES = 1 << 17;
+    static const unsigned int BLOCK_INDICES = 1 << 19;
+
+    static StaticGeometryArena &Instance()
+    {
+        static StaticGeometryArena arena;
+        return arena;
+    }
+
+    StaticGeometryArena(const StaticGeometryArena&) = delete;
+    StaticGeometryArena& operator=(const StaticGeometryArena&) = delete;
+
+    // glMultiDrawElementsIndirect, when the context is 4.3+ or has ARB_multi_draw_indirect; needs a current context
+    static void DetectIndirectSupport(GLADloadproc load)
+    {
+        GLint major = 0, minor = 0, count = 0;
+        glGetIntegerv(GL_MAJOR_VERSION, &major);
+        glGetIntegerv(GL_MINOR_VERSION, &minor);
+        bool supported = major > 4 || (major == 4 && minor >= 3);
+        glGetIntegerv(GL_NUM_EXTENSIONS, &count);
+        for (GLint i = 0; i < count && !supported; i++)
+        {
+            const char *name = reinterpret_cast<const char*>(glGetStringi(GL_EXTENSIONS, i));
+            supported = name && strcmp(name, "GL_ARB_multi_draw_indirect") == 0;
+        }
+        multiDrawIndirect() = supported ? (MultiDrawElementsIndirectProc)load("glMultiDrawElementsIndirect") : nullptr;
+    }
+
+    // encodes the mesh in format and copies it into the first block of that layout and index type with room for
+    // it; GL thread only
+    GeometryRange Allocate(const VertexFormat &format, const std::vector<Vertex> &vertices, const std::vector<unsigned int> &indices)
+    {
+        return Allocate(format, vertices, indices, std::vector<std::vector<unsigned int>>())[0];
+    }
+
+    // same, with index buffers for the levels of detail after indices, which all use the mesh's vertices. The
+    // ranges come back in the same order, indices first, sharing the block and base vertex
+    std::vector<GeometryRange> Allocate(const VertexFormat &format, const std::vector<Vertex> &vertices, const std::vector<unsigned int> &indices,
+                                        const std::vector<std::vector<unsigned int>> &lods)
+    {
+        GLenum indexType = vertices.size() <= 65536 ? GL_UNSIGNED_SHORT : GL_UNSIGNED_INT;
+        size_t indexCount = indices.size();
+        for (const std::vector<unsigned int> &lod : lods)
+            indexCount += lod.size();
+        unsigned int index = 0;
+        while (index < blocks.size() && !blocks[index].Fits(format.layout, indexType, vertices.size(), indexCount))
+            index++;
+        if (index == blocks.size())
+            blocks.push_back(createBlock(format.layout, indexType, std::max<size_t>(BLOCK_VERTICES, vertices.size()),
+                                         std::max<size_t>(BLOCK_INDICES, indexCount)));
+        Block &block = blocks[index];
+
+        // the element buffer is bound to the VAO, so the VAO has to be bound for the index upload
+        GLStateCache::Instance().BindVertexArray(block.VAO);
+        glBindBuffer(GL_ARRAY_BUFFER, block.VBO);
+        std::vector<unsigned char> bytes = EncodeVertices(vertices, format);
+        if (!bytes.empty())
+            glBufferSubData(GL_ARRAY_BUFFER, block.vertexCount * format.Stride(), bytes.size(), &bytes[0]);
+
+        std::vector<GeometryRange> ranges;
+        ranges.push_back(uploadIndices(block, index, indices));
+        for (const std::vector<unsigned int> &lod : lods)
+            ranges.push_back(uploadIndices(block, index, lod));
+        block.vertexCount += vertices.size();
+        return ranges;
+    }
+
+    unsigned int VertexArray(unsigned int block) const
+    {
+        return blocks[block].VAO;
+    }
+
+    void Draw(const GeometryRange &range)
+    {
+        GLStateCache::Instance().BindVertexArray(blocks[range.block].VAO);
+        glDrawElementsBaseVertex(GL_TRIANGLES, range.count, range.indexType, indexOffset(range), range.baseVertex);
+        RenderStats::Frame().CountDraw(range.count / 3);
+    }
+
+    // instanceCount copies reading their InstanceData from instanceVBO
+    void DrawInstanced(const GeometryRange &range, unsigned int instanceVBO, unsigned int instanceCount)
+    {
+        Block &block = blocks[range.block];
+        GLStateCache::Instance().BindVertexArray(block.VAO);
+        if (block.instanceVBO != instanceVBO)
+        {
+            attachInstances(instanceVBO);
+            block.instanceVBO = instanceVBO;
+        }
+        glDrawElementsInstancedBaseVertex(GL_TRIANGLES, range.count, range.indexType, indexOffset(range), instanceCount, range.baseVertex);
+        RenderStats::Frame().CountDraw((unsigned long long)range.count / 3 * instanceCount);
+    }
+
+    // ranges of one block in a single call: indirect when available, glMultiDrawElementsBaseVertex otherwise
+    void MultiDraw(const std::vector<GeometryRange> &ranges)
+    {
+        if (ranges.empty())
+            return;
+        GLStateCache::Instance().BindVertexArray(blocks[ranges[0].block].VAO);
+        unsigned long long triangles = 0;
+        for (const GeometryRange &range : ranges)
+            triangles += range.count / 3;
+
+        if (multiDrawIndirect())
+        {
+            commands.clear();
+            for (const GeometryRange &range : ranges)
+                commands.push_back(IndirectCommand{(GLuint)range.count, 1, range.firstIndex, range.baseVertex, 0});
+            if (indirectBuffer == 0)
+                glGenBuffers(1, &indirectBuffer);
+            glBindBuffer(GL_DRAW_INDIRECT_BUFFER, indirectBuffer);
+            glBufferData(GL_DRAW_INDIRECT_BUFFER, commands.size() * sizeof(IndirectCommand), &commands[0], GL_STREAM_DRAW);
+            multiDrawIndirect()(GL_TRIANGLES, ranges[0].indexType, nullptr, commands.size(), 0);
+            glBindBuffer(GL_DRAW_INDIRECT_BUFFER, 0);
+        }
+        else
+        {
+            counts.clear();
+            offsets.clear();
+            baseVertices.clear();
+            for (const GeometryRange &range : ranges)
+            {
+                counts.push_back(range.count);
+                offsets.push_back(indexOffset(range));
+                baseVertices.push_back(range.baseVertex);
+            }
+            glMultiDrawElementsBaseVertex(GL_TRIANGLES, &counts[0], ranges[0].indexType, &offsets[0], ranges.size(), &baseVertices[0]);
+        }
+        RenderStats::Frame().CountDraw(triangles);
+    }
+
+    unsigned int BlockCount() const
+    {
+        return blocks.size();
+    }
+
+    // deletes every block, the ranges handed out are invalid afterwards
+    void Clear()
+    {
+        for (Block &block : blocks)
+        {
+            glDeleteVertexArrays(1, &block.VAO);
+            glDeleteBuffers(1, &block.VBO);
+            glDeleteBuffers(1, &block.EBO);
+        }
+        blocks.clear();
+        if (indirectBuffer != 0)
+            glDeleteBuffers(1, &indirectBuffer);
+        indirectBuffer = 0;
+        GLStateCache::Instance().BindVertexArray(0);
+    }
+
+private:
+    struct Block {
+        VertexLayout layout = VertexLayout::Full;
+        GLenum indexType = GL_UNSIGNED_INT;
+        unsigned int VAO = 0, VBO = 0, EBO = 0;
+        size_t vertexCapacity = 0, indexCapacity = 0;
+        size_t vertexCount = 0, indexCount = 0;
+        unsigned int instanceVBO = 0;
+
+        bool Fits(VertexLayout vertexLayout, GLenum type, size_t vertices, size_t indices) const
+        {
+            return layout == vertexLayout && indexType == type && vertexCount + vertices <= vertexCapacity && indexCount + indices <= indexCapacity;
+        }
+    };
+
+    // layout glMultiDrawElementsIndirect reads
+    struct IndirectCommand {
+        GLuint count;
+        GLuint instanceCount;
+        GLuint firstIndex;
+        GLint baseVertex;
+        GLuint baseInstance;
+    };
+
+    std::vector<Block> blocks;
+    unsigned int indirectBuffer = 0;
+    // scratch space of MultiDraw, kept to avoid allocating every frame
+    std::vector<IndirectCommand> commands;
+    std::vector<GLsizei> counts;
+    std::vector<const void*> offsets;
+    std::vector<GLint> baseVertices;
+
+    StaticGeometryArena() = default;
+
+    static MultiDrawElementsIndirectProc &multiDrawIndirect()
+    {
+        static MultiDrawElementsIndirectProc proc = nullptr;
+        return proc;
+    }
+
+    static size_t indexSize(GLenum indexType)
+    {
+        return indexType == GL_UNSIGNED_SHORT ? sizeof(uint16_t) : sizeof(unsigned int);
+    }
+
+    static const void *indexOffset(const GeometryRange &range)
+    {
+        return (const void*)(range.firstIndex * indexSize(range.indexType));
+    }
+
+    // appends indices to the element buffer of the bound block, relative to the vertices being added to it
+    static GeometryRange uploadIndices(Block &block, unsigned int blockIndex, const std::vector<unsigned int> &indices)
+    {
+        GeometryRange range;
+        range.block = blockIndex;
+        range.baseVertex = block.vertexCount;
+        range.firstIndex = block.indexCount;
+        range.count = indices.size();
+        range.indexType = block.indexType;
+        if (!indices.empty() && block.indexType == GL_UNSIGNED_SHORT)
+        {
+            std::vector<uint16_t> shortIndices(indices.begin(), indices.end());
+            glBufferSubData(GL_ELEMENT_ARRAY_BUFFER, block.indexCount * sizeof(uint16_t), shortIndices.size() * sizeof(uint16_t), &shortIndices[0]);
+        }
+        else if (!indices.empty())
+            glBufferSubData(GL_ELEMENT_ARRAY_BUFFER, block.indexCount * sizeof(unsigned int), indices.size() * sizeof(unsigned int), &indices[0]);
+        block.indexCount += indices.size();
+        return range;
+    }
+
+    static Block createBlock(VertexLayout layout, GLenum indexType, size_t vertexCapacity, size_t indexCapacity)
+    {
+        VertexFormat format;
+        format.layout = layout;
+        Block block;
+        block.layout = layout;
+        block.indexType = indexType;
+        block.vertexCapacity = vertexCapacity;
+        block.indexCapacity = indexCapacity;
+        glGenVertexArrays(1, &block.VAO);
+        glGenBuffers(1, &block.VBO);
+        glGenBuffers(1, &block.EBO);
+
+        GLStateCache::Instance().BindVertexArray(block.VAO);
+        glBindBuffer(GL_ARRAY_BUFFER, block.VBO);
+        glBufferData(GL_ARRAY_BUFFER, vertexCapacity * format.Stride(), nullptr, GL_STATIC_DRAW);
+        glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, block.EBO);
+        glBufferData(GL_ELEMENT_ARRAY_BUFFER, indexCapacity * indexSize(indexType), nullptr, GL_STATIC_DRAW);
+
+        if (layout == VertexLayout::Packed)
+        {
+            // positions come out in [0, 1] and are scaled back in the shader, the bitangent isn't stored
+            glEnableVertexAttribArray(0);
+            glVertexAttribPointer(0, 3, GL_UNSIGNED_SHORT, GL_TRUE, sizeof(PackedVertex), (void*)offsetof(PackedVertex, Position));
+            glEnableVertexAttribArray(1);
+            glVertexAttribPointer(1, 4, GL_INT_2_10_10_10_REV, GL_TRUE, sizeof(PackedVertex), (void*)offsetof(PackedVertex, Normal));
+            glEnableVertexAttribArray(2);
+            glVertexAttribPointer(2, 2, GL_HALF_FLOAT, GL_FALSE, sizeof(PackedVertex), (void*)offsetof(PackedVertex, TexCoords));
+            glEnableVertexAttribArray(3);
+            glVertexAttribPointer(3, 4, GL_INT_2_10_10_10_REV, GL_TRUE, sizeof(PackedVertex), (void*)offsetof(PackedVertex, Tangent));
+            return block;
+        }
+        glEnableVertexAttribArray(0);
+        glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, sizeof(Vertex), (void*)0);
+        glEnableVertexAttribArray(1);
+        glVertexAttribPointer(1, 3, GL_FLOAT, GL_FALSE, sizeof(Vertex), (void*)offsetof(Vertex, Normal));
+        glEnableVertexAttribArray(2);
+        glVertexAttribPointer(2, 2, GL_FLOAT, GL_FALSE, sizeof(Vertex), (void*)offsetof(Vertex, TexCoords));
+        glEnableVertexAttribArray(3);
+        glVertexAttribPointer(3, 3, GL_FLOAT, GL_FALSE, sizeof(Vertex), (void*)offsetof(Vertex, Tangent));
+        glEnableVertexAttribArray(4);
+        glVertexAttribPointer(4, 3, GL_FLOAT, GL_FALSE, sizeof(Vertex), (void*)offsetof(Vertex, Bitangent));
+        return block;
+    }
+
+    // points attribute locations 5-11 of the bound VAO at a buffer of InstanceData, advanced once per instance
+    static void attachInstances(unsigned int instanceVBO)
+    {
+        glBindBuffer(GL_ARRAY_BUFFER, instanceVBO);
+        // a mat4 attribute takes up four consecutive vec4 locations, a mat3 three vec3 ones
+        for (unsigned int i = 0; i < 4; i++)
+        {
+            glEnableVertexAttribArray(5 + i);
+            glVertexAttribPointer(5 + i, 4, GL_FLOAT, GL_FALSE, sizeof(InstanceData), (void*)(offsetof(InstanceData, model) + i * sizeof(glm::vec4)));
+            glVertexAttribDivisor(5 + i, 1);
+        }
+        for (unsigned int i = 0; i < 3; i++)
+        {
+            glEnableVertexAttribArray(9 + i);
+            glVertexAttribPointer(9 + i, 3, GL_FLOAT, GL_FALSE, sizeof(InstanceData), (void*)(offsetof(InstanceData, normal) + i * sizeof(glm::vec3)));
+            glVertexAttribDivisor(9 + i, 1);
+        }
+    }
+};
+#endif
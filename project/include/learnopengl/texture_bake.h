@@ -0,0 +1,398 @@
+#ifndef TEXTURE_BAKE_H
+#define TEXTURE_BAKE_H
+
+#include <glad/glad.h>
+
+#include <learnopengl/block_compression.h>
+#include <learnopengl/image.h>
+#include <learnopengl/mapped_file.h>
+
+#include <algorithm>
+#include <atomic>
+#include <cmath>
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+#include <memory>
+#include <string>
+#include <vector>
+
+// S3TC is an extension that the generated GL loader doesn't include, BC5 (RGTC2) is core since 3.0
+#ifndef GL_COMPRESSED_RGB_S3TC_DXT1_EXT
+#define GL_COMPRESSED_RGB_S3TC_DXT1_EXT 0x83F0
+#endif
+#ifndef GL_COMPRESSED_RGBA_S3TC_DXT5_EXT
+#define GL_COMPRESSED_RGBA_S3TC_DXT5_EXT 0x83F3
+#endif
+
+// how a texture is sampled, decides the format it is baked to
+enum class TextureUsage {
+    Color,  // BC1, or BC3 when the image has alpha; read as .rgb/.rgba
+    Normal  // BC5, only the tangent space x and y are stored, shaders reconstruct z
+};
+
+struct TextureLevel {
+    int width;
+    int height;
+    size_t offset; // into TextureData::bytes
+    size_t size;
+};
+
+// A texture ready for upload: every mip level, either block compressed or uncompressed RGBA8. The bytes are
+// the memory mapped baked file, or the freshly baked buffer, and stay alive as long as any copy does.
+struct TextureData {
+    GLenum internalFormat = 0;
+    GLenum format = 0; // pixel format of uncompressed levels, 0 for block compressed ones
+    std::vector<TextureLevel> levels;
+    std::shared_ptr<const unsigned char> bytes;
+
+    bool Valid() const
+    {
+        return bytes != nullptr && !levels.empty();
+    }
+
+    bool Compressed() const
+    {
+        return format == 0;
+    }
+
+    const unsigned char *Level(unsigned int level) const
+    {
+        return bytes.get() + levels[level].offset;
+    }
+};
+
+// uploads every level of texture to target, which has to be bound already
+inline void UploadTextureLevels(GLenum target, const TextureData &texture)
+{
+    for (unsigned int i = 0; i < texture.levels.size(); i++)
+    {
+        const TextureLevel &level = texture.levels[i];
+        if (texture.Compressed())
+            glCompressedTexImage2D(target, i, texture.internalFormat, level.width, level.height, 0, level.size, texture.Level(i));
+        else
+            glTexImage2D(target, i, texture.internalFormat, level.width, level.height, 0, texture.format, GL_UNSIGNED_BYTE, texture.Level(i));
+    }
+}
+
+// creates a mipmapped, repeating 2D texture from pre-built levels; an invalid texture still yields a (empty)
+// texture name
+inline unsigned int UploadTexture2D(const TextureData &texture)
+{
+    unsigned int textureID;
+    glGenTextures(1, &textureID);
+    if (!texture.Valid())
+        return textureID;
+
+    glBindTexture(GL_TEXTURE_2D, textureID);
+    UploadTextureLevels(GL_TEXTURE_2D, texture);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAX_LEVEL, texture.levels.size() - 1);
+
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_REPEAT);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_REPEAT);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR_MIPMAP_LINEAR);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+
+    return textureID;
+}
+
+// faces in the +X, -X, +Y, -Y, +Z, -Z order expected by GL_TEXTURE_CUBE_MAP_POSITIVE_X + i
+inline unsigned int UploadCubemap(const std::vector<TextureData> &faces)
+{
+    unsigned int textureID;
+    glGenTextures(1, &textureID);
+    glBindTexture(GL_TEXTURE_CUBE_MAP, textureID);
+
+    // the faces are baked separately, only the levels all of them have are used
+    size_t levelCount = 1000;
+    for (unsigned int i = 0; i < faces.size(); i++)
+    {
+        if (!faces[i].Valid())
+            continue;
+        UploadTextureLevels(GL_TEXTURE_CUBE_MAP_POSITIVE_X + i, faces[i]);
+        levelCount = std::min(levelCount, faces[i].levels.size());
+    }
+    if (levelCount != 1000)
+        glTexParameteri(GL_TEXTURE_CUBE_MAP, GL_TEXTURE_MAX_LEVEL, levelCount - 1);
+
+    glTexParameteri(GL_TEXTURE_CUBE_MAP, GL_TEXTURE_MIN_FILTER, GL_LINEAR_MIPMAP_LINEAR);
+    glTexParameteri(GL_TEXTURE_CUBE_MAP, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+    glTexParameteri(GL_TEXTURE_CUBE_MAP, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+    glTexParameteri(GL_TEXTURE_CUBE_MAP, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+    glTexParameteri(GL_TEXTURE_CUBE_MAP, GL_TEXTURE_WRAP_R, GL_CLAMP_TO_EDGE);
+
+    return textureID;
+}
+
+// Turns source images (JPG/PNG) into their complete mip chain, block compressed where the driver supports it,
+// and keeps the result next to the source (<source>.color.texbake or <source>.normal.texbake, one per usage)
+// so that later runs only map the file and hand the levels to glCompressedTexImage2D: no image decoding and no
+// glGenerateMipmap at start-up. Layout, every section padded to 4 bytes:
+//
+//     TextureBakeHeader
+//     uint32[levelCount] level sizes
+//     level data, largest level first
+//
+// A baked file is used as long as the source still matches the stamp in the header and it was baked for the
+// same usage and S3TC support; otherwise the source is baked again.
+namespace TextureBake {
+
+const uint32_t MAGIC = 0x4b425854; // "TXBK"
+const uint32_t VERSION = 1;
+
+struct TextureBakeHeader {
+    uint32_t magic;
+    uint32_t version;
+    uint32_t usage;
+    uint32_t s3tc;
+    uint32_t internalFormat;
+    uint32_t format;
+    uint32_t width;
+    uint32_t height;
+    uint32_t levelCount;
+    uint32_t reserved;
+    uint64_t sourceSize;
+    int64_t  sourceMtime;
+    uint64_t sourceHash;
+};
+
+inline std::string BakedPath(const std::string &sourcePath, TextureUsage usage)
+{
+    return sourcePath + (usage == TextureUsage::Normal ? ".normal.texbake" : ".color.texbake");
+}
+
+inline std::atomic<bool> &s3tcSupport()
+{
+    static std::atomic<bool> supported(false);
+    return supported;
+}
+
+// queries the current context for S3TC; must run on the GL thread before any texture is baked or loaded
+inline void DetectFormatSupport()
+{
+    GLint count = 0;
+    glGetIntegerv(GL_NUM_EXTENSIONS, &count);
+    bool supported = false;
+    for (GLint i = 0; i < count && !supported; i++)
+    {
+        const char *name = reinterpret_cast<const char*>(glGetStringi(GL_EXTENSIONS, i));
+        supported = name && strcmp(name, "GL_EXT_texture_compression_s3tc") == 0;
+    }
+    s3tcSupport() = supported;
+}
+
+// expands any channel count to RGBA8, grey images are replicated into red, green and blue
+inline std::vector<unsigned char> expandToRGBA(const ImageData &image)
+{
+    size_t pixelCount = size_t(image.width) * image.height;
+    std::vector<unsigned char> rgba(pixelCount * 4);
+    const unsigned char *source = image.pixels.get();
+    for (size_t i = 0; i < pixelCount; i++)
+    {
+        const unsigned char *pixel = source + i * image.channels;
+        unsigned char *out = &rgba[i * 4];
+        if (image.channels < 3)
+        {
+            out[0] = out[1] = out[2] = pixel[0];
+            out[3] = image.channels == 2 ? pixel[1] : 255;
+        }
+        else
+        {
+            memcpy(out, pixel, 3);
+            out[3] = image.channels == 4 ? pixel[3] : 255;
+        }
+    }
+    return rgba;
+}
+
+// 2x2 box filter; normal map levels are renormalized so they don't get shorter towards the smaller levels
+inline std::vector<unsigned char> downsample(const std::vector<unsigned char> &pixels, int width, int height, bool normalMap)
+{
+    int halfWidth = std::max(1, width / 2), halfHeight = std::max(1, height / 2);
+    std::vector<unsigned char> result(size_t(halfWidth) * halfHeight * 4);
+    for (int y = 0; y < halfHeight; y++)
+    {
+        int y0 = std::min(y * 2, height - 1), y1 = std::min(y * 2 + 1, height - 1);
+        for (int x = 0; x < halfWidth; x++)
+        {
+            int x0 = std::min(x * 2, width - 1), x1 = std::min(x * 2 + 1, width - 1);
+            unsigned char *out = &result[(size_t(y) * halfWidth + x) * 4];
+            for (int c = 0; c < 4; c++)
+            {
+                int sum = pixels[(size_t(y0) * width + x0) * 4 + c] + pixels[(size_t(y0) * width + x1) * 4 + c] +
+                          pixels[(size_t(y1) * width + x0) * 4 + c] + pixels[(size_t(y1) * width + x1) * 4 + c];
+                out[c] = (sum + 2) / 4;
+            }
+            if (normalMap)
+            {
+                float n[3], length = 0.0f;
+                for (int c = 0; c < 3; c++)
+                {
+                    n[c] = out[c] / 255.0f * 2.0f - 1.0f;
+                    length += n[c] * n[c];
+                }
+                length = std::sqrt(length);
+                if (length > 0.0f)
+                {
+                    for (int c = 0; c < 3; c++)
+                        out[c] = (unsigned char)std::lround((n[c] / length * 0.5f + 0.5f) * 255.0f);
+                }
+            }
+        }
+    }
+    return result;
+}
+
+// bakes a decoded image; runs without a GL context
+inline TextureData Bake(const ImageData &image, TextureUsage usage)
+{
+    TextureData texture;
+    if (!image.Valid())
+        return texture;
+
+    bool hasAlpha = image.channels == 2 || image.channels == 4;
+    unsigned int blockBytes = 0;
+    void (*encodeBlock)(const unsigned char*, unsigned char*) = nullptr;
+    if (usage == TextureUsage::Normal)
+    {
+        texture.internalFormat = GL_COMPRESSED_RG_RGTC2;
+        blockBytes = 16;
+        encodeBlock = BlockCompression::EncodeBC5Block;
+    }
+    else if (s3tcSupport())
+    {
+        texture.internalFormat = hasAlpha ? GL_COMPRESSED_RGBA_S3TC_DXT5_EXT : GL_COMPRESSED_RGB_S3TC_DXT1_EXT;
+        blockBytes = hasAlpha ? 16 : 8;
+        encodeBlock = hasAlpha ? BlockCompression::EncodeBC3Block : BlockCompression::EncodeBC1Block;
+    }
+    else
+    {
+        // still saves the decode and the mipmap generation at start-up, just not the memory
+        texture.internalFormat = hasAlpha ? GL_RGBA8 : GL_RGB8;
+        texture.format = GL_RGBA;
+    }
+
+    std::shared_ptr<std::vector<unsigned char>> bytes = std::make_shared<std::vector<unsigned char>>();
+    std::vector<unsigned char> level = expandToRGBA(image);
+    int width = image.width, height = image.height;
+    for (;;)
+    {
+        std::vector<unsigned char> encoded = encodeBlock ? BlockCompression::CompressImage(level.data(), width, height, blockBytes, encodeBlock)
+                                                         : level;
+        texture.levels.push_back({width, height, bytes->size(), encoded.size()});
+        bytes->insert(bytes->end(), encoded.begin(), encoded.end());
+        if (width == 1 && height == 1)
+            break;
+        level = downsample(level, width, height, usage == TextureUsage::Normal);
+        width = std::max(1, width / 2);
+        height = std::max(1, height / 2);
+    }
+    texture.bytes = std::shared_ptr<const unsigned char>(bytes, bytes->data());
+    return texture;
+}
+
+inline void writePadded(std::ofstream &out, const void *data, size_t bytes)
+{
+    static const char padding[4] = {0, 0, 0, 0};
+    out.write(static_cast<const char*>(data), bytes);
+    out.write(padding, ((bytes + 3) & ~size_t(3)) - bytes);
+}
+
+// writes the baked texture next to sourcePath; failures only cost baking again on the next start-up
+inline bool Save(const std::string &sourcePath, TextureUsage usage, const TextureData &texture)
+{
+    SourceStamp stamp;
+    if (!texture.Valid() || !StampSource(sourcePath, stamp))
+        return false;
+    TextureBakeHeader header;
+    header.magic = MAGIC;
+    header.version = VERSION;
+    header.usage = uint32_t(usage);
+    header.s3tc = s3tcSupport();
+    header.internalFormat = texture.internalFormat;
+    header.format = texture.format;
+    header.width = texture.levels[0].width;
+    header.height = texture.levels[0].height;
+    header.levelCount = texture.levels.size();
+    header.reserved = 0;
+    header.sourceSize = stamp.size;
+    header.sourceMtime = stamp.mtime;
+    header.sourceHash = stamp.hash;
+
+    // write to a temporary file and rename it, so a crash or a concurrent reader never sees a partial file
+    std::string bakedPath = BakedPath(sourcePath, usage);
+    std::string temporaryPath = bakedPath + ".tmp";
+    {
+        std::ofstream out(temporaryPath, std::ios::binary | std::ios::trunc);
+        if (!out)
+            return false;
+        writePadded(out, &header, sizeof(header));
+        std::vector<uint32_t> sizes;
+        for (const TextureLevel &level : texture.levels)
+            sizes.push_back(level.size);
+        writePadded(out, sizes.data(), sizes.size() * sizeof(uint32_t));
+        for (unsigned int i = 0; i < texture.levels.size(); i++)
+            writePadded(out, texture.Level(i), texture.levels[i].size);
+        if (!out)
+        {
+            out.close();
+            std::remove(temporaryPath.c_str());
+            return false;
+        }
+    }
+    return std::rename(temporaryPath.c_str(), bakedPath.c_str()) == 0;
+}
+
+// maps the baked file of sourcePath, returns an invalid texture when there is no usable one
+inline TextureData LoadBaked(const std::string &sourcePath, TextureUsage usage)
+{
+    TextureData texture;
+    std::shared_ptr<MappedFile> file = std::make_shared<MappedFile>(BakedPath(sourcePath, usage));
+    if (!file->Data() || file->Size() < sizeof(TextureBakeHeader))
+        return texture;
+
+    TextureBakeHeader header;
+    memcpy(&header, file->Data(), sizeof(header));
+    SourceStamp stamp;
+    if (header.magic != MAGIC || header.version != VERSION || header.usage != uint32_t(usage) ||
+        header.s3tc != uint32_t(s3tcSupport()) || header.levelCount == 0 || !StampSource(sourcePath, stamp) ||
+        header.sourceSize != stamp.size || header.sourceMtime != stamp.mtime || header.sourceHash != stamp.hash)
+        return texture;
+
+    size_t offset = sizeof(header) + header.levelCount * sizeof(uint32_t);
+    if (offset > file->Size())
+        return texture;
+    const uint32_t *sizes = reinterpret_cast<const uint32_t*>(file->Data() + sizeof(header));
+    std::vector<TextureLevel> levels;
+    int width = header.width, height = header.height;
+    for (uint32_t i = 0; i < header.levelCount; i++)
+    {
+        if (offset + sizes[i] > file->Size())
+            return texture;
+        levels.push_back({width, height, offset, sizes[i]});
+        offset += (sizes[i] + 3) & ~size_t(3);
+        width = std::max(1, width / 2);
+        height = std::max(1, height / 2);
+    }
+    texture.internalFormat = header.internalFormat;
+    texture.format = header.format;
+    texture.levels = levels;
+    texture.bytes = std::shared_ptr<const unsigned char>(file, file->Data());
+    return texture;
+}
+
+// the baked texture of sourcePath, baking (and saving) it first when there is no up to date one. Doesn't touch
+// any OpenGL state, so it is safe to call from a worker thread.
+inline TextureData Load(const std::string &sourcePath, TextureUsage usage)
+{
+    TextureData texture = LoadBaked(sourcePath, usage);
+    if (texture.Valid())
+        return texture;
+    texture = Bake(DecodeImage(sourcePath), usage);
+    Save(sourcePath, usage, texture);
+    return texture;
+}
+
+}
+#endif
@@ -0,0 +1,188 @@
+#ifndef TEXTURE_CACHE_H
+#define TEXTURE_CACHE_H
+
+#include <glad/glad.h>
+
+#include <learnopengl/gl_state.h>
+#include <learnopengl/texture_bake.h>
+
+#include <climits>
+#include <cstdlib>
+#include <future>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+// Process-wide cache of textures keyed by the canonical absolute path of their source and their usage, so every
+// image is baked (or read from its baked file) and uploaded exactly once per format no matter how many models or
+// materials use it.
+// Loading happens in two steps:
+//
+//     Fetch    any thread: produces the texture's levels; concurrent fetches of one path wait for the first
+//     Acquire  GL thread:  uploads the fetched levels on first use and adds a reference to the texture
+//
+// Release drops a reference; textures nobody references any more stay resident until Evict deletes them.
+class TextureCache
+{
+public:
+    static TextureCache &Instance()
+    {
+        static TextureCache cache;
+        return cache;
+    }
+
+    TextureCache(const TextureCache&) = delete;
+    TextureCache& operator=(const TextureCache&) = delete;
+
+    static std::string CanonicalPath(const std::string &path)
+    {
+        char resolved[PATH_MAX];
+        if (realpath(path.c_str(), resolved))
+            return resolved;
+        return path; // missing files still get an entry, with an empty texture
+    }
+
+    // bakes or maps the texture unless it is already uploaded or being fetched; safe to call from workers
+    void Fetch(const std::string &path, TextureUsage usage)
+    {
+        fetch(CanonicalPath(path), usage);
+    }
+
+    // the texture name for path, uploading it first if needed. Fetches synchronously when nobody did before.
+    unsigned int Acquire(const std::string &path, TextureUsage usage)
+    {
+        std::string source = CanonicalPath(path);
+        std::shared_future<TextureData> pending = fetch(source, usage);
+        std::string key = entryKey(source, usage);
+
+        std::lock_guard<std::mutex> lock(mutex);
+        Entry &entry = entries[key];
+        if (entry.id == 0)
+        {
+            entry.id = UploadTexture2D(pending.get());
+            entry.pending = std::shared_future<TextureData>(); // the levels (and their mapping) aren't needed any more
+            keys[entry.id] = key;
+        }
+        entry.refCount++;
+        return entry.id;
+    }
+
+    // the cubemap made of the six faces (+X, -X, +Y, -Y, +Z, -Z), shared by everyone using the same faces
+    unsigned int AcquireCubemap(const std::vector<std::string> &faces)
+    {
+        std::string key = "cubemap:";
+        std::vector<std::string> faceSources;
+        for (const std::string &face : faces)
+        {
+            faceSources.push_back(CanonicalPath(face));
+            key += faceSources.back() + '|';
+        }
+
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            auto it = entries.find(key);
+            if (it != entries.end() && it->second.id != 0)
+            {
+                it->second.refCount++;
+                return it->second.id;
+            }
+        }
+
+        std::vector<TextureData> levels;
+        for (const std::string &faceSource : faceSources)
+            levels.push_back(fetch(faceSource, TextureUsage::Color).get());
+
+        std::lock_guard<std::mutex> lock(mutex);
+        // the faces only live on inside the cubemap
+        for (const std::string &faceSource : faceSources)
+        {
+            auto it = entries.find(entryKey(faceSource, TextureUsage::Color));
+            if (it != entries.end() && it->second.id == 0)
+                entries.erase(it);
+        }
+        Entry &entry = entries[key];
+        entry.id = UploadCubemap(levels);
+        entry.refCount++;
+        keys[entry.id] = key;
+        return entry.id;
+    }
+
+    void Release(unsigned int id)
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        auto key = keys.find(id);
+        if (key == keys.end())
+            return;
+        Entry &entry = entries[key->second];
+        if (entry.refCount > 0)
+            entry.refCount--;
+    }
+
+    // deletes every uploaded texture that has no references left, returns how many; GL thread only
+    unsigned int Evict()
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        unsigned int evicted = 0;
+        for (auto it = entries.begin(); it != entries.end();)
+        {
+            if (it->second.id != 0 && it->second.refCount == 0)
+            {
+                glDeleteTextures(1, &it->second.id);
+                GLStateCache::Instance().ForgetTexture(it->second.id);
+                keys.erase(it->second.id);
+                it = entries.erase(it);
+                evicted++;
+            }
+            else
+                ++it;
+        }
+        return evicted;
+    }
+
+    // number of textures currently uploaded
+    unsigned int Size() const
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        return keys.size();
+    }
+
+private:
+    struct Entry {
+        std::shared_future<TextureData> pending; // valid from the first fetch until the upload
+        unsigned int id = 0;
+        unsigned int refCount = 0;
+    };
+
+    mutable std::mutex mutex;
+    std::unordered_map<std::string, Entry> entries;
+    std::unordered_map<unsigned int, std::string> keys; // texture name -> entry, for Release and Evict
+
+    TextureCache() = default;
+
+    // the key of the texture baked from the canonical source path for usage, one file can be used both ways
+    static std::string entryKey(const std::string &canonicalPath, TextureUsage usage)
+    {
+        return (usage == TextureUsage::Normal ? "normal:" : "color:") + canonicalPath;
+    }
+
+    // the levels of the canonical source baked for usage, fetched by the first caller while later ones wait for
+    // the same result. The levels of a texture that is already uploaded aren't needed any more, an invalid
+    // future is returned then.
+    std::shared_future<TextureData> fetch(const std::string &source, TextureUsage usage)
+    {
+        std::promise<TextureData> promise;
+        std::shared_future<TextureData> result = promise.get_future().share();
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            Entry &entry = entries[entryKey(source, usage)];
+            if (entry.id != 0 || entry.pending.valid())
+                return entry.pending;
+            entry.pending = result;
+        }
+        // baking takes long, the lock isn't held meanwhile
+        promise.set_value(TextureBake::Load(source, usage));
+        return result;
+    }
+};
+#endif
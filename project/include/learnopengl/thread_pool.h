@@ -0,0 +1,106 @@
+#ifndef THREAD_POOL_H
+#define THREAD_POOL_H
+
+#include <algorithm>
+#include <condition_variable>
+#include <deque>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+// Fixed set of worker threads executing submitted tasks in FIFO order. Tasks still queued when the pool is
+// destroyed are dropped, the ones already running are waited for.
+class ThreadPool
+{
+public:
+    explicit ThreadPool(unsigned int threadCount)
+    {
+        threadCount = std::max(1u, threadCount);
+        for (unsigned int i = 0; i < threadCount; i++)
+            workers.emplace_back([this]() { work(); });
+    }
+
+    ~ThreadPool()
+    {
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            stopping = true;
+        }
+        wakeUp.notify_all();
+        for (std::thread &worker : workers)
+            worker.join();
+    }
+
+    ThreadPool(const ThreadPool&) = delete;
+    ThreadPool& operator=(const ThreadPool&) = delete;
+
+    void Submit(std::function<void()> task)
+    {
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            tasks.push_back(std::move(task));
+        }
+        wakeUp.notify_one();
+    }
+
+    unsigned int Size() const
+    {
+        return workers.size();
+    }
+
+    // calls task(begin, end) on ranges splitting [0, count), at most one per worker plus one for the calling
+    // thread and none shorter than grain. The caller works through its own range and returns once all ranges
+    // are done; the workers have to be free for that, tasks queued before are run first
+    void ParallelFor(unsigned int count, unsigned int grain, const std::function<void(unsigned int, unsigned int)> &task)
+    {
+        unsigned int chunks = std::min<unsigned int>(Size() + 1, count / std::max(grain, 1u));
+        if (chunks <= 1)
+        {
+            if (count > 0)
+                task(0, count);
+            return;
+        }
+        std::mutex doneMutex;
+        std::condition_variable done;
+        unsigned int remaining = chunks - 1;
+        for (unsigned int i = 1; i < chunks; i++)
+        {
+            Submit([&, i]() {
+                task(count * i / chunks, count * (i + 1) / chunks);
+                // notified under the lock, the caller may return and destroy done as soon as it sees 0
+                std::lock_guard<std::mutex> lock(doneMutex);
+                remaining--;
+                done.notify_one();
+            });
+        }
+        task(0, count / chunks);
+        std::unique_lock<std::mutex> lock(doneMutex);
+        done.wait(lock, [&]() { return remaining == 0; });
+    }
+
+private:
+    std::vector<std::thread> workers;
+    std::deque<std::function<void()>> tasks;
+    std::mutex mutex;
+    std::condition_variable wakeUp;
+    bool stopping = false;
+
+    void work()
+    {
+        for (;;)
+        {
+            std::function<void()> task;
+            {
+                std::unique_lock<std::mutex> lock(mutex);
+                wakeUp.wait(lock, [this]() { return stopping || !tasks.empty(); });
+                if (stopping)
+                    return;
+                task = std::move(tasks.front());
+                tasks.pop_front();
+            }
+            task();
+        }
+    }
+};
+#endif
@@ -0,0 +1,155 @@
+#ifndef VERTEX_H
+#define VERTEX_H
+
+#include <glm/glm.hpp>
+
+#include <learnopengl/bounds.h>
+
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <cstring>
+#include <vector>
+
+struct Vertex {
+    // position
+    glm::vec3 Position;
+    // normal
+    glm::vec3 Normal;
+    // texCoords
+    glm::vec2 TexCoords;
+    // tangent
+    glm::vec3 Tangent;
+    // bitangent
+    glm::vec3 Bitangent;
+};
+
+// How a mesh's vertices are laid out on the GPU, picked per model for the shader that draws it:
+//
+//     Full    Vertex as is, 56 bytes of floats
+//     Packed  PackedVertex, 20 bytes; the shader is compiled with PACKED_VERTEX, which scales positions back
+//             with the positionOffset/positionScale uniforms and rebuilds the bitangent from normal, tangent
+//             and the sign in the tangent's w
+enum class VertexLayout { Full, Packed };
+
+struct PackedVertex {
+    uint16_t Position[4];  // x, y, z normalized across the quantization box, the fourth is padding
+    uint32_t Normal;       // signed normalized 10:10:10:2 (GL_INT_2_10_10_10_REV), w unused
+    uint32_t Tangent;      // signed normalized 10:10:10:2, w is the bitangent sign
+    uint16_t TexCoords[2]; // half floats
+};
+
+struct VertexFormat {
+    VertexLayout layout = VertexLayout::Full;
+    // packed positions are quantized to 16 bits across this box; the meshes of a model share their model's
+    // box, so they keep sharing uniforms and can be drawn together
+    BoundingBox positionBounds;
+
+    glm::vec3 PositionOffset() const
+    {
+        return positionBounds.min;
+    }
+
+    glm::vec3 PositionScale() const
+    {
+        return glm::max(positionBounds.max - positionBounds.min, glm::vec3(1e-20f));
+    }
+
+    size_t Stride() const
+    {
+        return layout == VertexLayout::Packed ? sizeof(PackedVertex) : sizeof(Vertex);
+    }
+};
+
+namespace VertexPacking
+{
+// IEEE 754 binary16 with round to nearest even; overflows to infinity, underflows through the denormals to zero
+inline uint16_t packHalf(float value)
+{
+    uint32_t bits;
+    memcpy(&bits, &value, sizeof(bits));
+    uint32_t sign = (bits >> 16) & 0x8000;
+    uint32_t magnitude = bits & 0x7fffffff;
+    if (magnitude >= 0x7f800000) // infinity and NaN
+        return sign | 0x7c00 | (magnitude > 0x7f800000 ? 0x200 : 0);
+    if (magnitude >= 0x477ff000) // rounds to more than the largest half
+        return sign | 0x7c00;
+    if (magnitude < 0x38800000) // denormal half
+    {
+        if (magnitude < 0x33000000)
+            return sign;
+        uint32_t mantissa = (magnitude & 0x7fffff) | 0x800000;
+        uint32_t shift = 126 - (magnitude >> 23);
+        uint32_t half = mantissa >> shift;
+        uint32_t rest = mantissa & ((1u << shift) - 1), halfway = 1u << (shift - 1);
+        if (rest > halfway || (rest == halfway && (half & 1)))
+            half++;
+        return sign | half;
+    }
+    uint32_t half = (magnitude - 0x38000000) >> 13;
+    uint32_t rest = magnitude & 0x1fff;
+    if (rest > 0x1000 || (rest == 0x1000 && (half & 1)))
+        half++;
+    return sign | half;
+}
+
+inline uint32_t packSnorm(float value, int bits)
+{
+    int maximum = (1 << (bits - 1)) - 1;
+    int quantized = (int)std::lround(std::min(std::max(value, -1.0f), 1.0f) * maximum);
+    return (uint32_t)quantized & ((1u << bits) - 1);
+}
+
+// xyz into 10 bits each, w into the top 2 bits, the way GL_INT_2_10_10_10_REV reads them
+inline uint32_t packSnorm1010102(const glm::vec3 &xyz, float w)
+{
+    return packSnorm(xyz.x, 10) | packSnorm(xyz.y, 10) << 10 | packSnorm(xyz.z, 10) << 20 | packSnorm(w, 2) << 30;
+}
+
+inline uint16_t packUnorm16(float value)
+{
+    return (uint16_t)std::lround(std::min(std::max(value, 0.0f), 1.0f) * 65535.0f);
+}
+
+inline PackedVertex pack(const Vertex &vertex, const VertexFormat &format)
+{
+    PackedVertex packed;
+    glm::vec3 position = (vertex.Position - format.PositionOffset()) / format.PositionScale();
+    packed.Position[0] = packUnorm16(position.x);
+    packed.Position[1] = packUnorm16(position.y);
+    packed.Position[2] = packUnorm16(position.z);
+    packed.Position[3] = 0;
+
+    glm::vec3 normal = vertex.Normal;
+    float length = glm::length(normal);
+    packed.Normal = packSnorm1010102(length > 0.0f ? normal / length : normal, 0.0f);
+
+    // the bitangent only survives as the handedness of the tangent frame
+    glm::vec3 tangent = vertex.Tangent;
+    length = glm::length(tangent);
+    float handedness = glm::dot(glm::cross(vertex.Normal, vertex.Tangent), vertex.Bitangent) < 0.0f ? -1.0f : 1.0f;
+    packed.Tangent = packSnorm1010102(length > 0.0f ? tangent / length : tangent, handedness);
+
+    packed.TexCoords[0] = packHalf(vertex.TexCoords.x);
+    packed.TexCoords[1] = packHalf(vertex.TexCoords.y);
+    return packed;
+}
+}
+
+// the bytes the GPU gets for vertices stored in format
+inline std::vector<unsigned char> EncodeVertices(const std::vector<Vertex> &vertices, const VertexFormat &format)
+{
+    std::vector<unsigned char> bytes(vertices.size() * format.Stride());
+    if (vertices.empty())
+        return bytes;
+    if (format.layout == VertexLayout::Full)
+    {
+        memcpy(&bytes[0], &vertices[0], bytes.size());
+        return bytes;
+    }
+    PackedVertex *packed = reinterpret_cast<PackedVertex*>(&bytes[0]);
+    for (size_t i = 0; i < vertices.size(); i++)
+        packed[i] = VertexPacking::pack(vertices[i], format);
+    return bytes;
+}
+#endif
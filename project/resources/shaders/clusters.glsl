@@ -0,0 +1,55 @@
+// Clustered point light lists shared by the lit shaders, see lighting.glsl.
+
+#include "frame_uniforms.glsl"
+
+#define CLUSTERS_X 16
+#define CLUSTERS_Y 9
+#define CLUSTERS_Z 24
+
+// point lights binned into view space clusters, see learnopengl/light_clusters.h
+layout (std140) uniform ClusterUniforms {
+    vec2 clusterDepth;     // slice = log(depth) * x - y
+};
+
+uniform samplerBuffer clusterLights;    // four texels per light, the PointLight layout with the range last
+uniform usamplerBuffer clusterRanges;   // offset and count of each cluster's lights in clusterIndices
+uniform usamplerBuffer clusterIndices;
+
+// offset and count of the lights binned into the cluster of fragPos
+uvec2 ClusterRange(vec3 fragPos)
+{
+    vec4 viewPosition = view * vec4(fragPos, 1.0);
+    int slice = clamp(int(log(-viewPosition.z) * clusterDepth.x - clusterDepth.y), 0, CLUSTERS_Z - 1);
+    // tiles split the projected frustum like the binning does, whatever size the framebuffer has
+    vec4 clip = projection * viewPosition;
+    ivec2 tile = clamp(ivec2((clip.xy / clip.w * 0.5 + 0.5) * vec2(CLUSTERS_X, CLUSTERS_Y)), ivec2(0),
+                       ivec2(CLUSTERS_X - 1, CLUSTERS_Y - 1));
+    return texelFetch(clusterRanges, (slice * CLUSTERS_Y + tile.y) * CLUSTERS_X + tile.x).rg;
+}
+
+// light number index of the clustered light list
+PointLight ClusterLight(int index, out float range)
+{
+    vec4 positionConstant = texelFetch(clusterLights, 4 * index);
+    vec4 ambientLinear = texelFetch(clusterLights, 4 * index + 1);
+    vec4 diffuseQuadratic = texelFetch(clusterLights, 4 * index + 2);
+    vec4 specularRange = texelFetch(clusterLights, 4 * index + 3);
+    PointLight light;
+    light.position = positionConstant.xyz;
+    light.constant = positionConstant.w;
+    light.ambient = ambientLinear.xyz;
+    light.linear = ambientLinear.w;
+    light.diffuse = diffuseQuadratic.xyz;
+    light.quadratic = diffuseQuadratic.w;
+    light.specular = specularRange.xyz;
+    range = specularRange.w;
+    return light;
+}
+
+// lights are only binned within their range, they fade out smoothly before it ends
+float RangeFade(float distance, float range)
+{
+    float ratio = distance / range;
+    float fade = clamp(1.0 - ratio * ratio * ratio * ratio, 0.0, 1.0);
+    return fade * fade;
+}
@@ -1,5 +1,11 @@
 #version 330 core
+// forward, or the G-buffer with GBUFFER, see learnopengl/deferred_renderer.h
+#include "frame_uniforms.glsl"
+#include "gbuffer.glsl"
+#ifndef GBUFFER
+#include "lighting.glsl"
 out vec4 FragColor;
+#endif
 
 struct Material {
     sampler2D texture_diffuse1;
@@ -8,99 +14,26 @@ struct Material {
     float shininess;
 };
 
-struct DirLight {
-    vec3 direction;
-	
-    vec3 ambient;
-    vec3 diffuse;
-    vec3 specular;
-};
-
-struct PointLight {
-    vec3 position;
-    
-    float constant;
-    float linear;
-    float quadratic;
-	
-    vec3 ambient;
-    vec3 diffuse;
-    vec3 specular;
-};
-
-
-#define NR_POINT_LIGHTS 2
-
 in vec3 FragPos;
 in vec3 Normal;
 in vec2 TexCoords;
 
-uniform vec3 viewPosition;
-uniform DirLight dirLight;
-uniform PointLight pointLights[NR_POINT_LIGHTS];
 uniform Material material;
-uniform bool dan;
-
-// function prototypes
-vec3 CalcDirLight(DirLight light, vec3 normal, vec3 viewDir);
-vec3 CalcPointLight(PointLight light, vec3 normal, vec3 fragPos, vec3 viewDir);
 
 
 void main()
 {
-    if(texture(material.texture_diffuse1, TexCoords).a < 0.1)
+    vec4 albedo = texture(material.texture_diffuse1, TexCoords);
+    if(albedo.a < 0.1)
             discard;
 
     // properties
     vec3 norm = normalize(Normal);
-    vec3 viewDir = normalize(viewPosition - FragPos);
+    Surface surface = Surface(albedo.rgb, texture(material.texture_specular1, TexCoords).rgb, material.shininess);
 
-    vec3 result = vec3(0.0);
-    if(dan){
-        result = CalcDirLight(dirLight, norm, viewDir);
-    }else{
-        for(int i = 0; i < NR_POINT_LIGHTS; i++)
-            result += CalcPointLight(pointLights[i], norm, FragPos, viewDir);
-    }
-    FragColor = vec4(result, 1.0);
+#ifdef GBUFFER
+    WriteGBuffer(surface, norm);
+#else
+    FragColor = vec4(CalcLighting(surface, FragPos, norm), 1.0);
+#endif
 }
-
-// calculates the color when using a directional light.
-vec3 CalcDirLight(DirLight light, vec3 normal, vec3 viewDir)
-{
-    vec3 lightDir = normalize(-light.direction);
-    // diffuse shading
-    float diff = max(dot(normal, lightDir), 0.0);
-    // specular shading
-    vec3 halfwayDir = normalize(lightDir + viewDir);
-    float spec = pow(max(dot(normal, halfwayDir), 0.0), material.shininess);
-    // combine results
-    vec3 ambient = light.ambient * vec3(texture(material.texture_diffuse1, TexCoords));
-    vec3 diffuse = light.diffuse * diff * vec3(texture(material.texture_diffuse1, TexCoords));
-    vec3 specular = light.specular * spec * vec3(texture(material.texture_specular1, TexCoords));
-    return (ambient + diffuse + specular);
-}
-
-// calculates the color when using a point light.
-vec3 CalcPointLight(PointLight light, vec3 normal, vec3 fragPos, vec3 viewDir)
-{
-    vec3 lightDir = normalize(light.position - fragPos);
-    // diffuse shading
-    float diff = max(dot(normal, lightDir), 0.0);
-    // specular shading
-    vec3 halfwayDir = normalize(lightDir + viewDir);
-    float spec = pow(max(dot(normal, halfwayDir), 0.0), material.shininess);
-    // attenuation
-    float distance = length(light.position - fragPos);
-    float attenuation = 1.0 / (light.constant + light.linear * distance + light.quadratic * (distance * distance));    
-    // combine results
-    vec3 ambient = light.ambient * vec3(texture(material.texture_diffuse1, TexCoords));
-    vec3 diffuse = light.diffuse * diff * vec3(texture(material.texture_diffuse1, TexCoords));
-    vec3 specular = light.specular * spec * vec3(texture(material.texture_specular1, TexCoords));
-    ambient *= attenuation;
-    diffuse *= attenuation;
-    specular *= attenuation;
-    return (ambient + diffuse + specular);
-}
-
-
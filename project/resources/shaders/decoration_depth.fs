@@ -0,0 +1,19 @@
+#version 330 core
+
+// depth prepass and shadow casters: only the alpha test of decoration.fs, no color is written. Casters
+// without cutouts skip it (NO_ALPHA_TEST)
+struct Material {
+    sampler2D texture_diffuse1;
+};
+
+in vec2 TexCoords;
+
+uniform Material material;
+
+void main()
+{
+#ifndef NO_ALPHA_TEST
+    if(texture(material.texture_diffuse1, TexCoords).a < 0.1)
+        discard;
+#endif
+}
@@ -0,0 +1,60 @@
+#version 330 core
+layout (location = 0) in vec3 aPos;
+layout (location = 1) in vec3 aNormal;
+layout (location = 2) in vec2 aTexCoords;
+layout (location = 5) in mat4 aInstanceModel;
+// inverse transpose of mat3(aInstanceModel), computed on the CPU once per instance
+layout (location = 9) in mat3 aInstanceNormal;
+
+#ifdef PACKED_VERTEX
+// packed positions arrive normalized across the model box, see VertexLayout
+uniform vec3 positionOffset;
+uniform vec3 positionScale;
+#endif
+
+#ifndef DEPTH_ONLY
+out vec3 FragPos;
+out vec3 Normal;
+#endif
+out vec2 TexCoords;
+
+#ifdef SHADOW_PASS
+// light view and projection of the shadow cascade being rendered, see learnopengl/shadow_map.h
+uniform mat4 shadowViewProjection;
+#endif
+
+// the depth prepass (DEPTH_ONLY) and the shading pass compare depths with GL_EQUAL, both have to compute the
+// exact same positions
+invariant gl_Position;
+
+#include "frame_uniforms.glsl"
+
+
+void main()
+{
+#ifdef PACKED_VERTEX
+    vec3 position = positionOffset + aPos * positionScale;
+#else
+    vec3 position = aPos;
+#endif
+    vec3 worldPos = vec3(aInstanceModel * vec4(position, 1.0));
+#if defined(WORLD_POSITION)
+    // point light shadows: point_shadow.gs projects onto the six cube faces
+    gl_Position = vec4(worldPos, 1.0);
+#elif defined(SHADOW_PASS)
+    gl_Position = shadowViewProjection * vec4(worldPos, 1.0);
+#else
+    gl_Position = projection * view * vec4(worldPos, 1.0);
+#endif
+    TexCoords = aTexCoords;
+
+#ifndef DEPTH_ONLY
+    FragPos = worldPos;
+#ifdef UNIFORM_SCALE
+    // rotation and uniform scale only: mat3(model) keeps normals perpendicular, the fragment shader renormalizes
+    Normal = mat3(aInstanceModel) * aNormal;
+#else
+    Normal = aInstanceNormal * aNormal;
+#endif
+#endif
+}
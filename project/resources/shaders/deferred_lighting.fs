@@ -0,0 +1,34 @@
+#version 330 core
+out vec4 FragColor;
+
+in vec2 TexCoords;
+
+#include "frame_uniforms.glsl"
+#include "lighting.glsl"
+
+// the G-buffer, see learnopengl/deferred_renderer.h
+uniform sampler2D gAlbedo;      // rgb albedo
+uniform sampler2D gNormal;      // octahedral world space normal
+uniform sampler2D gSpecular;    // rgb specular, shininess / 256 in a
+uniform sampler2D gDepth;
+
+uniform mat4 inverseViewProjection;
+
+
+void main()
+{
+    // nothing was drawn here, the sky pass fills it in
+    float depth = texture(gDepth, TexCoords).r;
+    if(depth == 1.0)
+        discard;
+    // the sky pass tests against the depth of the G-buffer
+    gl_FragDepth = depth;
+
+    vec4 clip = inverseViewProjection * vec4(vec3(TexCoords, depth) * 2.0 - 1.0, 1.0);
+    vec3 fragPos = clip.xyz / clip.w;
+    vec3 normal = UnpackNormal(texture(gNormal, TexCoords).rg);
+    vec4 specularShininess = texture(gSpecular, TexCoords);
+    Surface surface = Surface(texture(gAlbedo, TexCoords).rgb, specularShininess.rgb, specularShininess.a * 256.0);
+
+    FragColor = vec4(CalcLighting(surface, fragPos, normal), 1.0);
+}
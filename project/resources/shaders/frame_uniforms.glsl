@@ -0,0 +1,32 @@
+// Camera and lights shared by all shaders, included before anything using them.
+
+struct DirLight {
+    vec3 direction;
+
+    vec3 ambient;
+    vec3 diffuse;
+    vec3 specular;
+};
+
+// members are ordered so that each float fills the padding after a vec3 in the std140 layout
+struct PointLight {
+    vec3 position;
+    float constant;
+    vec3 ambient;
+    float linear;
+    vec3 diffuse;
+    float quadratic;
+    vec3 specular;
+};
+
+#define NR_POINT_LIGHTS 2
+
+// filled once per frame, see learnopengl/frame_uniforms.h
+layout (std140) uniform FrameUniforms {
+    mat4 projection;
+    mat4 view;
+    vec3 viewPos;
+    bool dan;
+    DirLight dirLight;
+    PointLight pointLights[NR_POINT_LIGHTS];
+};
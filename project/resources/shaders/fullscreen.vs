@@ -0,0 +1,11 @@
+#version 330 core
+out vec2 TexCoords;
+
+// a triangle covering the whole viewport, built from the vertex index alone; the vertex shader of the full
+// screen passes (Hi-Z downsampling, deferred lighting)
+void main()
+{
+    vec2 position = vec2((gl_VertexID << 1) & 2, gl_VertexID & 2);
+    TexCoords = position;
+    gl_Position = vec4(position * 2.0 - 1.0, 0.0, 1.0);
+}
@@ -0,0 +1,41 @@
+// G-buffer encoding shared by the materials writing it and deferred_lighting.fs reading it, see
+// learnopengl/deferred_renderer.h.
+
+// what lighting needs of a material at one point, lit right away by the forward shaders (see lighting.glsl)
+// or left in the G-buffer
+struct Surface {
+    vec3 albedo;
+    vec3 specular;
+    float shininess;
+};
+
+// octahedral encoding of a unit vector in two components, UnpackNormal reverses it
+vec2 PackNormal(vec3 normal)
+{
+    normal /= abs(normal.x) + abs(normal.y) + abs(normal.z);
+    if(normal.z < 0.0)
+        normal.xy = (1.0 - abs(normal.yx)) * vec2(normal.x >= 0.0 ? 1.0 : -1.0, normal.y >= 0.0 ? 1.0 : -1.0);
+    return normal.xy;
+}
+
+vec3 UnpackNormal(vec2 encoded)
+{
+    vec3 normal = vec3(encoded, 1.0 - abs(encoded.x) - abs(encoded.y));
+    if(normal.z < 0.0)
+        normal.xy = (1.0 - abs(normal.yx)) * vec2(normal.x >= 0.0 ? 1.0 : -1.0, normal.y >= 0.0 ? 1.0 : -1.0);
+    return normalize(normal);
+}
+
+#ifdef GBUFFER
+// the material variants compiled with GBUFFER write their surface here instead of lighting it
+layout (location = 0) out vec4 gAlbedo;
+layout (location = 1) out vec2 gNormal;
+layout (location = 2) out vec4 gSpecular;
+
+void WriteGBuffer(Surface surface, vec3 normal)
+{
+    gAlbedo = vec4(surface.albedo, 1.0);
+    gNormal = PackNormal(normal);
+    gSpecular = vec4(surface.specular, surface.shininess / 256.0);
+}
+#endif
@@ -0,0 +1,30 @@
+#version 330 core
+out vec4 FragColor;
+
+// the previous level of the pyramid, the only level the sampler can see
+uniform sampler2D source;
+
+float fetch(ivec2 texel, ivec2 size)
+{
+    return texelFetch(source, min(texel, size - 1), 0).r;
+}
+
+// every texel keeps the farthest depth of the 2x2 source texels below it
+void main()
+{
+    ivec2 size = textureSize(source, 0);
+    ivec2 texel = ivec2(gl_FragCoord.xy) * 2;
+    float depth = max(max(fetch(texel, size), fetch(texel + ivec2(1, 0), size)),
+                      max(fetch(texel + ivec2(0, 1), size), fetch(texel + ivec2(1, 1), size)));
+
+    // with an odd source size the last row or column of this level also covers the one left over
+    bool extraColumn = (size.x & 1) != 0 && texel.x == size.x - 3;
+    bool extraRow = (size.y & 1) != 0 && texel.y == size.y - 3;
+    if(extraColumn)
+        depth = max(depth, max(fetch(texel + ivec2(2, 0), size), fetch(texel + ivec2(2, 1), size)));
+    if(extraRow)
+        depth = max(depth, max(fetch(texel + ivec2(0, 2), size), fetch(texel + ivec2(1, 2), size)));
+    if(extraColumn && extraRow)
+        depth = max(depth, fetch(texel + ivec2(2, 2), size));
+    FragColor = vec4(depth);
+}
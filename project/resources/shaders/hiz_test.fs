@@ -0,0 +1,6 @@
+#version 330 core
+
+// the test runs with GL_RASTERIZER_DISCARD, nothing reaches this stage
+void main()
+{
+}
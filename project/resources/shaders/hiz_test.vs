@@ -0,0 +1,49 @@
+#version 330 core
+// world space bounding sphere: center and radius
+layout (location = 0) in vec4 aSphere;
+
+#include "frame_uniforms.glsl"
+
+// Hi-Z pyramid, see learnopengl/occlusion_culler.h
+uniform sampler2D pyramid;
+uniform vec2 pyramidSize;
+uniform int pyramidLevels;
+
+// captured with transform feedback: 1 when the sphere may be visible
+out float visible;
+
+void main()
+{
+    gl_Position = vec4(0.0);
+    mat4 viewProjection = projection * view;
+
+    // screen rectangle and nearest depth of the box around the sphere
+    vec3 minimum = vec3(1.0), maximum = vec3(-1.0);
+    for(int i = 0; i < 8; i++)
+    {
+        vec3 offset = vec3((i & 1) != 0 ? 1.0 : -1.0, (i & 2) != 0 ? 1.0 : -1.0, (i & 4) != 0 ? 1.0 : -1.0);
+        vec4 clip = viewProjection * vec4(aSphere.xyz + offset * aSphere.w, 1.0);
+        if(clip.w <= 0.0)
+        {
+            // reaches behind the camera, the projection says nothing
+            visible = 1.0;
+            return;
+        }
+        vec3 ndc = clip.xyz / clip.w;
+        minimum = min(minimum, ndc);
+        maximum = max(maximum, ndc);
+    }
+    vec2 low = clamp(minimum.xy * 0.5 + 0.5, 0.0, 1.0) * pyramidSize;
+    vec2 high = clamp(maximum.xy * 0.5 + 0.5, 0.0, 1.0) * pyramidSize;
+
+    // the level where the rectangle spans at most two texels in each direction
+    vec2 size = high - low;
+    int level = int(clamp(ceil(log2(max(max(size.x, size.y), 1.0))), 0.0, float(pyramidLevels - 1)));
+    ivec2 levelSize = textureSize(pyramid, level);
+    ivec2 lowTexel = min(ivec2(low) >> level, levelSize - 1);
+    ivec2 highTexel = min(ivec2(high) >> level, levelSize - 1);
+    float occluderDepth = max(max(texelFetch(pyramid, lowTexel, level).r, texelFetch(pyramid, ivec2(highTexel.x, lowTexel.y), level).r),
+                              max(texelFetch(pyramid, ivec2(lowTexel.x, highTexel.y), level).r, texelFetch(pyramid, highTexel, level).r));
+
+    visible = minimum.z * 0.5 + 0.5 <= occluderDepth ? 1.0 : 0.0;
+}
@@ -0,0 +1,39 @@
+#version 330 core
+// forward, or the G-buffer with GBUFFER, see learnopengl/deferred_renderer.h
+#include "frame_uniforms.glsl"
+#include "gbuffer.glsl"
+#ifndef GBUFFER
+#include "lighting.glsl"
+out vec4 FragColor;
+#endif
+
+in vec3 FragPos;
+in vec2 TexCoords;
+flat in mat3 Rotation;
+flat in vec3 FrameDirection;
+flat in float Radius;
+
+uniform sampler2D albedoAtlas;
+uniform sampler2D normalDepthAtlas;
+
+void main()
+{
+    vec4 albedo = texture(albedoAtlas, TexCoords);
+    if(albedo.a < 0.5)
+        discard;
+    vec4 normalDepth = texture(normalDepthAtlas, TexCoords);
+    vec3 norm = normalize(Rotation * (normalDepth.xyz * 2.0 - 1.0));
+
+    // move the quad's fragment onto the baked surface and write its depth
+    vec3 surfacePos = FragPos + FrameDirection * (normalDepth.w * 2.0 - 1.0) * Radius;
+    vec4 clip = projection * view * vec4(surfacePos, 1.0);
+    gl_FragDepth = clip.z / clip.w * 0.5 + 0.5;
+
+    // impostors are far away, specular highlights are left out
+    Surface surface = Surface(albedo.rgb, vec3(0.0), 1.0);
+#ifdef GBUFFER
+    WriteGBuffer(surface, norm);
+#else
+    FragColor = vec4(CalcLighting(surface, surfacePos, norm), 1.0);
+#endif
+}
@@ -0,0 +1,67 @@
+#version 330 core
+layout (location = 0) in vec2 aCorner;
+layout (location = 5) in mat4 aInstanceModel;
+
+#include "frame_uniforms.glsl"
+
+// bounding sphere of the model in model space and the atlas layout, see learnopengl/impostor.h
+uniform vec3 sphereCenter;
+uniform float sphereRadius;
+uniform float frames;
+
+out vec3 FragPos;
+out vec2 TexCoords;
+flat out mat3 Rotation;
+flat out vec3 FrameDirection;
+flat out float Radius;
+
+float signNotZero(float value)
+{
+    return value >= 0.0 ? 1.0 : -1.0;
+}
+
+vec2 octahedralEncode(vec3 direction)
+{
+    vec3 n = direction / (abs(direction.x) + abs(direction.y) + abs(direction.z));
+    vec2 p = n.xz;
+    if(n.y < 0.0)
+        p = vec2((1.0 - abs(p.y)) * signNotZero(p.x), (1.0 - abs(p.x)) * signNotZero(p.y));
+    return p;
+}
+
+vec3 octahedralDecode(vec2 p)
+{
+    vec3 n = vec3(p.x, 1.0 - abs(p.x) - abs(p.y), p.y);
+    if(n.y < 0.0)
+        n.xz = vec2((1.0 - abs(n.z)) * signNotZero(n.x), (1.0 - abs(n.x)) * signNotZero(n.z));
+    return normalize(n);
+}
+
+// screen axes of the orthographic camera a frame was baked with, the same as glm::lookAt builds them
+void frameBasis(vec3 direction, out vec3 right, out vec3 up)
+{
+    vec3 upHint = abs(direction.y) > 0.999 ? vec3(0.0, 0.0, 1.0) : vec3(0.0, 1.0, 0.0);
+    right = normalize(cross(-direction, upHint));
+    up = cross(right, -direction);
+}
+
+void main()
+{
+    // rotation and largest scale of the instance; impostors assume the model is not sheared
+    vec3 scales = vec3(length(aInstanceModel[0].xyz), length(aInstanceModel[1].xyz), length(aInstanceModel[2].xyz));
+    Rotation = mat3(aInstanceModel[0].xyz / scales.x, aInstanceModel[1].xyz / scales.y, aInstanceModel[2].xyz / scales.z);
+    Radius = sphereRadius * max(scales.x, max(scales.y, scales.z));
+    vec3 center = vec3(aInstanceModel * vec4(sphereCenter, 1.0));
+
+    // the frame baked closest to the direction of the camera, seen from the model
+    vec3 toCamera = transpose(Rotation) * normalize(viewPos - center);
+    vec2 cell = min(floor((octahedralEncode(toCamera) * 0.5 + 0.5) * frames), vec2(frames - 1.0));
+    vec3 direction = octahedralDecode((cell + 0.5) / frames * 2.0 - 1.0);
+    vec3 right, up;
+    frameBasis(direction, right, up);
+
+    FrameDirection = Rotation * direction;
+    FragPos = center + Rotation * (right * aCorner.x + up * aCorner.y) * Radius;
+    TexCoords = (cell + aCorner * 0.5 + 0.5) / frames;
+    gl_Position = projection * view * vec4(FragPos, 1.0);
+}
@@ -0,0 +1,30 @@
+#version 330 core
+layout (location = 0) out vec4 Albedo;
+layout (location = 1) out vec4 NormalDepth;
+
+struct Material {
+    sampler2D texture_diffuse1;
+};
+
+in vec3 ObjectPos;
+in vec3 Normal;
+in vec2 TexCoords;
+
+uniform Material material;
+uniform vec3 sphereCenter;
+uniform float sphereRadius;
+// direction from the model towards the camera of this frame
+uniform vec3 viewDirection;
+
+void main()
+{
+    vec4 albedo = texture(material.texture_diffuse1, TexCoords);
+    if(albedo.a < 0.1)
+        discard;
+    vec3 normal = normalize(Normal);
+
+    Albedo = vec4(albedo.rgb, 1.0);
+    // depth is how far the surface lies in front of the sphere center, mapped from [-radius, radius]
+    float depth = dot(ObjectPos - sphereCenter, viewDirection) / sphereRadius;
+    NormalDepth = vec4(normal * 0.5 + 0.5, depth * 0.5 + 0.5);
+}
@@ -0,0 +1,29 @@
+#version 330 core
+layout (location = 0) in vec3 aPos;
+layout (location = 1) in vec3 aNormal;
+layout (location = 2) in vec2 aTexCoords;
+
+#ifdef PACKED_VERTEX
+// packed positions arrive normalized across the model box, see VertexLayout
+uniform vec3 positionOffset;
+uniform vec3 positionScale;
+#endif
+
+// orthographic view of one atlas frame, in model space
+uniform mat4 viewProjection;
+
+out vec3 ObjectPos;
+out vec3 Normal;
+out vec2 TexCoords;
+
+void main()
+{
+#ifdef PACKED_VERTEX
+    ObjectPos = positionOffset + aPos * positionScale;
+#else
+    ObjectPos = aPos;
+#endif
+    Normal = aNormal;
+    TexCoords = aTexCoords;
+    gl_Position = viewProjection * vec4(ObjectPos, 1.0);
+}
@@ -0,0 +1,68 @@
+// Lighting shared by the forward material shaders and deferred_lighting.fs: the directional light with its
+// cascaded shadows by day, the clustered point lights by night.
+
+#include "frame_uniforms.glsl"
+#include "gbuffer.glsl"
+#include "shadows.glsl"
+#include "clusters.glsl"
+
+// calculates the color when using a directional light, shadow scales everything but the ambient term.
+vec3 CalcDirLight(DirLight light, Surface surface, vec3 normal, vec3 viewDir, float shadow)
+{
+    vec3 lightDir = normalize(-light.direction);
+    // diffuse shading
+    float diff = max(dot(normal, lightDir), 0.0);
+    // specular shading
+    vec3 halfwayDir = normalize(lightDir + viewDir);
+    float spec = pow(max(dot(normal, halfwayDir), 0.0), surface.shininess);
+    // combine results
+    vec3 ambient = light.ambient * surface.albedo;
+    vec3 diffuse = light.diffuse * diff * surface.albedo;
+    vec3 specular = light.specular * spec * surface.specular;
+    return (ambient + shadow * (diffuse + specular));
+}
+
+// calculates the color when using a point light, shadow scales everything but the ambient term.
+vec3 CalcPointLight(PointLight light, Surface surface, vec3 normal, vec3 fragPos, vec3 viewDir, float shadow)
+{
+    vec3 lightDir = normalize(light.position - fragPos);
+    // diffuse shading
+    float diff = max(dot(normal, lightDir), 0.0);
+    // specular shading
+    vec3 halfwayDir = normalize(lightDir + viewDir);
+    float spec = pow(max(dot(normal, halfwayDir), 0.0), surface.shininess);
+    // attenuation
+    float distance = length(light.position - fragPos);
+    float attenuation = 1.0 / (light.constant + light.linear * distance + light.quadratic * (distance * distance));
+    // combine results
+    vec3 ambient = light.ambient * surface.albedo;
+    vec3 diffuse = light.diffuse * diff * surface.albedo;
+    vec3 specular = light.specular * spec * surface.specular;
+    ambient *= attenuation;
+    diffuse *= attenuation;
+    specular *= attenuation;
+    return (ambient + shadow * (diffuse + specular));
+}
+
+// color of surface at fragPos (world space) with the world space normal, under the lights of the time of day
+vec3 CalcLighting(Surface surface, vec3 fragPos, vec3 normal)
+{
+    vec3 viewDir = normalize(viewPos - fragPos);
+    if(dan)
+        return CalcDirLight(dirLight, surface, normal, viewDir, ShadowFactor(fragPos));
+
+    // only the lights whose range reaches the cluster of this fragment
+    vec3 result = vec3(0.0);
+    uvec2 cluster = ClusterRange(fragPos);
+    for(uint i = 0u; i < cluster.y; i++)
+    {
+        int index = int(texelFetch(clusterIndices, int(cluster.x + i)).r);
+        float range;
+        PointLight light = ClusterLight(index, range);
+        // the first NR_POINT_LIGHTS lights of the list are the shadowed lamps
+        float shadow = index < NR_POINT_LIGHTS ? PointShadowFactor(index, fragPos) : 1.0;
+        result += RangeFade(length(light.position - fragPos), range) *
+                  CalcPointLight(light, surface, normal, fragPos, viewDir, shadow);
+    }
+    return result;
+}
@@ -0,0 +1,8 @@
+#version 330 core
+out vec4 FragColor;
+
+// the base level of the Hi-Z pyramid holds the window space depth of the nearest occluder
+void main()
+{
+    FragColor = vec4(gl_FragCoord.z);
+}
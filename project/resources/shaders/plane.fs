@@ -1,36 +1,16 @@
 #version 330 core
+// forward, or the G-buffer with GBUFFER, see learnopengl/deferred_renderer.h
+#include "frame_uniforms.glsl"
+#include "gbuffer.glsl"
+#ifndef GBUFFER
+#include "lighting.glsl"
 out vec4 FragColor;
-
-
-struct DirLight {
-    vec3 direction;
-
-    vec3 ambient;
-    vec3 diffuse;
-    vec3 specular;
-};
-
-struct PointLight {
-    vec3 position;
-
-    float constant;
-    float linear;
-    float quadratic;
-
-    vec3 ambient;
-    vec3 diffuse;
-    vec3 specular;
-};
-
-#define NR_POINT_LIGHTS 2
+#endif
 
 in VS_OUT {
     vec3 FragPos;
     vec2 TexCoords;
-    DirLight dLight;
-    PointLight pLight[NR_POINT_LIGHTS];
-    vec3 TangentViewPos;
-    vec3 TangentFragPos;
+    mat3 TBN;
 } fs_in;
 
 
@@ -41,7 +21,6 @@ uniform sampler2D depthMap;
 uniform sampler2D specMap;
 uniform float shininess;
 uniform float heightScale;
-uniform bool dan;
 
 
 vec2 ParallaxMapping(vec2 texCoords, vec3 viewDir)
@@ -50,65 +29,20 @@ vec2 ParallaxMapping(vec2 texCoords, vec3 viewDir)
     return texCoords - viewDir.xy * (height * heightScale);
 }
 
-vec3 CalcDirLight(DirLight light, vec3 normal, vec3 viewDir, vec2 texCoords);
-vec3 CalcPointLight(PointLight light, vec3 normal, vec3 fragPos, vec3 viewDir, vec2 texCoords);
-
 void main()
 {
-    // offset texture coordinates with Parallax Mapping
-    vec3 viewDir = normalize(fs_in.TangentViewPos - fs_in.TangentFragPos);
-    vec2 texCoords = fs_in.TexCoords;
-
-    texCoords = ParallaxMapping(fs_in.TexCoords,  viewDir);
-
-    // obtain normal from normal map
-    vec3 normal = texture(normalMap, texCoords).rgb;
-    normal = normalize(normal * 2.0 - 1.0);
-
-    vec3 result = vec3(0.0);
-    if(dan){
-        result += CalcDirLight(fs_in.dLight, normal, viewDir, texCoords);
-    }else{
-        for(int i = 0; i < NR_POINT_LIGHTS; i++)
-            result += CalcPointLight(fs_in.pLight[i], normal, fs_in.TangentFragPos, viewDir, texCoords);
-
-    }
-
-    FragColor = vec4(result, 1.0);
-}
-
-vec3 CalcDirLight(DirLight light, vec3 normal, vec3 viewDir, vec2 texCoords)
-{
-    vec3 lightDir = normalize(-light.direction);
-    // diffuse shading
-    float diff = max(dot(normal, lightDir), 0.0);
-    // specular shading
-    vec3 halfwayDir = normalize(lightDir + viewDir);
-    float spec = pow(max(dot(normal, halfwayDir), 0.0), shininess);
-    // combine results
-    vec3 ambient = light.ambient * vec3(texture(diffuseMap, texCoords).rgb);
-    vec3 diffuse = light.diffuse * diff * vec3(texture(diffuseMap, texCoords).rgb);
-    vec3 specular = light.specular * spec * texture(specMap, texCoords).rgb;
-    return (ambient + diffuse + specular);
+    // lighting is done in world space, only Parallax Mapping needs the view direction in tangent space
+    vec3 viewDir = normalize(viewPos - fs_in.FragPos);
+    vec2 texCoords = ParallaxMapping(fs_in.TexCoords, normalize(transpose(fs_in.TBN) * viewDir));
+
+    // obtain normal from normal map, it only stores x and y (BC5) so z is reconstructed, then take it to world space
+    vec2 normalXY = texture(normalMap, texCoords).rg * 2.0 - 1.0;
+    vec3 normal = normalize(fs_in.TBN * vec3(normalXY, sqrt(max(1.0 - dot(normalXY, normalXY), 0.0))));
+    Surface surface = Surface(texture(diffuseMap, texCoords).rgb, texture(specMap, texCoords).rgb, shininess);
+
+#ifdef GBUFFER
+    WriteGBuffer(surface, normal);
+#else
+    FragColor = vec4(CalcLighting(surface, fs_in.FragPos, normal), 1.0);
+#endif
 }
-
-vec3 CalcPointLight(PointLight light, vec3 normal, vec3 fragPos, vec3 viewDir, vec2 texCoords)
-{
-    vec3 lightDir = normalize(light.position - fragPos);
-    // diffuse shading
-    float diff = max(dot(normal, lightDir), 0.0);
-    // specular shading
-    vec3 halfwayDir = normalize(lightDir + viewDir);
-    float spec = pow(max(dot(normal, halfwayDir), 0.0), shininess);
-    // attenuation
-    float distance = length(light.position - fragPos);
-    float attenuation = 1.0 / (light.constant + light.linear * distance + light.quadratic * (distance * distance));
-    // combine results
-    vec3 ambient = light.ambient * vec3(texture(diffuseMap, texCoords).rgb);
-    vec3 diffuse = light.diffuse * diff * vec3(texture(diffuseMap, texCoords).rgb);
-    vec3 specular = light.specular * spec * texture(specMap, texCoords).rgb;
-    ambient *= attenuation;
-    diffuse *= attenuation;
-    specular *= attenuation;
-    return (ambient + diffuse + specular);
-}
\ No newline at end of file
@@ -0,0 +1,24 @@
+#version 330 core
+
+// point light shadow casters: the alpha test of decoration.fs, and the distance to the light as depth so the
+// lit shaders can compare distances instead of per face depths. Casters without cutouts skip the test
+// (NO_ALPHA_TEST)
+struct Material {
+    sampler2D texture_diffuse1;
+};
+
+in vec3 FragPos;
+in vec2 FaceTexCoords;
+
+uniform Material material;
+uniform vec3 lightPosition;
+uniform float farPlane;
+
+void main()
+{
+#ifndef NO_ALPHA_TEST
+    if(texture(material.texture_diffuse1, FaceTexCoords).a < 0.1)
+        discard;
+#endif
+    gl_FragDepth = length(FragPos - lightPosition) / farPlane;
+}
@@ -0,0 +1,28 @@
+#version 330 core
+layout (triangles) in;
+layout (triangle_strip, max_vertices = 18) out;
+
+// renders every triangle into all six faces of the cube map attached as a layered depth target, see
+// learnopengl/point_shadow.h. gl_Position arrives in world space (decoration_instanced.vs with WORLD_POSITION)
+uniform mat4 faceViewProjection[6];
+
+in vec2 TexCoords[];
+
+out vec3 FragPos;
+out vec2 FaceTexCoords;
+
+void main()
+{
+    for(int face = 0; face < 6; face++)
+    {
+        gl_Layer = face;
+        for(int i = 0; i < 3; i++)
+        {
+            FragPos = gl_in[i].gl_Position.xyz;
+            FaceTexCoords = TexCoords[i];
+            gl_Position = faceViewProjection[face] * gl_in[i].gl_Position;
+            EmitVertex();
+        }
+        EndPrimitive();
+    }
+}
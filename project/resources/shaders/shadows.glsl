@@ -0,0 +1,53 @@
+// Shadow lookups shared by the lit shaders, see lighting.glsl.
+
+#include "frame_uniforms.glsl"
+
+#define NR_CASCADES 4
+
+// cascaded shadow map of the directional light, see learnopengl/shadow_map.h
+layout (std140) uniform ShadowUniforms {
+    mat4 lightViewProjection[NR_CASCADES];
+    vec4 cascadeSplits;    // view space distance where each cascade ends
+    vec4 cascadeBias;      // depth bias of each cascade
+};
+
+uniform sampler2DArrayShadow shadowMap;
+
+// distance to each point light over pointShadowFar, see learnopengl/point_shadow.h
+uniform samplerCubeShadow pointShadowMaps[NR_POINT_LIGHTS];
+uniform float pointShadowFar;
+
+// how much of the directional light reaches fragPos, from 0 in shadow to 1; four bilinear comparisons soften
+// the edge over about three texels
+float ShadowFactor(vec3 fragPos)
+{
+    float depth = -(view * vec4(fragPos, 1.0)).z;
+    int cascade = 0;
+    while(cascade < NR_CASCADES && depth > cascadeSplits[cascade])
+        cascade++;
+    if(cascade == NR_CASCADES)
+        return 1.0;
+
+    vec3 coords = (lightViewProjection[cascade] * vec4(fragPos, 1.0)).xyz * 0.5 + 0.5;
+    vec2 texel = 1.0 / vec2(textureSize(shadowMap, 0).xy);
+    float lit = 0.0;
+    for(int i = 0; i < 4; i++)
+    {
+        vec2 offset = vec2((i & 1) != 0 ? 1.0 : -1.0, (i & 2) != 0 ? 1.0 : -1.0) * texel;
+        lit += texture(shadowMap, vec4(coords.xy + offset, float(cascade), coords.z - cascadeBias[cascade]));
+    }
+    return lit * 0.25;
+}
+
+// how much of point light number light reaches fragPos, from 0 in shadow to 1. The cube holds distances, the
+// bilinear comparison of the four nearest texels softens the edge
+float PointShadowFactor(int light, vec3 fragPos)
+{
+    vec3 toFragment = fragPos - pointLights[light].position;
+    float distance = length(toFragment) / pointShadowFar;
+    if(distance >= 1.0)
+        return 1.0;
+    vec4 coords = vec4(toFragment, distance - 0.002);
+    // GLSL 3.30 only indexes sampler arrays with constants
+    return light == 0 ? texture(pointShadowMaps[0], coords) : texture(pointShadowMaps[1], coords);
+}
@@ -13,9 +13,24 @@
 #include <learnopengl/shader.h>
 #include <learnopengl/camera.h>
 #include <learnopengl/model.h>
+#include <learnopengl/ground.h>
+#include <learnopengl/frame_uniforms.h>
+#include <learnopengl/asset_loader.h>
+#include <learnopengl/benchmark.h>
+#include <learnopengl/gl_state.h>
+#include <learnopengl/impostor.h>
+#include <learnopengl/occlusion_culler.h>
+#include <learnopengl/shadow_map.h>
+#include <learnopengl/point_shadow.h>
+#include <learnopengl/light_clusters.h>
+#include <learnopengl/deferred_renderer.h>
 
 #include <iostream>
 #include <cmath>
+#include <cstdlib>
+#include <cstring>
+#include <memory>
+#include <random>
 
 void framebuffer_size_callback(GLFWwindow *window, int width, int height);
 
@@ -25,18 +40,12 @@ void scroll_callback(GLFWwindow *window, double xoffset, double yoffset);
 
 void processInput(GLFWwindow *window);
 
-unsigned int loadTexture(char const *path);
-
-void renderPlane(unsigned int planeVAO, unsigned int planeVBO);
-
-void renderPath(unsigned int pathVAO, unsigned int pathVBO);
-
-unsigned int loadCubemap(vector<std::string> faces);
-
 void key_callback(GLFWwindow *window, int key, int scancode, int action, int mods);
 
 void DrawImGui();
 
+void DrawLoadingScreen(unsigned int completed, unsigned int requested);
+
 // settings
 const unsigned int SCR_WIDTH = 800;
 const unsigned int SCR_HEIGHT = 600;
@@ -80,11 +89,48 @@ struct ProgramState {
     DirectionalLight dirLight;
     bool day = true;
     bool ImGuiEnabled = false;
+    CullStats culling;
+    LodSelector lodSelector;
+    LodStats lods;
+    bool occlusionCulling = true;
+    bool depthPrepass = true;
+    float shadowDistance = 20.0f;
+    CascadedShadowMap::CascadeStats shadowCascades[NR_CASCADES];
+    unsigned int pointShadowsRendered = 0;
+    int streetLamps = 0;
+    LightClusters::Stats clusters;
+    bool deferred = false;
+    DeferredRenderer::Stats deferredPasses;
 };
 
 ProgramState *programState;
 
-int main() {
+int main(int argc, char **argv) {
+    // --benchmark <report.json> [--frames N]: fly the camera along a fixed path in a hidden window and write
+    // the frame times to report.json and report.csv instead of running interactively
+    // --no-depth-prepass: shade the foliage in a single pass, for comparing both in benchmarks
+    // --deferred: start with deferred shading instead of forward
+    // --night [--street-lamps N]: start at night, with N of the extra lamps
+    std::string benchmarkReport;
+    unsigned int benchmarkFrames = 600;
+    bool depthPrepass = true, deferred = false, night = false;
+    int streetLampCount = 0;
+    for (int i = 1; i < argc; i++) {
+        if (strcmp(argv[i], "--benchmark") == 0 && i + 1 < argc)
+            benchmarkReport = argv[++i];
+        else if (strcmp(argv[i], "--frames") == 0 && i + 1 < argc)
+            benchmarkFrames = std::max(1, atoi(argv[++i]));
+        else if (strcmp(argv[i], "--no-depth-prepass") == 0)
+            depthPrepass = false;
+        else if (strcmp(argv[i], "--deferred") == 0)
+            deferred = true;
+        else if (strcmp(argv[i], "--night") == 0)
+            night = true;
+        else if (strcmp(argv[i], "--street-lamps") == 0 && i + 1 < argc)
+            streetLampCount = atoi(argv[++i]);
+    }
+    bool benchmarking = !benchmarkReport.empty();
+
     glfwInit();
     glfwWindowHint(GLFW_CONTEXT_VERSION_MAJOR, 3);
     glfwWindowHint(GLFW_CONTEXT_VERSION_MINOR, 3);
@@ -93,6 +139,8 @@ int main() {
 #ifdef __APPLE__
     glfwWindowHint(GLFW_OPENGL_FORWARD_COMPAT, GL_TRUE);
 #endif
+    if (benchmarking)
+        glfwWindowHint(GLFW_VISIBLE, GLFW_FALSE);
 
     GLFWwindow *window = glfwCreateWindow(SCR_WIDTH, SCR_HEIGHT, "LearnOpenGL", NULL, NULL);
     if (window == NULL) {
@@ -114,9 +162,20 @@ int main() {
         return -1;
     }
     
+    if (benchmarking)
+        glfwSwapInterval(0); // measure the frames, not the display refresh
+
     stbi_set_flip_vertically_on_load(false);
+    // decides whether color textures are baked to S3TC, before the loader starts baking any
+    TextureBake::DetectFormatSupport();
+    // multi-draw of merged static meshes goes indirect when the driver offers more than the 3.3 core profile
+    StaticGeometryArena::DetectIndirectSupport((GLADloadproc) glfwGetProcAddress);
 
     programState = new ProgramState;
+    programState->depthPrepass = depthPrepass;
+    programState->deferred = deferred;
+    programState->day = !night;
+    programState->streetLamps = std::min(std::max(streetLampCount, 0), 1024);
     if (programState->ImGuiEnabled) {
         glfwSetInputMode(window, GLFW_CURSOR, GLFW_CURSOR_NORMAL);
     }
@@ -135,43 +194,146 @@ int main() {
 
     // configure global opengl state
     // -----------------------------
+    // state that changes during a frame goes through the state cache, which skips calls that change nothing
+    GLStateCache &glState = GLStateCache::Instance();
     glEnable(GL_DEPTH_TEST);
-    glDepthFunc(GL_LESS);
+    glState.DepthFunc(GL_LESS);
 
-    glEnable(GL_CULL_FACE);
-    glCullFace(GL_BACK);
+    glState.SetCulling(true);
+    glState.CullFace(GL_BACK);
 
 
+    float heightScale = 0.01;
+
     // build and compile shaders
     // -------------------------
     Shader skyboxShader("resources/shaders/skybox.vs", "resources/shaders/skybox.fs");
     Shader planeShader("resources/shaders/plane.vs", "resources/shaders/plane.fs");
     Shader houseShader("resources/shaders/house.vs", "resources/shaders/house.fs");
-    Shader decorationShader("resources/shaders/decoration.vs", "resources/shaders/decoration.fs");
+    // the decorations are stored with VertexLayout::Packed, their shaders are built for it
+    Shader decorationShader("resources/shaders/decoration_instanced.vs", "resources/shaders/decoration.fs",
+                            nullptr, {"PACKED_VERTEX"});
+    // cheaper variant for instance lists that are only rotated and uniformly scaled, it skips the normal matrix
+    Shader decorationUniformScaleShader("resources/shaders/decoration_instanced.vs", "resources/shaders/decoration.fs",
+                                        nullptr, {"UNIFORM_SCALE", "PACKED_VERTEX"});
+    // depth-only variant for the prepass of the alpha tested foliage, see RenderQueue::DEPTH_PREPASS
+    Shader decorationDepthShader("resources/shaders/decoration_instanced.vs", "resources/shaders/decoration_depth.fs",
+                                 nullptr, {"DEPTH_ONLY", "PACKED_VERTEX"});
+    // shadow casters for the cascades of the day light and the cube maps of the night lights, the house has no
+    // cutouts and isn't packed
+    Shader shadowCasterShader("resources/shaders/decoration_instanced.vs", "resources/shaders/decoration_depth.fs",
+                              nullptr, {"DEPTH_ONLY", "SHADOW_PASS", "PACKED_VERTEX"});
+    Shader houseShadowCasterShader("resources/shaders/decoration_instanced.vs", "resources/shaders/decoration_depth.fs",
+                                   nullptr, {"DEPTH_ONLY", "SHADOW_PASS", "NO_ALPHA_TEST"});
+    Shader pointShadowCasterShader("resources/shaders/decoration_instanced.vs", "resources/shaders/point_shadow.fs",
+                                   "resources/shaders/point_shadow.gs", {"DEPTH_ONLY", "WORLD_POSITION", "PACKED_VERTEX"});
+    Shader housePointShadowCasterShader("resources/shaders/decoration_instanced.vs", "resources/shaders/point_shadow.fs",
+                                        "resources/shaders/point_shadow.gs", {"DEPTH_ONLY", "WORLD_POSITION", "NO_ALPHA_TEST"});
     Shader pathShader("resources/shaders/plane.vs", "resources/shaders/plane.fs");
+    // far trees are drawn as impostors, baked from the packed tree model once it is loaded
+    Shader impostorBakeShader("resources/shaders/impostor_bake.vs", "resources/shaders/impostor_bake.fs",
+                              nullptr, {"PACKED_VERTEX"});
+    Shader impostorShader("resources/shaders/impostor.vs", "resources/shaders/impostor.fs");
+    // Hi-Z occlusion culling: the house and the ground are drawn into a depth pyramid the instances are tested against
+    Shader occluderShader("resources/shaders/occluder.vs", "resources/shaders/occluder.fs");
+    Shader hizDownsampleShader("resources/shaders/fullscreen.vs", "resources/shaders/hiz_downsample.fs");
+    Shader hizTestShader("resources/shaders/hiz_test.vs", "resources/shaders/hiz_test.fs", nullptr, {}, {"visible"});
+    // deferred shading: every material again with GBUFFER, writing the G-buffer, and the one lighting pass
+    Shader planeGBufferShader("resources/shaders/plane.vs", "resources/shaders/plane.fs", nullptr, {"GBUFFER"});
+    Shader pathGBufferShader("resources/shaders/plane.vs", "resources/shaders/plane.fs", nullptr, {"GBUFFER"});
+    Shader houseGBufferShader("resources/shaders/house.vs", "resources/shaders/house.fs", nullptr, {"GBUFFER"});
+    Shader decorationGBufferShader("resources/shaders/decoration_instanced.vs", "resources/shaders/decoration.fs",
+                                   nullptr, {"PACKED_VERTEX", "GBUFFER"});
+    Shader decorationUniformScaleGBufferShader("resources/shaders/decoration_instanced.vs", "resources/shaders/decoration.fs",
+                                               nullptr, {"UNIFORM_SCALE", "PACKED_VERTEX", "GBUFFER"});
+    Shader impostorGBufferShader("resources/shaders/impostor.vs", "resources/shaders/impostor.fs", nullptr, {"GBUFFER"});
+    Shader deferredLightingShader("resources/shaders/fullscreen.vs", "resources/shaders/deferred_lighting.fs");
+
+    // camera and lights are shared by every shader through one uniform buffer
+    FrameUniformBuffer frameUniformBuffer;
+    skyboxShader.bindUniformBlock("FrameUniforms", FRAME_UNIFORMS_BINDING);
+    planeShader.bindUniformBlock("FrameUniforms", FRAME_UNIFORMS_BINDING);
+    houseShader.bindUniformBlock("FrameUniforms", FRAME_UNIFORMS_BINDING);
+    decorationShader.bindUniformBlock("FrameUniforms", FRAME_UNIFORMS_BINDING);
+    decorationUniformScaleShader.bindUniformBlock("FrameUniforms", FRAME_UNIFORMS_BINDING);
+    decorationDepthShader.bindUniformBlock("FrameUniforms", FRAME_UNIFORMS_BINDING);
+    pathShader.bindUniformBlock("FrameUniforms", FRAME_UNIFORMS_BINDING);
+    impostorShader.bindUniformBlock("FrameUniforms", FRAME_UNIFORMS_BINDING);
+    occluderShader.bindUniformBlock("FrameUniforms", FRAME_UNIFORMS_BINDING);
+    hizTestShader.bindUniformBlock("FrameUniforms", FRAME_UNIFORMS_BINDING);
+    for (Shader *shader : {&planeGBufferShader, &pathGBufferShader, &houseGBufferShader, &decorationGBufferShader,
+                           &decorationUniformScaleGBufferShader, &impostorGBufferShader, &deferredLightingShader})
+        shader->bindUniformBlock("FrameUniforms", FRAME_UNIFORMS_BINDING);
+
+    // everything below is baked or read from its baked file on the loader's worker threads and uploaded once it arrives back
+    // on this thread, see the loading loop after the requests
+    AssetLoader loader;
+
+    unsigned int diffuseMap = 0;
+    loader.LoadTexture(FileSystem::getPath("resources/textures/plane/Grass_005_BaseColor.jpg"), TextureUsage::Color, [&](unsigned int texture) { diffuseMap = texture; });
+    unsigned int normalMap = 0;
+    loader.LoadTexture(FileSystem::getPath("resources/textures/plane/Grass_005_Normal.jpg"), TextureUsage::Normal, [&](unsigned int texture) { normalMap = texture; });
+    unsigned int heightMap = 0;
+    loader.LoadTexture(FileSystem::getPath("resources/textures/plane/Grass_005_Height.png"), TextureUsage::Color, [&](unsigned int texture) { heightMap = texture; });
+    unsigned int specMap = 0;
+    loader.LoadTexture(FileSystem::getPath("resources/textures/plane/Grass_005_AmbientOcclusion.jpg"), TextureUsage::Color, [&](unsigned int texture) { specMap = texture; });
+
+    for (Shader *shader : {&planeShader, &planeGBufferShader}) {
+        shader->use();
+        shader->setInt("diffuseMap", 0);
+        shader->setInt("normalMap", 1);
+        shader->setInt("depthMap", 2);
+        shader->setInt("specMap", 3);
+        shader->setFloat("heightScale", heightScale);
+        shader->setFloat("shininess", 32.0f);
+    }
 
-    unsigned int diffuseMap = loadTexture(FileSystem::getPath("resources/textures/plane/Grass_005_BaseColor.jpg").c_str());
-    unsigned int normalMap  = loadTexture(FileSystem::getPath("resources/textures/plane/Grass_005_Normal.jpg").c_str());
-    unsigned int heightMap  = loadTexture(FileSystem::getPath("resources/textures/plane/Grass_005_Height.png").c_str());
-    unsigned int specMap  = loadTexture(FileSystem::getPath("resources/textures/plane/Grass_005_AmbientOcclusion.jpg").c_str());
 
-    planeShader.use();
-    planeShader.setInt("diffuseMap", 0);
-    planeShader.setInt("normalMap", 1);
-    planeShader.setInt("depthMap", 2);
-    planeShader.setInt("specMap", 3);
+    unsigned int diffuseMap1 = 0;
+    loader.LoadTexture(FileSystem::getPath("resources/textures/stone floor/Stylized_Stone_Floor_005_basecolor.jpg"), TextureUsage::Color, [&](unsigned int texture) { diffuseMap1 = texture; });
+    unsigned int normalMap1 = 0;
+    loader.LoadTexture(FileSystem::getPath("resources/textures/stone floor/Stylized_Stone_Floor_005_normal.jpg"), TextureUsage::Normal, [&](unsigned int texture) { normalMap1 = texture; });
+    unsigned int heightMap1 = 0;
+    loader.LoadTexture(FileSystem::getPath("resources/textures/stone floor/Stylized_Stone_Floor_005_height.png"), TextureUsage::Color, [&](unsigned int texture) { heightMap1 = texture; });
+    unsigned int specMap1 = 0;
+    loader.LoadTexture(FileSystem::getPath("resources/textures/stone floor/Stylized_Stone_Floor_005_ambientOcclusion.jpg"), TextureUsage::Color, [&](unsigned int texture) { specMap1 = texture; });
+
+    for (Shader *shader : {&pathShader, &pathGBufferShader}) {
+        shader->use();
+        shader->setInt("diffuseMap", 4);
+        shader->setInt("normalMap", 5);
+        shader->setInt("depthMap", 6);
+        shader->setInt("specMap", 7);
+        shader->setFloat("heightScale", heightScale);
+        shader->setFloat("shininess", 256.0f);
+    }
 
+    for (Shader *shader : {&houseShader, &houseGBufferShader, &decorationShader, &decorationUniformScaleShader,
+                           &decorationGBufferShader, &decorationUniformScaleGBufferShader}) {
+        shader->use();
+        shader->setFloat("material.shininess", 32.0f);
+    }
 
-    unsigned int diffuseMap1 = loadTexture(FileSystem::getPath("resources/textures/stone floor/Stylized_Stone_Floor_005_basecolor.jpg").c_str());
-    unsigned int normalMap1  = loadTexture(FileSystem::getPath("resources/textures/stone floor/Stylized_Stone_Floor_005_normal.jpg").c_str());
-    unsigned int heightMap1  = loadTexture(FileSystem::getPath("resources/textures/stone floor/Stylized_Stone_Floor_005_height.png").c_str());
-    unsigned int specMap1  = loadTexture(FileSystem::getPath("resources/textures/stone floor/Stylized_Stone_Floor_005_ambientOcclusion.jpg").c_str());
+    // the lit shaders read the cascaded shadow map of the day light and the cube maps of the point lights
+    for (Shader *shader : {&planeShader, &pathShader, &houseShader, &decorationShader, &decorationUniformScaleShader,
+                           &impostorShader, &deferredLightingShader}) {
+        shader->bindUniformBlock("ShadowUniforms", SHADOW_UNIFORMS_BINDING);
+        shader->use();
+        shader->setInt("shadowMap", SHADOW_MAP_UNIT);
+        for (unsigned int i = 0; i < NR_POINT_LIGHTS; i++)
+            shader->setInt("pointShadowMaps[" + std::to_string(i) + "]", POINT_SHADOW_UNIT + i);
+        shader->setFloat("pointShadowFar", PointShadowMaps::FAR);
+        shader->bindUniformBlock("ClusterUniforms", CLUSTER_UNIFORMS_BINDING);
+        shader->setInt("clusterLights", CLUSTER_LIGHTS_UNIT);
+        shader->setInt("clusterRanges", CLUSTER_LIGHTS_UNIT + 1);
+        shader->setInt("clusterIndices", CLUSTER_LIGHTS_UNIT + 2);
+    }
 
-    pathShader.use();
-    pathShader.setInt("diffuseMap", 4);
-    pathShader.setInt("normalMap", 5);
-    pathShader.setInt("depthMap", 6);
-    pathShader.setInt("specMap", 7);
+    // uniforms set inside the render loop are resolved once up front
+    UniformHandle planeModel = planeShader.getUniform("model");
+    UniformHandle pathModel = pathShader.getUniform("model");
+    UniformHandle planeGBufferModel = planeGBufferShader.getUniform("model");
+    UniformHandle pathGBufferModel = pathGBufferShader.getUniform("model");
 
     vector<std::string> faces
             {
@@ -193,31 +355,58 @@ int main() {
                     FileSystem::getPath("resources/textures/kurt/space_lf.png")
             };
 
-
-
-    unsigned int cubemapTexture = loadCubemap(faces);
-    unsigned int cubemapTexture1 = loadCubemap(faces1);
+    unsigned int cubemapTexture = 0;
+    unsigned int cubemapTexture1 = 0;
+    loader.LoadCubemap(faces, [&](unsigned int texture) { cubemapTexture = texture; });
+    loader.LoadCubemap(faces1, [&](unsigned int texture) { cubemapTexture1 = texture; });
 
     skyboxShader.use();
     skyboxShader.setInt("skybox", 0);
 
     // load models
+    std::unique_ptr<Model> house, tree_1, phormium1, phormium2, lightPole;
+    auto loadModel = [&](const std::string &path, std::unique_ptr<Model> &model, VertexLayout layout) {
+        loader.LoadModel(path, [&model, layout](ModelData &data) {
+            model.reset(new Model(data, false, layout));
+            model->SetShaderTextureNamePrefix("material.");
+        });
+    };
+    // the house shader reads the full tangent frame, the decoration shader is compiled for packed vertices
+    loadModel("resources/objects/Big_Old_House/Big_Old_House.obj", house, VertexLayout::Full);
+    loadModel("resources/objects/Tree 02/Tree.obj", tree_1, VertexLayout::Packed);
+    loadModel("resources/objects/Phormium_OBJ/Phormium_1.obj", phormium1, VertexLayout::Packed);
+    loadModel("resources/objects/Phormium_OBJ/Phormium_3.obj", phormium2, VertexLayout::Packed);
+    loadModel("resources/objects/Light Pole/Light Pole.obj", lightPole, VertexLayout::Packed);
+
+    // keep presenting frames while the workers decode, uploading whatever is ready in between
+    while (!loader.Done() && !glfwWindowShouldClose(window)) {
+        loader.ProcessUploads();
+
+        glClearColor(0.3, 0.3, 0.3, 1.0f);
+        glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
+        DrawLoadingScreen(loader.Completed(), loader.Requested());
 
-    Model house("resources/objects/Big_Old_House/Big_Old_House.obj");
-    house.SetShaderTextureNamePrefix("material.");
-
-    Model tree_1("resources/objects/Tree 02/Tree.obj");
-    tree_1.SetShaderTextureNamePrefix("material.");
-
-    Model phormium1("resources/objects/Phormium_OBJ/Phormium_1.obj");
-    phormium1.SetShaderTextureNamePrefix("material.");
-
-    Model phormium2("resources/objects/Phormium_OBJ/Phormium_3.obj");
-    phormium2.SetShaderTextureNamePrefix("material.");
-
+        glfwSwapBuffers(window);
+        glfwPollEvents();
+    }
+    // the uploads bound textures and buffers behind the state cache's back
+    glState.Invalidate();
+    if (!loader.Done()) {
+        // the window was closed while loading
+        delete programState;
+        ImGui_ImplOpenGL3_Shutdown();
+        ImGui_ImplGlfw_Shutdown();
+        ImGui::DestroyContext();
+        glfwTerminate();
+        return 0;
+    }
 
-    Model lightPole("resources/objects/Light Pole/Light Pole.obj");
-    lightPole.SetShaderTextureNamePrefix("material.");
+    std::unique_ptr<Impostor> treeImpostor(new Impostor(*tree_1, impostorBakeShader));
+    // half the window resolution keeps the occluder pass cheap; objects peeking out by less than a texel (two
+    // pixels) can be culled
+    std::unique_ptr<OcclusionCuller> occlusion(new OcclusionCuller(SCR_WIDTH / 2, SCR_HEIGHT / 2, hizDownsampleShader, hizTestShader));
+    UniformHandle occluderModel = occluderShader.getUniform("model");
+    vector<BoundingSphere> occlusionSpheres;
 
     float skyboxVertices[] = {
             // positions
@@ -267,7 +456,7 @@ int main() {
     unsigned int skyboxVAO, skyboxVBO;
     glGenVertexArrays(1, &skyboxVAO);
     glGenBuffers(1, &skyboxVBO);
-    glBindVertexArray(skyboxVAO);
+    glState.BindVertexArray(skyboxVAO);
     glBindBuffer(GL_ARRAY_BUFFER, skyboxVBO);
     glBufferData(GL_ARRAY_BUFFER, sizeof(skyboxVertices), &skyboxVertices, GL_STATIC_DRAW);
     glEnableVertexAttribArray(0);
@@ -284,6 +473,22 @@ int main() {
     glm::vec3 pointLightPositions[] = { glm::vec3(-0.15, 0.19, 0.5),
                                       glm::vec3(0.15, 0.19, 0.5)};
 
+    // small warm lamps scattered over the grass at night, to see the clustered lighting scale with the light count
+    const int MAX_STREET_LAMPS = 1024;
+    vector<PointLightStd140> streetLamps(MAX_STREET_LAMPS);
+    std::mt19937 lampRandom(7);
+    std::uniform_real_distribution<float> lampPosition(-4.8f, 4.8f), lampTint(0.0f, 1.0f);
+    for (PointLightStd140 &lamp : streetLamps) {
+        lamp.position = glm::vec3(lampPosition(lampRandom), 0.05f, lampPosition(lampRandom));
+        lamp.diffuse = glm::vec3(0.6f, 0.4f + 0.2f * lampTint(lampRandom), 0.2f);
+        lamp.ambient = glm::vec3(0.0f);
+        lamp.specular = lamp.diffuse * 0.5f;
+        lamp.constant = 1.0f;
+        lamp.linear = 0.0f;
+        lamp.quadratic = 300.0f;
+        lamp.radius = LightClusters::Range(lamp);
+    }
+
     programState->pointLight.ambient = glm::vec3(0.1, 0.1, 0.1);
     programState->pointLight.diffuse = glm::vec3(0.5, 0.5, 0.5);
     programState->pointLight.specular = glm::vec3(0.2, 0.2, 0.2);
@@ -293,7 +498,6 @@ int main() {
     programState->pointLight.quadratic = 0.032f;
 
     programState->camera.Position = glm::vec3(1.0, 1.0, 1.0);
-    float heightScale = 0.01;
     vector<glm::vec3> tree1_positions;
     vector<glm::vec3> tree2_positions;
 
@@ -325,290 +529,333 @@ int main() {
         phormium2_pos.push_back(glm::vec3(-0.2, 0.0, ph_pos+i));
     }
 
-    unsigned int planeVAO = 0;
-    unsigned int planeVBO = 0;
+    // the vegetation and the light poles never move, so their model matrices are built once
+    // and every model is then drawn with one instanced call per mesh
+    vector<glm::mat4> phormium1_models;
+    for(unsigned int i = 0; i < phormium1_pos.size(); i++) {
+        glm::mat4 model = glm::mat4(1.0f);
+        model = glm::translate(model, phormium1_pos[i]);
+        model = glm::scale(model, glm::vec3(0.01f));    // it's a bit too big for our scene, so scale it down
+        phormium1_models.push_back(model);
+    }
+
+    vector<glm::mat4> phormium2_models;
+    for(unsigned int i = 0; i < phormium2_pos.size(); i++) {
+        glm::mat4 model = glm::mat4(1.0f);
+        model = glm::translate(model, phormium2_pos[i]);
+        model = glm::scale(model, glm::vec3(0.01f));    // it's a bit too big for our scene, so scale it down
+        phormium2_models.push_back(model);
+    }
+
+    vector<glm::mat4> tree1_models;
+    for(unsigned int i = 0; i < tree1_positions.size(); i++) {
+        glm::mat4 model = glm::mat4(1.0f);
+        model = glm::translate(model, tree1_positions[i]);
+        model = glm::scale(model, glm::vec3(0.1f));    // it's a bit too big for our scene, so scale it down
+        tree1_models.push_back(model);
+    }
 
-    unsigned int pathVAO = 0;
-    unsigned int pathVBO = 0;
+    vector<glm::mat4> lightPole_models;
+    {
+        glm::mat4 model = glm::mat4(1.0f);
+        model = glm::translate(model, glm::vec3(0.3, 0.2, 0.5));
+        model = glm::rotate(model, glm::radians(90.0f), glm::vec3(0.0, 1.0, 0.0));
+        model = glm::scale(model, glm::vec3(0.02f));    // it's a bit too big for our scene, so scale it down
+        lightPole_models.push_back(model);
+
+        model = glm::mat4(1.0f);
+        model = glm::translate(model, glm::vec3(-0.3, 0.2, 0.5));
+        model = glm::rotate(model, glm::radians(-90.0f), glm::vec3(0.0, 1.0, 0.0));
+        model = glm::scale(model, glm::vec3(0.02f));
+        lightPole_models.push_back(model);
+    }
+
+    // bounding spheres of every instance in world space, culled against the view frustum each frame
+    InstanceList phormium1_instances(phormium1_models, phormium1->sphere);
+    InstanceList phormium2_instances(phormium2_models, phormium2->sphere);
+    InstanceList tree1_instances(tree1_models, tree_1->sphere);
+    InstanceList lightPole_instances(lightPole_models, lightPole->sphere);
+
+    // the house and the decorations cast shadows, the ground only receives them. The light poles hold the point
+    // lights, their lamps would shadow everything around them, so they only cast day shadows
+    const glm::mat4 houseTransform = glm::scale(glm::mat4(1.0f), glm::vec3(0.1f));    // it's a bit too big for our scene, so scale it down
+    std::unique_ptr<ShadowCasters> shadowCasters(new ShadowCasters());
+    vector<InstanceData> houseInstance;
+    BuildInstanceData({houseTransform}, houseInstance);
+    shadowCasters->Add(*house, houseInstance, houseShadowCasterShader, &housePointShadowCasterShader);
+    shadowCasters->Add(*phormium1, phormium1_instances.Instances(), shadowCasterShader, &pointShadowCasterShader);
+    shadowCasters->Add(*phormium2, phormium2_instances.Instances(), shadowCasterShader, &pointShadowCasterShader);
+    shadowCasters->Add(*tree_1, tree1_instances.Instances(), shadowCasterShader, &pointShadowCasterShader);
+    shadowCasters->Add(*lightPole, lightPole_instances.Instances(), shadowCasterShader, nullptr);
+    std::unique_ptr<CascadedShadowMap> shadows(new CascadedShadowMap(*shadowCasters, 2048));
+    std::unique_ptr<PointShadowMaps> pointShadows(new PointShadowMaps(*shadowCasters, 512));
+    std::unique_ptr<LightClusters> lightClusters(new LightClusters(loader.Pool()));
+    vector<PointLightStd140> clusteredLights;
+    std::unique_ptr<DeferredRenderer> deferredRenderer(new DeferredRenderer(SCR_WIDTH, SCR_HEIGHT, deferredLightingShader));
+
+    // grass plane and the stone path leading to the house, both lying in the xy plane before the model rotation
+    GroundQuad plane(glm::vec2(-5.0f, -5.0f), glm::vec2(5.0f, 5.0f), glm::vec2(50.0f, 50.0f));
+    GroundQuad path(glm::vec2(-0.1f, -5.0f), glm::vec2(0.1f, 0.1f), glm::vec2(2.0f, 40.0f), 0.001f);
+
+    // benchmark mode renders offscreen at a fixed size with a fixed timestep, flying one loop along the path
+    // down to the house and around it
+    std::unique_ptr<Benchmark> benchmark;
+    std::unique_ptr<OffscreenTarget> benchmarkTarget;
+    CameraPath benchmarkPath({
+            {glm::vec3( 0.0f, 0.3f,  4.5f), glm::vec3(0.0f, 0.2f, 0.0f)},
+            {glm::vec3( 0.0f, 0.4f,  2.0f), glm::vec3(0.0f, 0.2f, 0.0f)},
+            {glm::vec3( 1.5f, 0.8f,  1.5f), glm::vec3(0.0f, 0.3f, 0.0f)},
+            {glm::vec3( 2.0f, 1.0f, -1.0f), glm::vec3(0.0f, 0.3f, 0.0f)},
+            {glm::vec3( 0.0f, 1.2f, -2.5f), glm::vec3(0.0f, 0.3f, 0.0f)},
+            {glm::vec3(-2.0f, 1.0f, -1.0f), glm::vec3(0.0f, 0.3f, 0.0f)},
+            {glm::vec3(-1.5f, 0.8f,  1.5f), glm::vec3(0.0f, 0.3f, 0.0f)},
+            {glm::vec3(-3.0f, 2.0f,  4.0f), glm::vec3(0.0f, 0.0f, 0.0f)}
+    });
+    if (benchmarking) {
+        benchmark.reset(new Benchmark(benchmarkReport, benchmarkFrames, 1.0f / 60.0f));
+        benchmarkTarget.reset(new OffscreenTarget(SCR_WIDTH, SCR_HEIGHT));
+        glBindFramebuffer(GL_FRAMEBUFFER, benchmarkTarget->FBO);
+        glViewport(0, 0, SCR_WIDTH, SCR_HEIGHT);
+    }
 
-    while (!glfwWindowShouldClose(window)) {
+    RenderQueue renderQueue;
+    while (!glfwWindowShouldClose(window) && !(benchmark && benchmark->Finished())) {
         // per-frame time logic
         // --------------------
         float currentFrame = glfwGetTime();
         deltaTime = currentFrame - lastFrame;
         lastFrame = currentFrame;
-
-        processInput(window);
+        RenderStats::Frame().Reset();
+        glState.ResetCounters();
+
+        if (benchmark) {
+            benchmark->BeginFrame();
+            deltaTime = benchmark->Timestep();
+            glm::vec3 position, target;
+            benchmarkPath.Sample(benchmark->Progress(), position, target);
+            programState->camera.Position = position;
+            programState->camera.LookAt(target);
+        } else {
+            processInput(window);
+        }
 
         glClearColor(0.3,0.3,0.3, 1.0f);
         glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
 
-
-        //house
-        houseShader.use();
-        houseShader.setBool("dan", programState->day);
-        houseShader.setVec3("dirLight.direction", programState->dirLight.direction);
-        houseShader.setVec3("dirLight.ambient", programState->dirLight.ambient);
-        houseShader.setVec3("dirLight.diffuse", programState->dirLight.diffuse);
-        houseShader.setVec3("dirLight.specular", programState->dirLight.specular);
-        houseShader.setVec3("pointLights[0].position", pointLightPositions[0]);
-        houseShader.setVec3("pointLights[0].ambient", programState->pointLight.ambient);
-        houseShader.setVec3("pointLights[0].diffuse", programState->pointLight.diffuse);
-        houseShader.setVec3("pointLights[0].specular", programState->pointLight.specular);
-        houseShader.setFloat("pointLights[0].constant", programState->pointLight.constant);
-        houseShader.setFloat("pointLights[0].linear", programState->pointLight.linear);
-        houseShader.setFloat("pointLights[0].quadratic", programState->pointLight.quadratic);
-        houseShader.setVec3("pointLights[1].position", pointLightPositions[1]);
-        houseShader.setVec3("pointLights[1].ambient", programState->pointLight.ambient);
-        houseShader.setVec3("pointLights[1].diffuse", programState->pointLight.diffuse);
-        houseShader.setVec3("pointLights[1].specular", programState->pointLight.specular);
-        houseShader.setFloat("pointLights[1].constant", programState->pointLight.constant);
-        houseShader.setFloat("pointLights[1].linear", programState->pointLight.linear);
-        houseShader.setFloat("pointLights[1].quadratic", programState->pointLight.quadratic);
-
-        houseShader.setVec3("viewPos", programState->camera.Position);
-        houseShader.setFloat("material.shininess", 32.0f);
+        // camera and lights for the whole frame
+        const float farPlane = 100.0f;
         glm::mat4 projection = glm::perspective(glm::radians(programState->camera.Zoom),
-                                                (float) SCR_WIDTH / (float) SCR_HEIGHT, 0.1f, 100.0f);
+                                                (float) SCR_WIDTH / (float) SCR_HEIGHT, 0.1f, farPlane);
         glm::mat4 view = programState->camera.GetViewMatrix();
-        houseShader.setMat4("projection", projection);
-        houseShader.setMat4("view", view);
-
-        glm::mat4 model = glm::mat4(1.0f);
-        model = glm::scale(model, glm::vec3(0.1f));    // it's a bit too big for our scene, so scale it down
-        houseShader.setMat4("model", model);
-        house.Draw(houseShader);
-
-
-
-
-        decorationShader.use();
-        decorationShader.setBool("dan", programState->day);
-        decorationShader.setVec3("dirLight.direction", programState->dirLight.direction);
-        decorationShader.setVec3("dirLight.ambient", programState->dirLight.ambient);
-        decorationShader.setVec3("dirLight.diffuse", programState->dirLight.diffuse);
-        decorationShader.setVec3("dirLight.specular", programState->dirLight.specular);
-        decorationShader.setVec3("pointLights[0].position", pointLightPositions[0]);
-        decorationShader.setVec3("pointLights[0].ambient", programState->pointLight.ambient);
-        decorationShader.setVec3("pointLights[0].diffuse", programState->pointLight.diffuse);
-        decorationShader.setVec3("pointLights[0].specular", programState->pointLight.specular);
-        decorationShader.setFloat("pointLights[0].constant", programState->pointLight.constant);
-        decorationShader.setFloat("pointLights[0].linear", programState->pointLight.linear);
-        decorationShader.setFloat("pointLights[0].quadratic", programState->pointLight.quadratic);
-        decorationShader.setVec3("pointLights[1].position", pointLightPositions[1]);
-        decorationShader.setVec3("pointLights[1].ambient", programState->pointLight.ambient);
-        decorationShader.setVec3("pointLights[1].diffuse", programState->pointLight.diffuse);
-        decorationShader.setVec3("pointLights[1].specular", programState->pointLight.specular);
-        decorationShader.setFloat("pointLights[1].constant", programState->pointLight.constant);
-        decorationShader.setFloat("pointLights[1].linear", programState->pointLight.linear);
-        decorationShader.setFloat("pointLights[1].quadratic", programState->pointLight.quadratic);
-        decorationShader.setVec3("viewPosition", programState->camera.Position);
-        decorationShader.setFloat("material.shininess", 32.0f);
-
-        //phormium1
-        projection = glm::perspective(glm::radians(programState->camera.Zoom),
-                                      (float) SCR_WIDTH / (float) SCR_HEIGHT, 0.1f, 100.0f);
-        view = programState->camera.GetViewMatrix();
-        decorationShader.setMat4("projection", projection);
-        decorationShader.setMat4("view", view);
-        for(int i = 0; i < phormium1_pos.size(); i++) {
-            model = glm::mat4(1.0f);
-            model = glm::translate(model, phormium1_pos[i]);
-            model = glm::scale(model, glm::vec3(0.01f));    // it's a bit too big for our scene, so scale it down
-            decorationShader.setMat4("model", model);
-            phormium1.Draw(decorationShader);
+        Frustum frustum = programState->camera.GetFrustum(projection);
+        programState->culling.Reset();
+        programState->lods.Reset();
+
+        FrameUniforms frame;
+        frame.projection = projection;
+        frame.view = view;
+        frame.viewPos = programState->camera.Position;
+        frame.day = programState->day;
+        frame.dirLight.direction = programState->dirLight.direction;
+        frame.dirLight.ambient = programState->dirLight.ambient;
+        frame.dirLight.diffuse = programState->dirLight.diffuse;
+        frame.dirLight.specular = programState->dirLight.specular;
+        for(unsigned int i = 0; i < NR_POINT_LIGHTS; i++) {
+            frame.pointLights[i].position = pointLightPositions[i];
+            frame.pointLights[i].ambient = programState->pointLight.ambient;
+            frame.pointLights[i].diffuse = programState->pointLight.diffuse;
+            frame.pointLights[i].specular = programState->pointLight.specular;
+            frame.pointLights[i].constant = programState->pointLight.constant;
+            frame.pointLights[i].linear = programState->pointLight.linear;
+            frame.pointLights[i].quadratic = programState->pointLight.quadratic;
         }
-
-        //phormium2
-        projection = glm::perspective(glm::radians(programState->camera.Zoom),
-                                      (float) SCR_WIDTH / (float) SCR_HEIGHT, 0.1f, 100.0f);
-        view = programState->camera.GetViewMatrix();
-        decorationShader.setMat4("projection", projection);
-        decorationShader.setMat4("view", view);
-
-        for(int i = 0; i < phormium2_pos.size(); i++) {
-            model = glm::mat4(1.0f);
-            model = glm::translate(model, phormium2_pos[i]);
-            model = glm::scale(model, glm::vec3(0.01f));    // it's a bit too big for our scene, so scale it down
-            decorationShader.setMat4("model", model);
-            phormium2.Draw(decorationShader);
+        frameUniformBuffer.Update(frame);
+
+        // shadow cascades of the day light, the cached ones are reused while the camera and the light stand still
+        shadows->shadowDistance = programState->shadowDistance;
+        if (programState->day)
+            shadows->Update(programState->camera, (float) SCR_WIDTH / (float) SCR_HEIGHT, 0.1f, programState->dirLight.direction);
+        shadows->BindTexture();
+        for (unsigned int i = 0; i < NR_CASCADES; i++)
+            programState->shadowCascades[i] = shadows->Stats(i);
+        // the point light cubes are only rendered when a light or a caster moved
+        if (!programState->day)
+            pointShadows->Update(pointLightPositions);
+        pointShadows->BindTextures();
+        programState->pointShadowsRendered = programState->day ? 0 : pointShadows->Rendered();
+
+        // the night lights go through the cluster grid, the shadowed lamps first
+        if (!programState->day) {
+            clusteredLights.assign(frame.pointLights, frame.pointLights + NR_POINT_LIGHTS);
+            for (PointLightStd140 &light : clusteredLights)
+                light.radius = LightClusters::Range(light);
+            clusteredLights.insert(clusteredLights.end(), streetLamps.begin(), streetLamps.begin() + programState->streetLamps);
+            lightClusters->Update(clusteredLights, view, projection, 0.1f, farPlane);
+            programState->clusters = lightClusters->LastStats();
         }
-
-        //tree2
-        projection = glm::perspective(glm::radians(programState->camera.Zoom),
-                                      (float) SCR_WIDTH / (float) SCR_HEIGHT, 0.1f, 100.0f);
-        view = programState->camera.GetViewMatrix();
-        decorationShader.setMat4("projection", projection);
-        decorationShader.setMat4("view", view);
-        for(int i = 0; i < tree1_positions.size(); i++) {
-            model = glm::mat4(1.0f);
-            model = glm::translate(model, tree1_positions[i]);
-            model = glm::scale(model, glm::vec3(0.1f));    // it's a bit too big for our scene, so scale it down
-            decorationShader.setMat4("model", model);
-            tree_1.Draw(decorationShader);
+        lightClusters->BindTextures();
+
+        glm::mat4 model = houseTransform;
+        glm::mat4 groundModel = glm::rotate(glm::mat4(1.0f), glm::radians(-90.0f), glm::vec3(1.0, 0.0, 0.0));
+        bool houseVisible = frustum.Intersects(house->bounds.Transformed(model));
+        programState->culling.Count(houseVisible, 1);
+
+        // frustum culling, then the instances left are tested against the house and the ground all at once
+        InstanceList *decorations[] = {&phormium1_instances, &phormium2_instances, &tree1_instances, &lightPole_instances};
+        for (InstanceList *instances : decorations)
+            instances->Cull(frustum, programState->culling);
+        if (programState->occlusionCulling) {
+            occlusion->BeginOccluders();
+            occluderShader.use();
+            if (houseVisible) {
+                occluderShader.setMat4(occluderModel, model);
+                house->Draw(occluderShader);
+            }
+            occluderShader.setMat4(occluderModel, groundModel);
+            plane.Draw();
+            occlusion->EndOccluders();
+
+            unsigned int first[4];
+            for (unsigned int i = 0; i < 4; i++) {
+                occlusionSpheres.clear();
+                decorations[i]->VisibleSpheres(occlusionSpheres);
+                first[i] = occlusion->Queue(occlusionSpheres);
+            }
+            occlusion->Run();
+            for (unsigned int i = 0; i < 4; i++)
+                decorations[i]->RemoveOccluded([&](unsigned int j) { return !occlusion->Visible(first[i] + j); }, programState->culling);
         }
 
+        // the draws are queued and run sorted by shader, material and distance. Shaders run in the order they are
+        // first submitted: the ground goes last since nearly everything else stands in front of it
+        renderQueue.Begin(programState->camera.Position, farPlane);
 
-        //Light Pole
-        projection = glm::perspective(glm::radians(programState->camera.Zoom),
-                                      (float) SCR_WIDTH / (float) SCR_HEIGHT, 0.1f, 100.0f);
-        view = programState->camera.GetViewMatrix();
-        decorationShader.setMat4("projection", projection);
-        decorationShader.setMat4("view", view);
+        // deferred shading draws every material with its GBUFFER variant and lights the result in LIGHTING_PASS
+        bool deferred = programState->deferred;
+        Shader &houseMaterial = deferred ? houseGBufferShader : houseShader;
+        Shader &decorationMaterial = deferred ? decorationGBufferShader : decorationShader;
+        Shader &decorationUniformScaleMaterial = deferred ? decorationUniformScaleGBufferShader : decorationUniformScaleShader;
+        Shader &impostorMaterial = deferred ? impostorGBufferShader : impostorShader;
+        Shader &planeMaterial = deferred ? planeGBufferShader : planeShader;
+        Shader &pathMaterial = deferred ? pathGBufferShader : pathShader;
 
-        // render the loaded model
-        model = glm::mat4(1.0f);
-        model = glm::translate(model, glm::vec3(0.3, 0.2, 0.5));
-        model = glm::rotate(model, glm::radians(90.0f), glm::vec3(0.0, 1.0, 0.0));
-        model = glm::scale(model, glm::vec3(0.02f));    // it's a bit too big for our scene, so scale it down
-        decorationShader.setMat4("model", model);
-        lightPole.Draw(decorationShader);
+        //house
+        if (houseVisible)
+            house->Submit(renderQueue, houseMaterial, model);
 
-        //light pole2
-        projection = glm::perspective(glm::radians(programState->camera.Zoom),
-                                      (float) SCR_WIDTH / (float) SCR_HEIGHT, 0.1f, 100.0f);
-        view = programState->camera.GetViewMatrix();
-        decorationShader.setMat4("projection", projection);
-        decorationShader.setMat4("view", view);
+        // every instance list is drawn with the cheapest shader variant that is still correct for it, and every
+        // visible instance at the level of detail its size on screen calls for
+        auto coverage = [&](const BoundingSphere &sphere) {
+            return programState->camera.ScreenCoverage(sphere, projection);
+        };
+        // with the depth prepass the overlapping leaves are shaded once per pixel instead of once per layer
+        Shader *depthShader = programState->depthPrepass ? &decorationDepthShader : nullptr;
+        auto submitDecoration = [&](Model &decoration, InstanceList &instances, Impostor *impostor = nullptr) {
+            Shader &shader = instances.UniformScale() ? decorationUniformScaleMaterial : decorationMaterial;
+            instances.SelectLods(programState->lodSelector, decoration.LodCount(), coverage, programState->lods, impostor != nullptr);
+            for (unsigned int lod = 0; lod < decoration.LodCount(); lod++)
+                decoration.SubmitInstanced(renderQueue, shader, instances.LodInstances(lod), lod, depthShader);
+
+            const vector<InstanceData> &far = instances.LodInstances(IMPOSTOR_LOD);
+            if (impostor && !far.empty()) {
+                float distance = farPlane;
+                for (const InstanceData &instance : far)
+                    distance = std::min(distance, renderQueue.Distance(glm::vec3(instance.model[3])));
+                const vector<InstanceData> *farInstances = &far;
+                renderQueue.Submit(RenderQueue::OPAQUE_PASS, impostorMaterial, impostor->AlbedoAtlas(), distance, [&impostorMaterial, impostor, farInstances]() {
+                    impostor->Draw(impostorMaterial, *farInstances);
+                });
+            }
+        };
 
-        model = glm::mat4(1.0f);
-        model = glm::translate(model, glm::vec3(-0.3, 0.2, 0.5));
-        model = glm::rotate(model, glm::radians(-90.0f), glm::vec3(0.0, 1.0, 0.0));
-        model = glm::scale(model, glm::vec3(0.02f));    // it's a bit too big for our scene, so scale it down
-        decorationShader.setMat4("model", model);
-        lightPole.Draw(decorationShader);
-        
+        //phormium1
+        submitDecoration(*phormium1, phormium1_instances);
 
+        //phormium2
+        submitDecoration(*phormium2, phormium2_instances);
 
+        //tree2
+        submitDecoration(*tree_1, tree1_instances, treeImpostor.get());
 
-        //plane
+        //Light Pole
+        submitDecoration(*lightPole, lightPole_instances);
 
-        planeShader.use();
-        projection = glm::perspective(glm::radians(programState->camera.Zoom),
-                                      (float) SCR_WIDTH / (float) SCR_HEIGHT, 0.1f, 100.0f);
-        view = programState->camera.GetViewMatrix();
-        model = glm::mat4(1.0f);
-        model = glm::rotate(model, glm::radians(-90.0f), glm::vec3(1.0, 0.0, 0.0));
-
-        planeShader.setMat4("projection", projection);
-        planeShader.setMat4("view", view);
-        planeShader.setMat4("model", model);
-        planeShader.setVec3("viewPos", programState->camera.Position);
-
-        //
-        planeShader.setBool("dan", programState->day);
-        planeShader.setVec3("dirLight.direction", programState->dirLight.direction);
-        planeShader.setVec3("dirLight.ambient", programState->dirLight.ambient);
-        planeShader.setVec3("dirLight.diffuse", programState->dirLight.diffuse);
-        planeShader.setVec3("dirLight.specular", programState->dirLight.specular);
-        planeShader.setVec3("pointLights[0].position", pointLightPositions[0]);
-        planeShader.setVec3("pointLights[0].ambient", programState->pointLight.ambient);
-        planeShader.setVec3("pointLights[0].diffuse", programState->pointLight.diffuse);
-        planeShader.setVec3("pointLights[0].specular", programState->pointLight.specular);
-        planeShader.setFloat("pointLights[0].constant", programState->pointLight.constant);
-        planeShader.setFloat("pointLights[0].linear", programState->pointLight.linear);
-        planeShader.setFloat("pointLights[0].quadratic", programState->pointLight.quadratic);
-        planeShader.setVec3("pointLights[1].position", pointLightPositions[1]);
-        planeShader.setVec3("pointLights[1].ambient", programState->pointLight.ambient);
-        planeShader.setVec3("pointLights[1].diffuse", programState->pointLight.diffuse);
-        planeShader.setVec3("pointLights[1].specular", programState->pointLight.specular);
-        planeShader.setFloat("pointLights[1].constant", programState->pointLight.constant);
-        planeShader.setFloat("pointLights[1].linear", programState->pointLight.linear);
-        planeShader.setFloat("pointLights[1].quadratic", programState->pointLight.quadratic);
-
-
-
-
-        //planeShader.setVec3("lightPos", pointLightPositions[1]);
-        planeShader.setFloat("heightScale", heightScale);
-        planeShader.setFloat("shininess", 32.0f);
-
-        glActiveTexture(GL_TEXTURE0);
-        glBindTexture(GL_TEXTURE_2D, diffuseMap);
-        glActiveTexture(GL_TEXTURE1);
-        glBindTexture(GL_TEXTURE_2D, normalMap);
-        glActiveTexture(GL_TEXTURE2);
-        glBindTexture(GL_TEXTURE_2D, heightMap);
-        glActiveTexture(GL_TEXTURE3);
-        glBindTexture(GL_TEXTURE_2D, specMap);
-
-        renderPlane(planeVAO, planeVBO);
+        //plane
+        renderQueue.Submit(RenderQueue::OPAQUE_PASS, planeMaterial, diffuseMap, 0.0f, [&]() {
+            planeMaterial.setMat4(deferred ? planeGBufferModel : planeModel, groundModel);
+            glState.BindTexture(0, GL_TEXTURE_2D, diffuseMap);
+            glState.BindTexture(1, GL_TEXTURE_2D, normalMap);
+            glState.BindTexture(2, GL_TEXTURE_2D, heightMap);
+            glState.BindTexture(3, GL_TEXTURE_2D, specMap);
+            plane.Draw();
+        });
 
         //path
-        pathShader.use();
-
-
-        pathShader.setBool("dan", programState->day);
-        pathShader.setVec3("dirLight.direction", programState->dirLight.direction);
-        pathShader.setVec3("dirLight.ambient", programState->dirLight.ambient);
-        pathShader.setVec3("dirLight.diffuse", programState->dirLight.diffuse);
-        pathShader.setVec3("dirLight.specular", programState->dirLight.specular);
-        pathShader.setVec3("pointLights[0].position", pointLightPositions[0]);
-        pathShader.setVec3("pointLights[0].ambient", programState->pointLight.ambient);
-        pathShader.setVec3("pointLights[0].diffuse", programState->pointLight.diffuse);
-        pathShader.setVec3("pointLights[0].specular", programState->pointLight.specular);
-        pathShader.setFloat("pointLights[0].constant", programState->pointLight.constant);
-        pathShader.setFloat("pointLights[0].linear", programState->pointLight.linear);
-        pathShader.setFloat("pointLights[0].quadratic", programState->pointLight.quadratic);
-        pathShader.setVec3("pointLights[1].position", pointLightPositions[1]);
-        pathShader.setVec3("pointLights[1].ambient", programState->pointLight.ambient);
-        pathShader.setVec3("pointLights[1].diffuse", programState->pointLight.diffuse);
-        pathShader.setVec3("pointLights[1].specular", programState->pointLight.specular);
-        pathShader.setFloat("pointLights[1].constant", programState->pointLight.constant);
-        pathShader.setFloat("pointLights[1].linear", programState->pointLight.linear);
-        pathShader.setFloat("pointLights[1].quadratic", programState->pointLight.quadratic);
-        pathShader.setFloat("heightScale", heightScale);
-        pathShader.setFloat("shininess", 256.0f);
-
-        projection = glm::perspective(glm::radians(programState->camera.Zoom),
-                                      (float) SCR_WIDTH / (float) SCR_HEIGHT, 0.1f, 100.0f);
-        view = programState->camera.GetViewMatrix();
-        model = glm::mat4(1.0f);
-        model = glm::rotate(model, glm::radians(-90.0f), glm::vec3(1.0, 0.0, 0.0));
-
-        pathShader.setMat4("projection", projection);
-        pathShader.setMat4("view", view);
-        pathShader.setMat4("model", model);
-        pathShader.setVec3("viewPos", programState->camera.Position);
-
-        glActiveTexture(GL_TEXTURE4);
-        glBindTexture(GL_TEXTURE_2D, diffuseMap1);
-        glActiveTexture(GL_TEXTURE5);
-        glBindTexture(GL_TEXTURE_2D, normalMap1);
-        glActiveTexture(GL_TEXTURE6);
-        glBindTexture(GL_TEXTURE_2D, heightMap1);
-        glActiveTexture(GL_TEXTURE7);
-        glBindTexture(GL_TEXTURE_2D, specMap1);
-
-        renderPath(pathVAO, pathVBO);
-
-
-        glDepthFunc(GL_LEQUAL);  // change depth function so depth test passes when values are equal to depth buffer's content
-        skyboxShader.use();
-        view = glm::mat4(glm::mat3(programState->camera.GetViewMatrix())); // remove translation from the view matrix
-        skyboxShader.setMat4("view", view);
-        skyboxShader.setMat4("projection", projection);
-        // skybox cube
-        glBindVertexArray(skyboxVAO);
-        glActiveTexture(GL_TEXTURE0);
+        renderQueue.Submit(RenderQueue::OPAQUE_PASS, pathMaterial, diffuseMap1, 0.0f, [&]() {
+            pathMaterial.setMat4(deferred ? pathGBufferModel : pathModel, groundModel);
+            glState.BindTexture(4, GL_TEXTURE_2D, diffuseMap1);
+            glState.BindTexture(5, GL_TEXTURE_2D, normalMap1);
+            glState.BindTexture(6, GL_TEXTURE_2D, heightMap1);
+            glState.BindTexture(7, GL_TEXTURE_2D, specMap1);
+            path.Draw();
+        });
 
-        if(programState->day){
-            glBindTexture(GL_TEXTURE_CUBE_MAP, cubemapTexture);
-        }else{
-            glBindTexture(GL_TEXTURE_CUBE_MAP, cubemapTexture1);
+        // skybox cube
+        unsigned int skyboxTexture = programState->day ? cubemapTexture : cubemapTexture1;
+        renderQueue.Submit(RenderQueue::SKY_PASS, skyboxShader, skyboxTexture, 0.0f, [&]() {
+            glState.DepthFunc(GL_LEQUAL);  // change depth function so depth test passes when values are equal to depth buffer's content
+            glState.BindVertexArray(skyboxVAO);
+            glState.BindTexture(0, GL_TEXTURE_CUBE_MAP, skyboxTexture);
+            glDrawArrays(GL_TRIANGLES, 0, 36);
+            RenderStats::Frame().CountDraw(12);
+            glState.DepthFunc(GL_LESS); // set depth function back to default
+        });
+
+        // one full screen pass lights the G-buffer, the sky comes after it
+        if (deferred) {
+            glm::mat4 inverseViewProjection = glm::inverse(projection * view);
+            renderQueue.Submit(RenderQueue::LIGHTING_PASS, deferredLightingShader, 0, 0.0f, [&, inverseViewProjection]() {
+                deferredRenderer->Light(inverseViewProjection);
+            });
+            deferredRenderer->BeginGeometry();
         }
-        glDrawArrays(GL_TRIANGLES, 0, 36);
-        glBindVertexArray(0);
-        glDepthFunc(GL_LESS); // set depth function back to default
+
+        renderQueue.Execute();
+        programState->deferredPasses = deferredRenderer->LastStats();
 
 
-        if (programState->ImGuiEnabled)
+        if (benchmark)
+            benchmark->EndFrame();
+        else if (programState->ImGuiEnabled)
             DrawImGui();
 
         glfwSwapBuffers(window);
         glfwPollEvents();
     }
 
+    if (benchmark)
+        benchmark->WriteReport(reinterpret_cast<const char*>(glGetString(GL_RENDERER)));
+    benchmark.reset();
+    benchmarkTarget.reset();
+
+    // drop every reference so the cache deletes the textures while the context still exists
+    treeImpostor.reset();
+    occlusion.reset();
+    shadows.reset();
+    pointShadows.reset();
+    lightClusters.reset();
+    deferredRenderer.reset();
+    shadowCasters.reset();
+    house.reset();
+    tree_1.reset();
+    phormium1.reset();
+    phormium2.reset();
+    lightPole.reset();
+    for (unsigned int texture : {diffuseMap, normalMap, heightMap, specMap, diffuseMap1, normalMap1, heightMap1, specMap1, cubemapTexture, cubemapTexture1})
+        TextureCache::Instance().Release(texture);
+    TextureCache::Instance().Evict();
+    StaticGeometryArena::Instance().Clear();
+
     delete programState;
     ImGui_ImplOpenGL3_Shutdown();
     ImGui_ImplGlfw_Shutdown();
@@ -676,260 +923,6 @@ void scroll_callback(GLFWwindow *window, double xoffset, double yoffset) {
     }
 }
 
-void renderPlane(unsigned int planeVAO, unsigned int planeVBO)
-{
-    if (planeVAO == 0)
-    {
-
-        glm::vec3 pos1(-5.0f,  5.0f, 0.0f);
-        glm::vec3 pos2(-5.0f, -5.0f, 0.0f);
-        glm::vec3 pos3( 5.0f, -5.0f, 0.0f);
-        glm::vec3 pos4( 5.0f,  5.0f, 0.0f);
-
-        //        texture coordinates
-        glm::vec2 uv1(0.0f, 50.0f);
-        glm::vec2 uv2(0.0f, 0.0f);
-        glm::vec2 uv3(50.0f, 0.0f);
-        glm::vec2 uv4(50.0f, 50.0f);
-        // normal vector
-        glm::vec3 nm(0.0f, 0.0f, 1.0f);
-
-        // calculate tangent/bitangent vectors of both triangles
-        glm::vec3 tangent1, bitangent1;
-        glm::vec3 tangent2, bitangent2;
-        // triangle 1
-        // ----------
-        glm::vec3 edge1 = pos2 - pos1;
-        glm::vec3 edge2 = pos3 - pos1;
-        glm::vec2 deltaUV1 = uv2 - uv1;
-        glm::vec2 deltaUV2 = uv3 - uv1;
-
-        float f = 10.0f / (deltaUV1.x * deltaUV2.y - deltaUV2.x * deltaUV1.y);
-
-        tangent1.x = f * (deltaUV2.y * edge1.x - deltaUV1.y * edge2.x);
-        tangent1.y = f * (deltaUV2.y * edge1.y - deltaUV1.y * edge2.y);
-        tangent1.z = f * (deltaUV2.y * edge1.z - deltaUV1.y * edge2.z);
-        tangent1 = glm::normalize(tangent1);
-
-        bitangent1.x = f * (-deltaUV2.x * edge1.x + deltaUV1.x * edge2.x);
-        bitangent1.y = f * (-deltaUV2.x * edge1.y + deltaUV1.x * edge2.y);
-        bitangent1.z = f * (-deltaUV2.x * edge1.z + deltaUV1.x * edge2.z);
-        bitangent1 = glm::normalize(bitangent1);
-
-        // triangle 2
-        // ----------
-        edge1 = pos3 - pos1;
-        edge2 = pos4 - pos1;
-        deltaUV1 = uv3 - uv1;
-        deltaUV2 = uv4 - uv1;
-
-        f = 10.0f / (deltaUV1.x * deltaUV2.y - deltaUV2.x * deltaUV1.y);
-
-        tangent2.x = f * (deltaUV2.y * edge1.x - deltaUV1.y * edge2.x);
-        tangent2.y = f * (deltaUV2.y * edge1.y - deltaUV1.y * edge2.y);
-        tangent2.z = f * (deltaUV2.y * edge1.z - deltaUV1.y * edge2.z);
-        tangent2 = glm::normalize(tangent2);
-
-
-        bitangent2.x = f * (-deltaUV2.x * edge1.x + deltaUV1.x * edge2.x);
-        bitangent2.y = f * (-deltaUV2.x * edge1.y + deltaUV1.x * edge2.y);
-        bitangent2.z = f * (-deltaUV2.x * edge1.z + deltaUV1.x * edge2.z);
-        bitangent2 = glm::normalize(bitangent2);
-
-
-        float quadVertices[] = {
-                // positions            // normal         // texcoords  // tangent                          // bitangent
-                pos1.x, pos1.y, pos1.z, nm.x, nm.y, nm.z, uv1.x, uv1.y, tangent1.x, tangent1.y, tangent1.z, bitangent1.x, bitangent1.y, bitangent1.z,
-                pos2.x, pos2.y, pos2.z, nm.x, nm.y, nm.z, uv2.x, uv2.y, tangent1.x, tangent1.y, tangent1.z, bitangent1.x, bitangent1.y, bitangent1.z,
-                pos3.x, pos3.y, pos3.z, nm.x, nm.y, nm.z, uv3.x, uv3.y, tangent1.x, tangent1.y, tangent1.z, bitangent1.x, bitangent1.y, bitangent1.z,
-
-                pos1.x, pos1.y, pos1.z, nm.x, nm.y, nm.z, uv1.x, uv1.y, tangent2.x, tangent2.y, tangent2.z, bitangent2.x, bitangent2.y, bitangent2.z,
-                pos3.x, pos3.y, pos3.z, nm.x, nm.y, nm.z, uv3.x, uv3.y, tangent2.x, tangent2.y, tangent2.z, bitangent2.x, bitangent2.y, bitangent2.z,
-                pos4.x, pos4.y, pos4.z, nm.x, nm.y, nm.z, uv4.x, uv4.y, tangent2.x, tangent2.y, tangent2.z, bitangent2.x, bitangent2.y, bitangent2.z
-        };
-        glGenVertexArrays(1, &planeVAO);
-        glGenBuffers(1, &planeVBO);
-        glBindVertexArray(planeVAO);
-        glBindBuffer(GL_ARRAY_BUFFER, planeVBO);
-        glBufferData(GL_ARRAY_BUFFER, sizeof(quadVertices), &quadVertices, GL_STATIC_DRAW);
-        glEnableVertexAttribArray(0);
-        glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, 14 * sizeof(float), (void*)0);
-        glEnableVertexAttribArray(1);
-        glVertexAttribPointer(1, 3, GL_FLOAT, GL_FALSE, 14 * sizeof(float), (void*)(3 * sizeof(float)));
-        glEnableVertexAttribArray(2);
-        glVertexAttribPointer(2, 2, GL_FLOAT, GL_FALSE, 14 * sizeof(float), (void*)(6 * sizeof(float)));
-        glEnableVertexAttribArray(3);
-        glVertexAttribPointer(3, 3, GL_FLOAT, GL_FALSE, 14 * sizeof(float), (void*)(8 * sizeof(float)));
-        glEnableVertexAttribArray(4);
-        glVertexAttribPointer(4, 3, GL_FLOAT, GL_FALSE, 14 * sizeof(float), (void*)(11 * sizeof(float)));
-    }
-    glBindVertexArray(planeVAO);
-    glDrawArrays(GL_TRIANGLES, 0, 6);
-    glBindVertexArray(0);
-}
-void renderPath(unsigned int pathVAO, unsigned int pathVBO)
-{
-    if (pathVAO == 0)
-    {
-
-        glm::vec3 pos1(-0.1f,  0.1f, 0.001f);
-        glm::vec3 pos2(-0.1f, -5.0f, 0.001f);
-        glm::vec3 pos3( 0.1f, -5.0f, 0.001f);
-        glm::vec3 pos4( 0.1f,  0.1f, 0.001f);
-
-        //        texture coordinates
-        glm::vec2 uv1(0.0f, 40.0f);
-        glm::vec2 uv2(0.0f, 0.0f);
-        glm::vec2 uv3(2.0f, 0.0f);
-        glm::vec2 uv4(2.0f, 40.0f);
-        // normal vector
-        glm::vec3 nm(0.0f, 0.0f, 1.0f);
-
-        // calculate tangent/bitangent vectors of both triangles
-        glm::vec3 tangent1, bitangent1;
-        glm::vec3 tangent2, bitangent2;
-        // triangle 1
-        // ----------
-        glm::vec3 edge1 = pos2 - pos1;
-        glm::vec3 edge2 = pos3 - pos1;
-        glm::vec2 deltaUV1 = uv2 - uv1;
-        glm::vec2 deltaUV2 = uv3 - uv1;
-
-        float f = 10.0f / (deltaUV1.x * deltaUV2.y - deltaUV2.x * deltaUV1.y);
-
-        tangent1.x = f * (deltaUV2.y * edge1.x - deltaUV1.y * edge2.x);
-        tangent1.y = f * (deltaUV2.y * edge1.y - deltaUV1.y * edge2.y);
-        tangent1.z = f * (deltaUV2.y * edge1.z - deltaUV1.y * edge2.z);
-        tangent1 = glm::normalize(tangent1);
-
-        bitangent1.x = f * (-deltaUV2.x * edge1.x + deltaUV1.x * edge2.x);
-        bitangent1.y = f * (-deltaUV2.x * edge1.y + deltaUV1.x * edge2.y);
-        bitangent1.z = f * (-deltaUV2.x * edge1.z + deltaUV1.x * edge2.z);
-        bitangent1 = glm::normalize(bitangent1);
-
-        // triangle 2
-        // ----------
-        edge1 = pos3 - pos1;
-        edge2 = pos4 - pos1;
-        deltaUV1 = uv3 - uv1;
-        deltaUV2 = uv4 - uv1;
-
-        f = 10.0f / (deltaUV1.x * deltaUV2.y - deltaUV2.x * deltaUV1.y);
-
-        tangent2.x = f * (deltaUV2.y * edge1.x - deltaUV1.y * edge2.x);
-        tangent2.y = f * (deltaUV2.y * edge1.y - deltaUV1.y * edge2.y);
-        tangent2.z = f * (deltaUV2.y * edge1.z - deltaUV1.y * edge2.z);
-        tangent2 = glm::normalize(tangent2);
-
-
-        bitangent2.x = f * (-deltaUV2.x * edge1.x + deltaUV1.x * edge2.x);
-        bitangent2.y = f * (-deltaUV2.x * edge1.y + deltaUV1.x * edge2.y);
-        bitangent2.z = f * (-deltaUV2.x * edge1.z + deltaUV1.x * edge2.z);
-        bitangent2 = glm::normalize(bitangent2);
-
-
-        float quadVertices[] = {
-                // positions            // normal         // texcoords  // tangent                          // bitangent
-                pos1.x, pos1.y, pos1.z, nm.x, nm.y, nm.z, uv1.x, uv1.y, tangent1.x, tangent1.y, tangent1.z, bitangent1.x, bitangent1.y, bitangent1.z,
-                pos2.x, pos2.y, pos2.z, nm.x, nm.y, nm.z, uv2.x, uv2.y, tangent1.x, tangent1.y, tangent1.z, bitangent1.x, bitangent1.y, bitangent1.z,
-                pos3.x, pos3.y, pos3.z, nm.x, nm.y, nm.z, uv3.x, uv3.y, tangent1.x, tangent1.y, tangent1.z, bitangent1.x, bitangent1.y, bitangent1.z,
-
-                pos1.x, pos1.y, pos1.z, nm.x, nm.y, nm.z, uv1.x, uv1.y, tangent2.x, tangent2.y, tangent2.z, bitangent2.x, bitangent2.y, bitangent2.z,
-                pos3.x, pos3.y, pos3.z, nm.x, nm.y, nm.z, uv3.x, uv3.y, tangent2.x, tangent2.y, tangent2.z, bitangent2.x, bitangent2.y, bitangent2.z,
-                pos4.x, pos4.y, pos4.z, nm.x, nm.y, nm.z, uv4.x, uv4.y, tangent2.x, tangent2.y, tangent2.z, bitangent2.x, bitangent2.y, bitangent2.z
-        };
-        glGenVertexArrays(1, &pathVAO);
-        glGenBuffers(1, &pathVBO);
-        glBindVertexArray(pathVAO);
-        glBindBuffer(GL_ARRAY_BUFFER, pathVBO);
-        glBufferData(GL_ARRAY_BUFFER, sizeof(quadVertices), &quadVertices, GL_STATIC_DRAW);
-        glEnableVertexAttribArray(0);
-        glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, 14 * sizeof(float), (void*)0);
-        glEnableVertexAttribArray(1);
-        glVertexAttribPointer(1, 3, GL_FLOAT, GL_FALSE, 14 * sizeof(float), (void*)(3 * sizeof(float)));
-        glEnableVertexAttribArray(2);
-        glVertexAttribPointer(2, 2, GL_FLOAT, GL_FALSE, 14 * sizeof(float), (void*)(6 * sizeof(float)));
-        glEnableVertexAttribArray(3);
-        glVertexAttribPointer(3, 3, GL_FLOAT, GL_FALSE, 14 * sizeof(float), (void*)(8 * sizeof(float)));
-        glEnableVertexAttribArray(4);
-        glVertexAttribPointer(4, 3, GL_FLOAT, GL_FALSE, 14 * sizeof(float), (void*)(11 * sizeof(float)));
-    }
-    glBindVertexArray(pathVAO);
-    glDrawArrays(GL_TRIANGLES, 0, 6);
-    glBindVertexArray(0);
-}
-unsigned int loadTexture(char const *path)
-{
-    unsigned int textureID;
-    glGenTextures(1, &textureID);
-
-    int width, height, nrComponents;
-    unsigned char *data = stbi_load(path, &width, &height, &nrComponents, 0);
-    if (data)
-    {
-        GLenum format;
-        if (nrComponents == 1)
-            format = GL_RED;
-        else if (nrComponents == 3)
-            format = GL_RGB;
-        else if (nrComponents == 4)
-            format = GL_RGBA;
-
-
-        glBindTexture(GL_TEXTURE_2D, textureID);
-        glTexImage2D(GL_TEXTURE_2D, 0, format, width, height, 0, format, GL_UNSIGNED_BYTE, data);
-
-        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_REPEAT);
-        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_REPEAT);
-
-
-        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR_MIPMAP_LINEAR);
-        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
-
-        glGenerateMipmap(GL_TEXTURE_2D);
-
-        stbi_image_free(data);
-    }
-    else
-    {
-        std::cout << "Texture failed to load at path: " << path << std::endl;
-        stbi_image_free(data);
-    }
-
-    return textureID;
-}
-
-
-unsigned int loadCubemap(vector<std::string> faces)
-{
-    unsigned int textureID;
-    glGenTextures(1, &textureID);
-    glBindTexture(GL_TEXTURE_CUBE_MAP, textureID);
-
-    int width, height, nrChannels;
-    for (unsigned int i = 0; i < faces.size(); i++)
-    {
-        unsigned char *data = stbi_load(faces[i].c_str(), &width, &height, &nrChannels, 0);
-        if (data)
-        {
-            glTexImage2D(GL_TEXTURE_CUBE_MAP_POSITIVE_X + i, 0, GL_RGB, width, height, 0, GL_RGB, GL_UNSIGNED_BYTE, data);
-            stbi_image_free(data);
-        }
-        else
-        {
-            std::cout << "Cubemap texture failed to load at path: " << faces[i] << std::endl;
-            stbi_image_free(data);
-        }
-    }
-    glTexParameteri(GL_TEXTURE_CUBE_MAP, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
-    glTexParameteri(GL_TEXTURE_CUBE_MAP, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
-    glTexParameteri(GL_TEXTURE_CUBE_MAP, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
-    glTexParameteri(GL_TEXTURE_CUBE_MAP, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
-    glTexParameteri(GL_TEXTURE_CUBE_MAP, GL_TEXTURE_WRAP_R, GL_CLAMP_TO_EDGE);
-
-    return textureID;
-}
-
 void DrawImGui() {
     ImGui_ImplOpenGL3_NewFrame();
     ImGui_ImplGlfw_NewFrame();
@@ -968,6 +961,37 @@ void DrawImGui() {
         ImGui::Text("Camera position: (%f, %f, %f)", c.Position.x, c.Position.y, c.Position.z);
         ImGui::Text("(Yaw, Pitch): (%f, %f)", c.Yaw, c.Pitch);
         ImGui::Text("Camera front: (%f, %f, %f)", c.Front.x, c.Front.y, c.Front.z);
+        ImGui::Text("Objects submitted: %u, culled: %u, occluded: %u", programState->culling.submitted,
+                    programState->culling.culled, programState->culling.occluded);
+        ImGui::Checkbox("Occlusion culling", &programState->occlusionCulling);
+        ImGui::Checkbox("Foliage depth prepass", &programState->depthPrepass);
+        ImGui::Checkbox("Deferred shading", &programState->deferred);
+        if (programState->deferred)
+            ImGui::Text("G-buffer: %.3f ms, lighting: %.3f ms", programState->deferredPasses.geometryMs,
+                        programState->deferredPasses.lightingMs);
+        ImGui::SliderFloat("Shadow distance", &programState->shadowDistance, 5.0f, 50.0f);
+        for (unsigned int i = 0; i < NR_CASCADES; i++) {
+            const CascadedShadowMap::CascadeStats &cascade = programState->shadowCascades[i];
+            ImGui::Text("Cascade %u: %s, %u draws, %llu triangles, %.3f ms", i, cascade.rendered ? "rendered" : "cached",
+                        cascade.drawCalls, cascade.triangles, cascade.gpuMs);
+        }
+        ImGui::Text("Point light shadow cubes rendered: %u", programState->pointShadowsRendered);
+        ImGui::SliderInt("Street lamps", &programState->streetLamps, 0, 1024);
+        ImGui::Text("Clustered lights: %u, %u indices, at most %u per cluster, binned in %.3f ms", programState->clusters.lights,
+                    programState->clusters.indices, programState->clusters.maxPerCluster, programState->clusters.binningMs);
+        ImGui::Text("Frame time: %.2f ms", 1000.0f / ImGui::GetIO().Framerate);
+        ImGui::Text("Draw calls: %u, triangles: %llu", RenderStats::Frame().drawCalls, RenderStats::Frame().triangles);
+        ImGui::Text("Textures resident: %u", TextureCache::Instance().Size());
+        const GLStateCache::Counters &stateCalls = GLStateCache::Instance().Frame();
+        ImGui::Text("GL state calls: %u issued, %u elided", stateCalls.issued, stateCalls.elided);
+        float lodHistogram[MAX_LODS + 1];
+        for (unsigned int i = 0; i <= MAX_LODS; i++)
+            lodHistogram[i] = (float) programState->lods.instances[i];
+        ImGui::PlotHistogram("Instances per LOD", lodHistogram, MAX_LODS + 1, 0, nullptr, 0.0f, FLT_MAX, ImVec2(0, 60));
+        ImGui::Text("LOD 0-3: %u %u %u %u, impostors: %u", programState->lods.instances[0], programState->lods.instances[1],
+                    programState->lods.instances[2], programState->lods.instances[3], programState->lods.instances[IMPOSTOR_LOD]);
+        ImGui::SliderFloat("LOD hysteresis", &programState->lodSelector.hysteresis, 0.0f, 0.5f);
+        ImGui::SliderFloat("Impostor below", &programState->lodSelector.impostorThreshold, 0.0f, 0.3f);
         ImGui::Checkbox("Camera mouse update", &programState->CameraMouseMovementUpdateEnabled);
         ImGui::End();
     }
@@ -975,3 +999,18 @@ void DrawImGui() {
     ImGui::Render();
     ImGui_ImplOpenGL3_RenderDrawData(ImGui::GetDrawData());
 }
+
+void DrawLoadingScreen(unsigned int completed, unsigned int requested) {
+    ImGui_ImplOpenGL3_NewFrame();
+    ImGui_ImplGlfw_NewFrame();
+    ImGui::NewFrame();
+
+    ImGui::SetNextWindowPos(ImVec2(SCR_WIDTH * 0.5f, SCR_HEIGHT * 0.5f), ImGuiCond_Always, ImVec2(0.5f, 0.5f));
+    ImGui::Begin("Loading", nullptr, ImGuiWindowFlags_NoDecoration | ImGuiWindowFlags_AlwaysAutoResize);
+    ImGui::Text("Loading assets %u/%u", completed, requested);
+    ImGui::ProgressBar(requested == 0 ? 1.0f : (float) completed / (float) requested, ImVec2(300.0f, 0.0f));
+    ImGui::End();
+
+    ImGui::Render();
+    ImGui_ImplOpenGL3_RenderDrawData(ImGui::GetDrawData());
+}